@@ -0,0 +1,749 @@
+#include "../control/SaveAndLoad.h"
+#include "../control/SimulationHandler.h"
+#include "../view/AtomSprites.h"
+#include "../view/Logger.h"
+
+#include "../../imgui/imgui.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+const char* START_CONDITION_NAMES[StartConditionMax] = { "Random", "Equidistant", "RandomEquidistant", "Rings" };
+const char* PAIR_MODE_NAMES[2] = { "Full", "Half" };
+const char* TYPE_RUN_MODE_NAMES[2] = { "Off", "On" };
+const char* DRAW_METHOD_NAMES[2] = { "Circles", "Sprites" };
+
+/**
+ * Command line options for a benchmark run. Every combination of the listed
+ * parameters is benchmarked.
+ */
+struct BenchmarkOptions {
+    std::vector<unsigned int> atomCounts = { 1000, 3000 };
+    std::vector<unsigned int> typeCounts = { 4, 16 };
+    std::vector<float> interactionRanges = { 40.0f, 80.0f };
+    /** Collision forces (see SimulationHandler::setCollisionForce), 0 to let atoms overlap. */
+    std::vector<float> collisionForces = { 1.0f };
+    std::vector<StartCondition> startConditions = {
+        StartConditionRandom, StartConditionEquidistant, StartConditionRandomEquidistant, StartConditionRings
+    };
+    std::vector<InstructionSet> instructionSets;
+    std::vector<unsigned int> threadCounts = { 1 };
+    /** Whether each pair of atoms is visited once (Half) or once per atom (Full). */
+    std::vector<bool> pairSymmetries = { true };
+    /** Whether type runs may be used (see SimulationHandler::setTypeRuns). */
+    std::vector<bool> typeRuns = { true };
+    /** Neighbour list skins (see SimulationHandler::setNeighbourSkin), 0 to search the grid every iteration. */
+    std::vector<float> neighbourSkins = { 0.0f };
+    /** Iterations between Morton reorders of the atoms (see SimulationHandler::setReorderInterval), 0 to never reorder. */
+    std::vector<unsigned int> reorderIntervals = { 0 };
+    /** Atom type counts to time loading configs of. If set, iteration is not benchmarked. */
+    std::vector<unsigned int> loadTypeCounts;
+    /** Atom counts to time drawing snapshots of. If set, iteration is not benchmarked. */
+    std::vector<unsigned int> drawAtomCounts;
+
+    float width = 1000.0f;
+    float height = 1000.0f;
+    /** Time step, which sets how far atoms move between neighbour list rebuilds. */
+    float dt = 1.0f;
+    unsigned int warmUp = 5;
+    unsigned int iterations = 20;
+    unsigned int repetitions = 3;
+    uint64_t seed = 0;
+    std::string outputPrefix = "benchmark";
+};
+
+/**
+ * Timing of a single combination of parameters.
+ */
+struct BenchmarkResult {
+    size_t atoms;
+    size_t types;
+    float interactionRange;
+    float collisionForce;
+    StartCondition startCondition;
+    InstructionSet instructionSet;
+    size_t threads;
+    bool pairSymmetry;
+    bool typeRuns; /** Whether type runs were actually used, not just allowed. */
+    float neighbourSkin;
+    double rebuildInterval; /** Timed iterations per neighbour list rebuild (1 without lists). */
+    size_t reorderInterval;
+    double cacheMisses;   /** Hardware cache misses per timed iteration, or negative if not available. */
+    double medianSeconds; /** Median time of one iteration across the repetitions. */
+    double minSeconds;    /** Fastest time of one iteration across the repetitions. */
+};
+
+/**
+ * Timing of building the ImGui draw list for a snapshot with a given number of
+ * atoms, either as tessellated circles or as sprites (see AtomSprites.h).
+ */
+struct DrawBenchmarkResult {
+    size_t atoms;
+    bool sprites;
+    size_t vertices;
+    size_t indices;
+    size_t drawCommands;
+    double medianSeconds; /** Median time of one frame across the repetitions. */
+    double minSeconds;    /** Fastest time of one frame across the repetitions. */
+};
+
+/**
+ * Timing of loading a config with a given number of atom types.
+ */
+struct LoadBenchmarkResult {
+    size_t types;
+    size_t lines;
+    size_t bytes;
+    double medianSeconds; /** Median time of one load across the repetitions. */
+    double minSeconds;    /** Fastest time of one load across the repetitions. */
+};
+
+static void printUsage(const char* executable) {
+    std::printf(
+        "Usage: %s [options]\n"
+        "Lists are comma separated, every combination of the listed values is benchmarked.\n"
+        "  -a <list>        Atom counts (default: 1000,3000)\n"
+        "  -k <list>        Atom type counts (default: 4,16)\n"
+        "  -r <list>        Interaction ranges (default: 40,80)\n"
+        "  -c <list>        Collision forces, 0 to let atoms overlap (default: 1)\n"
+        "  -s <list>        Start conditions, 'all' or any of Random,Equidistant,RandomEquidistant,Rings\n"
+        "                   (default: all)\n"
+        "  -i <list>        Instruction sets, 'all' or any of Scalar,AVX2,AVX-512 (default: all supported)\n"
+        "  -t <list>        Thread counts (default: 1)\n"
+        "  -m <list>        Pair modes, 'all' or any of Full,Half (default: Half)\n"
+        "  -y <list>        Type run modes, 'all' or any of Off,On (default: On)\n"
+        "  -e <list>        Neighbour list skins, 0 to search the grid every iteration (default: 0)\n"
+        "  -q <list>        Iterations between Morton reorders of the atoms, 0 to never reorder (default: 0)\n"
+        "  -l <list>        Time loading configs with these atom type counts instead of iterating\n"
+        "                   (-n loads per repetition, written to <prefix>_load.csv)\n"
+        "  -g <list>        Time drawing snapshots with these atom counts instead of iterating, as circles\n"
+        "                   and as sprites (-n frames per repetition, written to <prefix>_draw.csv)\n"
+        "  -b <w>x<h>       Simulation bounds (default: 1000x1000)\n"
+        "  -dt <dt>         Time step of each iteration (default: 1)\n"
+        "  -w <iterations>  Warm-up iterations before timing (default: 5)\n"
+        "  -n <iterations>  Iterations per repetition (default: 20)\n"
+        "  -p <repetitions> Timed repetitions (default: 3)\n"
+        "  -seed <seed>     Seed for the interaction values and atom positions (default: 0)\n"
+        "  -o <prefix>      Prefix of the output files (default: benchmark)\n"
+        "Writes results to <prefix>.csv and <prefix>.json.\n",
+        executable
+    );
+}
+
+/**
+ * Split a comma separated list.
+ */
+static std::vector<std::string> splitList(const std::string& list) {
+    std::vector<std::string> items;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ','))
+        if (!item.empty())
+            items.push_back(item);
+    return items;
+}
+
+static bool parseUintList(const std::string& list, std::vector<unsigned int>& values) {
+    values.clear();
+    for (const std::string& item : splitList(list)) {
+        unsigned int value;
+        if (!parseUint(item, value))
+            return false;
+        values.push_back(value);
+    }
+    return !values.empty();
+}
+
+static bool parseFloatList(const std::string& list, std::vector<float>& values) {
+    values.clear();
+    for (const std::string& item : splitList(list)) {
+        float value;
+        if (!parseFloat(item, value))
+            return false;
+        values.push_back(value);
+    }
+    return !values.empty();
+}
+
+static bool parseStartConditions(const std::string& list, std::vector<StartCondition>& values) {
+    values.clear();
+    for (const std::string& item : splitList(list)) {
+        bool found = false;
+        for (int sc = 0; sc < StartConditionMax; sc++) {
+            if (item == "all" || item == START_CONDITION_NAMES[sc]) {
+                found = true;
+                values.push_back((StartCondition) sc);
+            }
+        }
+        if (!found)
+            return false;
+    }
+    return !values.empty();
+}
+
+static bool parseInstructionSets(const std::string& list, std::vector<InstructionSet>& values) {
+    values.clear();
+    for (const std::string& item : splitList(list)) {
+        bool found = false;
+        for (int is = 0; is < InstructionSetMax; is++) {
+            if (item != "all" && item != getInstructionSetName((InstructionSet) is))
+                continue;
+            found = true;
+            if (isInstructionSetSupported((InstructionSet) is))
+                values.push_back((InstructionSet) is);
+            else if (item != "all")
+                std::fprintf(stderr, "Instruction set '%s' is not supported by this CPU, skipping\n", item.c_str());
+        }
+        if (!found)
+            return false;
+    }
+    return !values.empty();
+}
+
+/**
+ * Parse a list of two-state modes, named names[0] for false and names[1] for
+ * true.
+ */
+static bool parseModes(const std::string& list, const char* const names[2], std::vector<bool>& values) {
+    values.clear();
+    for (const std::string& item : splitList(list)) {
+        bool found = false;
+        for (int m = 0; m < 2; m++) {
+            if (item == "all" || item == names[m]) {
+                found = true;
+                values.push_back(m == 1);
+            }
+        }
+        if (!found)
+            return false;
+    }
+    return !values.empty();
+}
+
+/**
+ * Parse command line arguments into options.
+ * @returns false if the arguments are invalid, otherwise true.
+ */
+static bool parseArguments(int argc, char* args[], BenchmarkOptions& options) {
+    for (int is = 0; is < InstructionSetMax; is++)
+        if (isInstructionSetSupported((InstructionSet) is))
+            options.instructionSets.push_back((InstructionSet) is);
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = args[i];
+        if (arg == "-h" || arg == "--help")
+            return false;
+        if (i + 1 >= argc) {
+            std::fprintf(stderr, "Missing value for '%s'\n", arg.c_str());
+            return false;
+        }
+        std::string value = args[++i];
+
+        bool valid;
+        if      (arg == "-a")    valid = parseUintList(value, options.atomCounts);
+        else if (arg == "-k")    valid = parseUintList(value, options.typeCounts);
+        else if (arg == "-r")    valid = parseFloatList(value, options.interactionRanges);
+        else if (arg == "-c")    valid = parseFloatList(value, options.collisionForces);
+        else if (arg == "-s")    valid = parseStartConditions(value, options.startConditions);
+        else if (arg == "-i")    valid = parseInstructionSets(value, options.instructionSets);
+        else if (arg == "-t")    valid = parseUintList(value, options.threadCounts);
+        else if (arg == "-m")    valid = parseModes(value, PAIR_MODE_NAMES, options.pairSymmetries);
+        else if (arg == "-y")    valid = parseModes(value, TYPE_RUN_MODE_NAMES, options.typeRuns);
+        else if (arg == "-e")    valid = parseFloatList(value, options.neighbourSkins);
+        else if (arg == "-q")    valid = parseUintList(value, options.reorderIntervals);
+        else if (arg == "-dt")   valid = parseFloat(value, options.dt) && options.dt > 0.0f;
+        else if (arg == "-l")    valid = parseUintList(value, options.loadTypeCounts);
+        else if (arg == "-g")    valid = parseUintList(value, options.drawAtomCounts);
+        else if (arg == "-w")    valid = parseUint(value, options.warmUp);
+        else if (arg == "-n")    valid = parseUint(value, options.iterations) && options.iterations > 0;
+        else if (arg == "-p")    valid = parseUint(value, options.repetitions) && options.repetitions > 0;
+        else if (arg == "-seed") valid = parseUint(value, options.seed);
+        else if (arg == "-o") {
+            options.outputPrefix = value;
+            valid = true;
+        } else if (arg == "-b") {
+            size_t separator = value.find('x');
+            valid = separator != std::string::npos
+                 && parseFloat(value.substr(0, separator), options.width)
+                 && parseFloat(value.substr(separator + 1), options.height);
+        } else {
+            std::fprintf(stderr, "Unknown option '%s'\n", arg.c_str());
+            return false;
+        }
+        if (!valid) {
+            std::fprintf(stderr, "Invalid value '%s' for '%s'\n", value.c_str(), arg.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Populate handler with typeCount atom types sharing atomCount atoms evenly.
+ * The handler is seeded with seed first, so every combination with the same
+ * number of types uses the same interactions, and the same atom positions
+ * when generated with the same start condition.
+ */
+static void createAtomTypes(SimulationHandler& handler, size_t atomCount, size_t typeCount, uint64_t seed) {
+    handler.clearAtomTypes();
+    handler.setSeed(seed);
+    for (size_t at = 0; at < typeCount; at++) {
+        atom_type_id id = handler.newAtomType();
+        handler.setAtomTypeQuantity(id, atomCount / typeCount + (at < atomCount % typeCount ? 1 : 0));
+    }
+    handler.shuffleAtomInteractions();
+}
+
+/**
+ * Hardware counter of the cache misses of the calling thread and of every
+ * thread started after it was opened, where the kernel exposes hardware
+ * counters (Linux only, and rarely inside virtual machines).
+ */
+class CacheMissCounter {
+public:
+    CacheMissCounter() : mFile(-1) {
+#ifdef __linux__
+        perf_event_attr attributes{};
+        attributes.type = PERF_TYPE_HARDWARE;
+        attributes.size = sizeof(attributes);
+        attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+        attributes.disabled = 1;
+        attributes.inherit = 1;
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv = 1;
+        mFile = (int) syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+#endif
+    }
+    ~CacheMissCounter() {
+#ifdef __linux__
+        if (mFile >= 0)
+            close(mFile);
+#endif
+    }
+
+    CacheMissCounter(const CacheMissCounter&) = delete;
+    CacheMissCounter& operator=(const CacheMissCounter&) = delete;
+
+    void enable() {
+#ifdef __linux__
+        if (mFile >= 0)
+            ioctl(mFile, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+    }
+    void disable() {
+#ifdef __linux__
+        if (mFile >= 0)
+            ioctl(mFile, PERF_EVENT_IOC_DISABLE, 0);
+#endif
+    }
+
+    /**
+     * The misses of other threads are only added once they have exited, so
+     * read after any thread pools have been destroyed.
+     * @returns Misses counted while enabled, or -1 if the counter is not
+     * available.
+     */
+    [[nodiscard]] int64_t read() const {
+        int64_t misses = -1;
+#ifdef __linux__
+        if (mFile < 0 || ::read(mFile, &misses, sizeof(misses)) != (ssize_t) sizeof(misses))
+            misses = -1;
+#endif
+        return misses;
+    }
+private:
+    int mFile;
+};
+
+static BenchmarkResult runBenchmark(const BenchmarkOptions& options, size_t atomCount, size_t typeCount,
+                                    float interactionRange, float collisionForce, StartCondition startCondition,
+                                    InstructionSet instructionSet, size_t threadCount, bool pairSymmetry,
+                                    bool typeRuns, float neighbourSkin, size_t reorderInterval) {
+    // Opened before the handler starts its threads, so they are counted too
+    CacheMissCounter cacheMisses;
+    auto handler = std::make_unique<SimulationHandler>();
+    handler->setBounds(options.width, options.height);
+    handler->setDt(options.dt);
+    handler->setInteractionRange(interactionRange);
+    handler->setCollisionForce(collisionForce);
+    handler->setThreadCount(threadCount);
+    handler->setInstructionSet(instructionSet);
+    handler->setPairSymmetry(pairSymmetry);
+    handler->setTypeRuns(typeRuns);
+    handler->setNeighbourSkin(neighbourSkin);
+    handler->setReorderInterval(reorderInterval);
+    handler->startCondition = startCondition;
+    createAtomTypes(*handler, atomCount, typeCount, options.seed);
+    handler->initSimulation();
+
+    for (unsigned int i = 0; i < options.warmUp; i++)
+        handler->iterateSimulation();
+
+    size_t builds = handler->getNeighbourListBuildCount();
+    cacheMisses.enable();
+    std::vector<double> times(options.repetitions);
+    for (double& time : times) {
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned int i = 0; i < options.iterations; i++)
+            handler->iterateSimulation();
+        time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / options.iterations;
+    }
+    cacheMisses.disable();
+    std::sort(times.begin(), times.end());
+    builds = handler->getNeighbourListBuildCount() - builds;
+    double timedIterations = (double) options.iterations * options.repetitions;
+
+    BenchmarkResult result{
+        handler->getActualAtomCount(), handler->getAtomTypeCount(), handler->getInteractionRange(), handler->getCollisionForce(),
+        startCondition, handler->getInstructionSet(), handler->getThreadCount(), handler->getPairSymmetry(),
+        handler->isUsingTypeRuns(), handler->getNeighbourSkin(), (neighbourSkin > 0.0f) ? timedIterations / std::max(builds, (size_t) 1) : 1.0,
+        handler->getReorderInterval(), -1.0, times[times.size() / 2], times.front()
+    };
+    handler.reset();
+    int64_t misses = cacheMisses.read();
+    if (misses >= 0)
+        result.cacheMisses = (double) misses / timedIterations;
+    return result;
+}
+
+/**
+ * Time loadFromFile on a config with typeCount atom types (and so typeCount
+ * squared interaction lines), written to a temporary file next to the output.
+ */
+static LoadBenchmarkResult runLoadBenchmark(const BenchmarkOptions& options, size_t typeCount) {
+    std::string location = options.outputPrefix + "_load." + CONFIG_FILE_EXTENSION;
+    auto handler = std::make_unique<SimulationHandler>();
+    createAtomTypes(*handler, options.atomCounts.front(), typeCount, options.seed);
+    saveToFile(location, *handler);
+
+    for (unsigned int i = 0; i < options.warmUp; i++)
+        loadFromFile(location, *handler);
+
+    std::vector<double> times(options.repetitions);
+    for (double& time : times) {
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned int i = 0; i < options.iterations; i++)
+            loadFromFile(location, *handler);
+        time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / options.iterations;
+    }
+    std::sort(times.begin(), times.end());
+
+    std::error_code error;
+    size_t bytes = (size_t) std::filesystem::file_size(location, error);
+    std::filesystem::remove(location, error);
+
+    return LoadBenchmarkResult{
+        handler->getAtomTypeCount(), 7 + typeCount + typeCount * typeCount, bytes,
+        times[times.size() / 2], times.front()
+    };
+}
+
+/**
+ * Time building the draw list of an ImGui frame showing a snapshot of
+ * atomCount atoms (with the first of the listed atom type counts), the same
+ * way as SimulationRenderer::drawSimulation. Only the CPU side of a frame is
+ * timed, as there is no window; the vertex and index counts give the amount
+ * uploaded to the GPU each frame.
+ */
+static DrawBenchmarkResult runDrawBenchmark(const BenchmarkOptions& options, size_t atomCount, bool sprites) {
+    auto handler = std::make_unique<SimulationHandler>();
+    handler->setBounds(options.width, options.height);
+    createAtomTypes(*handler, atomCount, options.typeCounts.front(), options.seed);
+    handler->initSimulation();
+
+    SimulationSnapshot snapshot;
+    snapshot.width = handler->getWidth();
+    snapshot.height = handler->getHeight();
+    snapshot.atomDiameter = handler->getAtomDiameter();
+    snapshot.atomTypeColors.resize(handler->getAtomTypeCount());
+    for (atom_type_id id : handler->getAtomTypeIds())
+        snapshot.atomTypeColors[id] = handler->getAtomTypeColor(id);
+    AtomsView atoms = handler->getAtoms();
+    const AtomArrays& arrays = atoms.getArrays();
+    snapshot.x.assign(arrays.x.begin(), arrays.x.begin() + atoms.size());
+    snapshot.y.assign(arrays.y.begin(), arrays.y.begin() + atoms.size());
+    snapshot.atomType.assign(arrays.atomType.begin(), arrays.atomType.begin() + atoms.size());
+
+    ImVec2 size = ImGui::GetIO().DisplaySize;
+    ImVec2 scale(size.x / snapshot.width, size.y / snapshot.height);
+    float atomSize = std::max(snapshot.atomDiameter * scale.x, 3.0f);
+    std::vector<ImU32> colors;
+    auto drawFrame = [&]() {
+        ImGui::NewFrame();
+        ImGui::SetNextWindowPos(ImVec2(0.0f, 0.0f));
+        ImGui::SetNextWindowSize(size);
+        ImGui::Begin("Simulation", nullptr, ImGuiWindowFlags_NoDecoration);
+        ImDrawList* drawList = ImGui::GetWindowDrawList();
+        drawList->AddRectFilled(ImVec2(0.0f, 0.0f), size, ImColor(0.2f, 0.2f, 0.2f));
+        ImGui::PushClipRect(ImVec2(0.0f, 0.0f), size, true);
+        packAtomTypeColors(snapshot, colors);
+        if (sprites)
+            addAtomSprites(drawList, snapshot, colors, (ImTextureID) (intptr_t) 1, ImVec2(0.0f, 0.0f), scale, atomSize);
+        else
+            addAtomCircles(drawList, snapshot, colors, ImVec2(0.0f, 0.0f), scale, atomSize);
+        ImGui::PopClipRect();
+        ImGui::End();
+        ImGui::Render();
+    };
+
+    for (unsigned int i = 0; i < options.warmUp; i++)
+        drawFrame();
+
+    std::vector<double> times(options.repetitions);
+    for (double& time : times) {
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned int i = 0; i < options.iterations; i++)
+            drawFrame();
+        time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / options.iterations;
+    }
+    std::sort(times.begin(), times.end());
+
+    ImDrawData* drawData = ImGui::GetDrawData();
+    size_t drawCommands = 0;
+    for (int l = 0; l < drawData->CmdListsCount; l++)
+        drawCommands += (size_t) drawData->CmdLists[l]->CmdBuffer.Size;
+
+    return DrawBenchmarkResult{
+        snapshot.size(), sprites, (size_t) drawData->TotalVtxCount, (size_t) drawData->TotalIdxCount, drawCommands,
+        times[times.size() / 2], times.front()
+    };
+}
+
+/**
+ * @returns Kilobytes of vertices and indices uploaded to draw a frame.
+ */
+static double getUploadKB(const DrawBenchmarkResult& result) {
+    return (double) (result.vertices * sizeof(ImDrawVert) + result.indices * sizeof(ImDrawIdx)) / 1024.0;
+}
+
+static bool writeDrawCsv(const std::string& location, const std::vector<DrawBenchmarkResult>& results) {
+    std::ofstream file(location);
+    if (!file) {
+        LOG_ERROR(std::string("Failed to open file '").append(location).append("' for writing"));
+        return false;
+    }
+
+    file << "Atoms,Method,Vertices,Indices,DrawCommands,UploadKB,MedianMsPerFrame,MinMsPerFrame\n";
+    for (const DrawBenchmarkResult& result : results) {
+        file << result.atoms << ',' << DRAW_METHOD_NAMES[result.sprites] << ',' << result.vertices << ','
+             << result.indices << ',' << result.drawCommands << ',' << getUploadKB(result) << ','
+             << result.medianSeconds * 1e3 << ',' << result.minSeconds * 1e3 << '\n';
+    }
+    return (bool) file;
+}
+
+static bool writeLoadCsv(const std::string& location, const std::vector<LoadBenchmarkResult>& results) {
+    std::ofstream file(location);
+    if (!file) {
+        LOG_ERROR(std::string("Failed to open file '").append(location).append("' for writing"));
+        return false;
+    }
+
+    file << "Types,Lines,Bytes,MedianMsPerLoad,MinMsPerLoad,MBPerSecond\n";
+    for (const LoadBenchmarkResult& result : results) {
+        file << result.types << ',' << result.lines << ',' << result.bytes << ','
+             << result.medianSeconds * 1e3 << ',' << result.minSeconds * 1e3 << ','
+             << (result.medianSeconds > 0.0 ? result.bytes / result.medianSeconds / 1e6 : 0.0) << '\n';
+    }
+    return (bool) file;
+}
+
+/**
+ * @returns Nanoseconds per atom pair (every atom against every other atom,
+ * regardless of whether they are in range), so results are comparable between
+ * brute-force and spatially indexed implementations.
+ */
+static double getNsPerPair(const BenchmarkResult& result) {
+    double pairs = (double) result.atoms * (double) result.atoms;
+    return pairs > 0.0 ? result.medianSeconds * 1e9 / pairs : 0.0;
+}
+
+static double getIterationsPerSecond(const BenchmarkResult& result) {
+    return result.medianSeconds > 0.0 ? 1.0 / result.medianSeconds : 0.0;
+}
+
+/**
+ * @returns Cache misses per iteration, rounded to a whole number, or
+ * unavailable if hardware counters were not available.
+ */
+static std::string formatCacheMisses(const BenchmarkResult& result, const char* unavailable) {
+    if (result.cacheMisses < 0.0)
+        return unavailable;
+    std::ostringstream stream;
+    stream << std::llround(result.cacheMisses);
+    return stream.str();
+}
+
+static bool writeCsv(const std::string& location, const std::vector<BenchmarkResult>& results) {
+    std::ofstream file(location);
+    if (!file) {
+        LOG_ERROR(std::string("Failed to open file '").append(location).append("' for writing"));
+        return false;
+    }
+
+    file << "Atoms,Types,InteractionRange,CollisionForce,StartCondition,InstructionSet,Threads,Pairs,TypeRuns,NeighbourSkin,IterationsPerRebuild,"
+            "ReorderInterval,CacheMissesPerIteration,MedianMsPerIteration,MinMsPerIteration,IterationsPerSecond,NsPerAtomPair\n";
+    for (const BenchmarkResult& result : results) {
+        file << result.atoms << ',' << result.types << ',' << result.interactionRange << ',' << result.collisionForce << ','
+             << START_CONDITION_NAMES[result.startCondition] << ',' << getInstructionSetName(result.instructionSet) << ','
+             << result.threads << ',' << PAIR_MODE_NAMES[result.pairSymmetry] << ',' << TYPE_RUN_MODE_NAMES[result.typeRuns] << ','
+             << result.neighbourSkin << ',' << result.rebuildInterval << ',' << result.reorderInterval << ','
+             << formatCacheMisses(result, "") << ',' << result.medianSeconds * 1e3 << ',' << result.minSeconds * 1e3 << ','
+             << getIterationsPerSecond(result) << ',' << getNsPerPair(result) << '\n';
+    }
+    return (bool) file;
+}
+
+static bool writeJson(const std::string& location, const BenchmarkOptions& options,
+                      const std::vector<BenchmarkResult>& results) {
+    std::ofstream file(location);
+    if (!file) {
+        LOG_ERROR(std::string("Failed to open file '").append(location).append("' for writing"));
+        return false;
+    }
+
+    file << "{\n"
+         << "  \"width\": " << options.width << ",\n"
+         << "  \"height\": " << options.height << ",\n"
+         << "  \"dt\": " << options.dt << ",\n"
+         << "  \"warmUp\": " << options.warmUp << ",\n"
+         << "  \"iterations\": " << options.iterations << ",\n"
+         << "  \"repetitions\": " << options.repetitions << ",\n"
+         << "  \"seed\": " << options.seed << ",\n"
+         << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchmarkResult& result = results[i];
+        file << "    { \"atoms\": " << result.atoms
+             << ", \"types\": " << result.types
+             << ", \"interactionRange\": " << result.interactionRange
+             << ", \"collisionForce\": " << result.collisionForce
+             << ", \"startCondition\": \"" << START_CONDITION_NAMES[result.startCondition] << '"'
+             << ", \"instructionSet\": \"" << getInstructionSetName(result.instructionSet) << '"'
+             << ", \"threads\": " << result.threads
+             << ", \"pairs\": \"" << PAIR_MODE_NAMES[result.pairSymmetry] << '"'
+             << ", \"typeRuns\": " << (result.typeRuns ? "true" : "false")
+             << ", \"neighbourSkin\": " << result.neighbourSkin
+             << ", \"iterationsPerRebuild\": " << result.rebuildInterval
+             << ", \"reorderInterval\": " << result.reorderInterval
+             << ", \"cacheMissesPerIteration\": " << formatCacheMisses(result, "null")
+             << ", \"medianMsPerIteration\": " << result.medianSeconds * 1e3
+             << ", \"minMsPerIteration\": " << result.minSeconds * 1e3
+             << ", \"iterationsPerSecond\": " << getIterationsPerSecond(result)
+             << ", \"nsPerAtomPair\": " << getNsPerPair(result)
+             << (i + 1 < results.size() ? " },\n" : " }\n");
+    }
+    file << "  ]\n"
+         << "}\n";
+    return (bool) file;
+}
+
+int main(int argc, char* args[]) {
+    BenchmarkOptions options;
+    if (!parseArguments(argc, args, options)) {
+        printUsage(args[0]);
+        return -1;
+    }
+    if (!Logger::getLogger().isValid())
+        return -1;
+    LOG_MESSAGE("Begin benchmark execution");
+
+    if (!options.loadTypeCounts.empty()) {
+        std::printf("%5s %8s %10s %10s %10s %10s\n", "Types", "Lines", "Bytes", "ms/load", "min ms", "MB/s");
+        std::vector<LoadBenchmarkResult> loadResults;
+        for (unsigned int typeCount : options.loadTypeCounts) {
+            LoadBenchmarkResult result = runLoadBenchmark(options, typeCount);
+            std::printf("%5zu %8zu %10zu %10.3f %10.3f %10.1f\n",
+                        result.types, result.lines, result.bytes, result.medianSeconds * 1e3, result.minSeconds * 1e3,
+                        result.medianSeconds > 0.0 ? result.bytes / result.medianSeconds / 1e6 : 0.0);
+            loadResults.push_back(result);
+        }
+
+        bool success = writeLoadCsv(options.outputPrefix + "_load.csv", loadResults);
+        if (!success)
+            std::fprintf(stderr, "Failed to write output file '%s_load.csv'\n", options.outputPrefix.c_str());
+
+        LOG_MESSAGE("End benchmark execution");
+        return success ? 0 : -1;
+    }
+
+    if (!options.drawAtomCounts.empty()) {
+        // No backend, so only the font atlas needs building before a frame can be drawn
+        ImGui::CreateContext();
+        ImGuiIO& io = ImGui::GetIO();
+        io.IniFilename = nullptr;
+        io.DisplaySize = ImVec2(options.width, options.height);
+        io.Fonts->Build();
+
+        std::printf("%8s %-8s %10s %10s %8s %10s %10s %10s\n",
+                    "Atoms", "Method", "Vertices", "Indices", "Commands", "Upload KB", "ms/frame", "min ms");
+        std::vector<DrawBenchmarkResult> drawResults;
+        for (unsigned int atomCount : options.drawAtomCounts) {
+            for (bool sprites : { false, true }) {
+                DrawBenchmarkResult result = runDrawBenchmark(options, atomCount, sprites);
+                std::printf("%8zu %-8s %10zu %10zu %8zu %10.1f %10.3f %10.3f\n",
+                            result.atoms, DRAW_METHOD_NAMES[result.sprites], result.vertices, result.indices,
+                            result.drawCommands, getUploadKB(result), result.medianSeconds * 1e3, result.minSeconds * 1e3);
+                drawResults.push_back(result);
+            }
+        }
+        ImGui::DestroyContext();
+
+        bool success = writeDrawCsv(options.outputPrefix + "_draw.csv", drawResults);
+        if (!success)
+            std::fprintf(stderr, "Failed to write output file '%s_draw.csv'\n", options.outputPrefix.c_str());
+
+        LOG_MESSAGE("End benchmark execution");
+        return success ? 0 : -1;
+    }
+
+    std::printf("%6s %5s %7s %9s %-17s %-7s %7s %5s %4s %6s %8s %7s %12s %10s %10s %12s\n",
+                "Atoms", "Types", "Range", "Collision", "StartCondition", "ISA", "Threads", "Pairs", "Runs", "Skin", "it/build",
+                "Reorder", "misses/iter", "ms/iter", "it/s", "ns/pair");
+    std::vector<BenchmarkResult> results;
+    for (unsigned int atomCount : options.atomCounts)
+    for (unsigned int typeCount : options.typeCounts)
+    for (float interactionRange : options.interactionRanges)
+    for (float collisionForce : options.collisionForces)
+    for (StartCondition startCondition : options.startConditions)
+    for (InstructionSet instructionSet : options.instructionSets)
+    for (unsigned int threadCount : options.threadCounts)
+    for (bool pairSymmetry : options.pairSymmetries)
+    for (bool typeRuns : options.typeRuns)
+    for (float neighbourSkin : options.neighbourSkins)
+    for (unsigned int reorderInterval : options.reorderIntervals) {
+        BenchmarkResult result = runBenchmark(
+            options, atomCount, typeCount, interactionRange, collisionForce, startCondition, instructionSet, threadCount,
+            pairSymmetry, typeRuns, neighbourSkin, reorderInterval
+        );
+        std::printf("%6zu %5zu %7.1f %9.2f %-17s %-7s %7zu %5s %4s %6.1f %8.1f %7zu %12s %10.3f %10.1f %12.4f\n",
+                    result.atoms, result.types, result.interactionRange, result.collisionForce,
+                    START_CONDITION_NAMES[result.startCondition], getInstructionSetName(result.instructionSet), result.threads,
+                    PAIR_MODE_NAMES[result.pairSymmetry], TYPE_RUN_MODE_NAMES[result.typeRuns], result.neighbourSkin,
+                    result.rebuildInterval, result.reorderInterval, formatCacheMisses(result, "-").c_str(),
+                    result.medianSeconds * 1e3, getIterationsPerSecond(result), getNsPerPair(result));
+        results.push_back(result);
+    }
+
+    bool success = writeCsv(options.outputPrefix + ".csv", results)
+                && writeJson(options.outputPrefix + ".json", options, results);
+    if (!success)
+        std::fprintf(stderr, "Failed to write output files '%s.*'\n", options.outputPrefix.c_str());
+
+    LOG_MESSAGE("End benchmark execution");
+    return success ? 0 : -1;
+}
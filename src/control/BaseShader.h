@@ -27,12 +27,9 @@ public:
 
 	void setUniform(const std::string& location, GLfloat value);
 	void setUniform(const std::string& location, GLfloat value1, GLfloat value2);
+	void setUniform(const std::string& location, GLuint value);
 
 	[[nodiscard]] inline bool isValid() const { return mIsValid; }
-
-	static GLuint createBuffer(const GLvoid* data, GLsizeiptr size, GLuint binding);
-	static void readBuffer(GLuint bufferID, GLvoid* data, GLsizeiptr size);
-	static void writeBuffer(GLuint bufferID, GLvoid* data, GLsizeiptr size);
 protected:
 	GLuint mProgramID;
 	std::vector<GLuint> mShaders;
@@ -47,7 +44,6 @@ protected:
 	};
 	std::vector<ShaderPass> mShaderPasses;
 
-	static std::vector<GLuint> mBuffers;
 	static std::vector<GLuint> mPrograms;
 
 	const std::string SHADER_DIR = "shaders/";
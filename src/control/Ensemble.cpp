@@ -0,0 +1,70 @@
+#include "Ensemble.h"
+#ifndef ITERATE_ON_COMPUTE_SHADER
+
+#include <algorithm>
+
+Ensemble::Ensemble(size_t threadCount) :
+mThreadPool(threadCount), mMembers(), mTaskMembers(), mSplitMembers() {
+}
+
+void Ensemble::setThreadCount(size_t threadCount) {
+    mThreadPool.setThreadCount(std::min(std::max(threadCount, (size_t) 1), MAX_THREADS));
+}
+
+void Ensemble::setMemberCount(size_t count) {
+    if (count < mMembers.size()) {
+        mMembers.resize(count);
+        return;
+    }
+    mMembers.reserve(count);
+    while (mMembers.size() < count)
+        mMembers.push_back(std::make_unique<Member>());
+}
+
+void Ensemble::run(unsigned int iterations) {
+    mTaskMembers.clear();
+    mSplitMembers.clear();
+    for (size_t m = 0; m < mMembers.size(); m++) {
+        mMembers[m]->progress.store(0, std::memory_order_relaxed);
+        if (mMembers[m]->handler.getActualAtomCount() >= ENSEMBLE_SPLIT_ATOM_COUNT && getThreadCount() > 1)
+            mSplitMembers.push_back(m);
+        else
+            mTaskMembers.push_back(m);
+    }
+
+    mThreadPool.parallelFor(mTaskMembers.size(), [this, iterations](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; t++) {
+            Member& member = *mMembers[mTaskMembers[t]];
+            member.handler.setThreadCount(1);
+            runMember(member, iterations);
+        }
+    }, 1);
+
+    // The pool's workers sleep while the member's own workers run, so the
+    // cores are not oversubscribed
+    for (size_t m : mSplitMembers) {
+        Member& member = *mMembers[m];
+        member.handler.setThreadCount(getThreadCount());
+        runMember(member, iterations);
+        member.handler.setThreadCount(1);
+    }
+}
+
+unsigned int Ensemble::getProgress(size_t member) const {
+    return mMembers[member]->progress.load(std::memory_order_relaxed);
+}
+
+size_t Ensemble::getTotalProgress() const {
+    size_t total = 0;
+    for (const std::unique_ptr<Member>& member : mMembers)
+        total += member->progress.load(std::memory_order_relaxed);
+    return total;
+}
+
+void Ensemble::runMember(Member& member, unsigned int iterations) {
+    for (unsigned int i = 0; i < iterations; i++) {
+        member.handler.iterateSimulation();
+        member.progress.store(i + 1, std::memory_order_relaxed);
+    }
+}
+#endif
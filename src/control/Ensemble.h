@@ -0,0 +1,94 @@
+/**
+ * @file   Ensemble.h
+ * @brief  Runs many independent simulations concurrently.
+ *
+ * @author Stuart Lewis
+ * @date   January 2023
+ */
+#pragma once
+#ifndef ITERATE_ON_COMPUTE_SHADER
+#include "SimulationHandler.h"
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/** Members with at least this many atoms are split across every thread, rather than iterated as a single task. */
+const size_t ENSEMBLE_SPLIT_ATOM_COUNT = 8192;
+
+/**
+ * Set of independent simulations (members), such as the same configuration
+ * with different seeds or start conditions, iterated concurrently in one
+ * process.
+ *
+ * Each member is iterated on a single thread as one task of a shared
+ * ThreadPool, so idle threads pick up the next member and uneven members stay
+ * balanced. Members with at least ENSEMBLE_SPLIT_ATOM_COUNT atoms are instead
+ * iterated one at a time, split across every thread. The ensemble sets the
+ * thread count of each member accordingly.
+ *
+ * Members only hold the atoms they generate, and are kept when the member
+ * count changes, so running many batches reuses the same allocations.
+ */
+class Ensemble {
+public:
+    /**
+     * @param threadCount Number of threads to iterate members on (including
+     * the calling thread).
+     */
+    explicit Ensemble(size_t threadCount = 1);
+
+    void setThreadCount(size_t threadCount);
+    [[nodiscard]] inline size_t getThreadCount() const { return mThreadPool.getThreadCount(); }
+
+    /**
+     * Add or remove members so there are count. Existing members are kept as
+     * they are, and new members are default constructed. Must not be called
+     * during Ensemble::run.
+     */
+    void setMemberCount(size_t count);
+    [[nodiscard]] inline size_t getMemberCount() const { return mMembers.size(); }
+
+    [[nodiscard]] inline SimulationHandler& getMember(size_t member) { return mMembers[member]->handler; }
+    [[nodiscard]] inline const SimulationHandler& getMember(size_t member) const { return mMembers[member]->handler; }
+
+    /**
+     * Iterate every member iterations times. Blocks until every member is
+     * complete.
+     */
+    void run(unsigned int iterations);
+
+    /**
+     * Safe to call from other threads while Ensemble::run is in progress.
+     * @returns Number of iterations member has completed in the current (or
+     * last) run.
+     */
+    [[nodiscard]] unsigned int getProgress(size_t member) const;
+    /**
+     * Safe to call from other threads while Ensemble::run is in progress.
+     * @returns Total iterations completed by every member in the current (or
+     * last) run.
+     */
+    [[nodiscard]] size_t getTotalProgress() const;
+private:
+    struct Member {
+        SimulationHandler handler;
+        std::atomic<unsigned int> progress{ 0 };
+    };
+
+    /**
+     * Iterate member iterations times, recording its progress.
+     */
+    static void runMember(Member& member, unsigned int iterations);
+
+    ThreadPool mThreadPool;
+    std::vector<std::unique_ptr<Member>> mMembers;
+
+    /** Indices of the members run as single tasks (reused between runs). */
+    std::vector<size_t> mTaskMembers;
+    /** Indices of the members split across every thread (reused between runs). */
+    std::vector<size_t> mSplitMembers;
+};
+#endif
@@ -0,0 +1,811 @@
+#include "ForceKernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define FORCE_KERNELS_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define KERNEL_TARGET(isa)
+#else
+#define KERNEL_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+/**
+ * Find the shortest delta from atom B to atom A, wrapping around the edges of
+ * the simulation if Wrap is set (see KernelFeatureWrap).
+ * @returns true if B is within the interaction range of A, and not in exactly
+ * the same position.
+ */
+template<bool Wrap>
+static inline bool wrappedDelta(const ForceKernelParams& params, float ax, float ay, float bx, float by,
+                                float& dX, float& dY, float& d2) {
+    dX = ax - bx;
+    dY = ay - by;
+
+    if (Wrap) {
+        float dXAbs = std::abs(dX);
+        float dXAlt = params.simWidth - dXAbs;
+        dX = (dXAlt < dXAbs) ? dXAlt * (ax < bx ? 1.0f : -1.0f) : dX;
+
+        float dYAbs = std::abs(dY);
+        float dYAlt = params.simHeight - dYAbs;
+        dY = (dYAlt < dYAbs) ? dYAlt * (ay < by ? 1.0f : -1.0f) : dY;
+    }
+
+    if (dX == 0 && dY == 0)
+        return false;
+
+    d2 = dX * dX + dY * dY;
+    return d2 < params.interactionRange2;
+}
+
+/**
+ * @returns The force (per unit of delta) pushing apart two atoms d apart, if
+ * they overlap.
+ */
+static inline float collisionForce(const ForceKernelParams& params, float d) {
+    return (d < params.atomDiameter) ? (params.atomDiameter - d) * params.collisionForce / params.atomDiameter : 0.0f;
+}
+
+template<bool Collisions, bool Wrap, bool Gather>
+static void forceKernelScalar(const ForceKernelParams& params, float ax, float ay, const float* interactions,
+                              const float* bx, const float* by, const atom_type_id* bTypes, size_t count,
+                              float& fx, float& fy) {
+    float accX = fx;
+    float accY = fy;
+    for (size_t j = 0; j < count; j++) {
+        float dX, dY, d2;
+        if (wrappedDelta<Wrap>(params, ax, ay, bx[j], by[j], dX, dY, d2)) {
+            float g = interactions[Gather ? bTypes[j] : 0];
+            float d = std::sqrt(d2);
+            float f = g / d;
+            if (Collisions)
+                f += collisionForce(params, d);
+            accX += f * dX;
+            accY += f * dY;
+        }
+    }
+    fx = accX;
+    fy = accY;
+}
+
+template<bool Collisions, bool Wrap, bool Gather>
+static void pairForceKernelScalar(const ForceKernelParams& params, float ax, float ay,
+                                  const float* interactions, const float* reactions,
+                                  const float* bx, const float* by, const atom_type_id* bTypes, size_t count,
+                                  float& fx, float& fy, float* bFx, float* bFy) {
+    float accX = fx;
+    float accY = fy;
+    for (size_t j = 0; j < count; j++) {
+        float dX, dY, d2;
+        if (wrappedDelta<Wrap>(params, ax, ay, bx[j], by[j], dX, dY, d2)) {
+            atom_type_id type = Gather ? bTypes[j] : 0;
+            float d = std::sqrt(d2);
+            float f  = interactions[type] / d;
+            float fB = reactions[type] / d;
+            if (Collisions) {
+                float collision = collisionForce(params, d);
+                f  += collision;
+                fB += collision;
+            }
+            accX += f * dX;
+            accY += f * dY;
+            // The delta from B to A is exactly -delta, so B is pushed back along the same line
+            bFx[j] -= fB * dX;
+            bFy[j] -= fB * dY;
+        }
+    }
+    fx = accX;
+    fy = accY;
+}
+
+template<bool Collisions, bool Wrap>
+static void runForceKernelScalar(const ForceKernelParams& params, float ax, float ay, const float* interactions,
+                                 const float* bx, const float* by, const unsigned int* runStarts, size_t runCount,
+                                 size_t begin, float& fx, float& fy) {
+    // With the interaction value constant, each pair only needs one division
+    float collisionScale = params.collisionForce / params.atomDiameter;
+    float accX = fx;
+    float accY = fy;
+    for (size_t t = 0; t < runCount; t++) {
+        float g = interactions[t];
+        // Without collisions, atoms which do not interact exert no force at all
+        if (!Collisions && g == 0.0f)
+            continue;
+        for (size_t j = std::max((size_t) runStarts[t], begin); j < runStarts[t + 1]; j++) {
+            float dX, dY, d2;
+            if (wrappedDelta<Wrap>(params, ax, ay, bx[j], by[j], dX, dY, d2)) {
+                float d = std::sqrt(d2);
+                float collision = (Collisions && d < params.atomDiameter) ? (params.atomDiameter - d) * collisionScale : 0.0f;
+                float f = g * (1.0f / d) + collision;
+                accX += f * dX;
+                accY += f * dY;
+            }
+        }
+    }
+    fx = accX;
+    fy = accY;
+}
+
+template<bool Collisions, bool Wrap>
+static void pairRunForceKernelScalar(const ForceKernelParams& params, float ax, float ay,
+                                     const float* interactions, const float* reactions,
+                                     const float* bx, const float* by, const unsigned int* runStarts, size_t runCount,
+                                     size_t begin, float& fx, float& fy, float* bFx, float* bFy) {
+    float collisionScale = params.collisionForce / params.atomDiameter;
+    float accX = fx;
+    float accY = fy;
+    for (size_t t = 0; t < runCount; t++) {
+        float g = interactions[t];
+        float gB = reactions[t];
+        if (!Collisions && g == 0.0f && gB == 0.0f)
+            continue;
+        for (size_t j = std::max((size_t) runStarts[t], begin); j < runStarts[t + 1]; j++) {
+            float dX, dY, d2;
+            if (wrappedDelta<Wrap>(params, ax, ay, bx[j], by[j], dX, dY, d2)) {
+                float d = std::sqrt(d2);
+                float invD = 1.0f / d;
+                float collision = (Collisions && d < params.atomDiameter) ? (params.atomDiameter - d) * collisionScale : 0.0f;
+                float f  = g * invD + collision;
+                float fB = gB * invD + collision;
+                accX += f * dX;
+                accY += f * dY;
+                bFx[j] -= fB * dX;
+                bFy[j] -= fB * dY;
+            }
+        }
+    }
+    fx = accX;
+    fy = accY;
+}
+
+#ifdef FORCE_KERNELS_X86
+/**
+ * Simulation parameters and the position of atom A, broadcast across every
+ * lane for the AVX2 kernels.
+ */
+struct KernelConstantsAVX2 {
+    __m256 zero;
+    __m256 one;
+    __m256 minusOne;
+    __m256 absMask;
+
+    __m256 simWidth;
+    __m256 simHeight;
+    __m256 interactionRange2;
+    __m256 atomDiameter;
+    __m256 collisionForce;
+    /** collisionForce / atomDiameter, so the run kernels can multiply rather than divide. */
+    __m256 collisionScale;
+
+    __m256 aX;
+    __m256 aY;
+};
+
+KERNEL_TARGET("avx2")
+static inline KernelConstantsAVX2 getKernelConstantsAVX2(const ForceKernelParams& params, float ax, float ay) {
+    return KernelConstantsAVX2{
+        _mm256_setzero_ps(), _mm256_set1_ps(1.0f), _mm256_set1_ps(-1.0f),
+        _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF)),
+        _mm256_set1_ps(params.simWidth), _mm256_set1_ps(params.simHeight), _mm256_set1_ps(params.interactionRange2),
+        _mm256_set1_ps(params.atomDiameter), _mm256_set1_ps(params.collisionForce),
+        _mm256_set1_ps(params.collisionForce / params.atomDiameter),
+        _mm256_set1_ps(ax), _mm256_set1_ps(ay)
+    };
+}
+
+/**
+ * As wrappedDelta, for 8 atoms at a time.
+ * @returns Mask of the lanes within the interaction range.
+ */
+template<bool Wrap>
+KERNEL_TARGET("avx2")
+static inline __m256 wrappedDeltaAVX2(const KernelConstantsAVX2& k, __m256 bX, __m256 bY,
+                                      __m256& dX, __m256& dY, __m256& d2) {
+    dX = _mm256_sub_ps(k.aX, bX);
+    dY = _mm256_sub_ps(k.aY, bY);
+
+    if (Wrap) {
+        __m256 dXAbs  = _mm256_and_ps(dX, k.absMask);
+        __m256 dXAlt  = _mm256_sub_ps(k.simWidth, dXAbs);
+        __m256 dXSign = _mm256_blendv_ps(k.minusOne, k.one, _mm256_cmp_ps(k.aX, bX, _CMP_LT_OQ));
+        dX = _mm256_blendv_ps(dX, _mm256_mul_ps(dXAlt, dXSign), _mm256_cmp_ps(dXAlt, dXAbs, _CMP_LT_OQ));
+
+        __m256 dYAbs  = _mm256_and_ps(dY, k.absMask);
+        __m256 dYAlt  = _mm256_sub_ps(k.simHeight, dYAbs);
+        __m256 dYSign = _mm256_blendv_ps(k.minusOne, k.one, _mm256_cmp_ps(k.aY, bY, _CMP_LT_OQ));
+        dY = _mm256_blendv_ps(dY, _mm256_mul_ps(dYAlt, dYSign), _mm256_cmp_ps(dYAlt, dYAbs, _CMP_LT_OQ));
+    }
+
+    d2 = _mm256_add_ps(_mm256_mul_ps(dX, dX), _mm256_mul_ps(dY, dY));
+    return _mm256_and_ps(
+        _mm256_cmp_ps(d2, k.interactionRange2, _CMP_LT_OQ),
+        _mm256_or_ps(_mm256_cmp_ps(dX, k.zero, _CMP_NEQ_OQ), _mm256_cmp_ps(dY, k.zero, _CMP_NEQ_OQ))
+    );
+}
+
+/** As collisionForce, for 8 atoms at a time. */
+KERNEL_TARGET("avx2")
+static inline __m256 collisionForceAVX2(const KernelConstantsAVX2& k, __m256 d) {
+    __m256 collision = _mm256_div_ps(_mm256_mul_ps(_mm256_sub_ps(k.atomDiameter, d), k.collisionForce), k.atomDiameter);
+    return _mm256_and_ps(collision, _mm256_cmp_ps(d, k.atomDiameter, _CMP_LT_OQ));
+}
+
+/** As collisionForceAVX2, multiplying by collisionScale rather than dividing. */
+KERNEL_TARGET("avx2")
+static inline __m256 scaledCollisionForceAVX2(const KernelConstantsAVX2& k, __m256 d) {
+    __m256 collision = _mm256_mul_ps(_mm256_sub_ps(k.atomDiameter, d), k.collisionScale);
+    return _mm256_and_ps(collision, _mm256_cmp_ps(d, k.atomDiameter, _CMP_LT_OQ));
+}
+
+/**
+ * @returns Mask of the first count lanes (all of them if count is 8 or more).
+ */
+KERNEL_TARGET("avx2")
+static inline __m256 laneMaskAVX2(size_t count) {
+    __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    return _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32((int) std::min(count, (size_t) 8)), lanes));
+}
+
+KERNEL_TARGET("avx2")
+static inline float horizontalSum(__m256 v) {
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum);
+}
+
+template<bool Collisions, bool Wrap, bool Gather>
+KERNEL_TARGET("avx2")
+static void forceKernelAVX2(const ForceKernelParams& params, float ax, float ay, const float* interactions,
+                            const float* bx, const float* by, const atom_type_id* bTypes, size_t count,
+                            float& fx, float& fy) {
+    const KernelConstantsAVX2 k = getKernelConstantsAVX2(params, ax, ay);
+    __m256 accX = k.zero;
+    __m256 accY = k.zero;
+
+    size_t j = 0;
+    for (; j + 8 <= count; j += 8) {
+        __m256 dX, dY, d2;
+        __m256 mask = wrappedDeltaAVX2<Wrap>(k, _mm256_loadu_ps(bx + j), _mm256_loadu_ps(by + j), dX, dY, d2);
+        if (_mm256_movemask_ps(mask) == 0)
+            continue;
+
+        __m256 g = Gather ? _mm256_i32gather_ps(interactions, _mm256_loadu_si256((const __m256i*) (bTypes + j)), 4)
+                          : _mm256_set1_ps(interactions[0]);
+        __m256 d = _mm256_sqrt_ps(d2);
+        __m256 f = _mm256_div_ps(g, d);
+        if (Collisions)
+            f = _mm256_add_ps(f, collisionForceAVX2(k, d));
+        f = _mm256_and_ps(f, mask);
+
+        accX = _mm256_add_ps(accX, _mm256_mul_ps(f, dX));
+        accY = _mm256_add_ps(accY, _mm256_mul_ps(f, dY));
+    }
+    fx += horizontalSum(accX);
+    fy += horizontalSum(accY);
+
+    forceKernelScalar<Collisions, Wrap, Gather>(params, ax, ay, interactions, bx + j, by + j, bTypes + j, count - j, fx, fy);
+}
+
+template<bool Collisions, bool Wrap, bool Gather>
+KERNEL_TARGET("avx2")
+static void pairForceKernelAVX2(const ForceKernelParams& params, float ax, float ay,
+                                const float* interactions, const float* reactions,
+                                const float* bx, const float* by, const atom_type_id* bTypes, size_t count,
+                                float& fx, float& fy, float* bFx, float* bFy) {
+    const KernelConstantsAVX2 k = getKernelConstantsAVX2(params, ax, ay);
+    __m256 accX = k.zero;
+    __m256 accY = k.zero;
+
+    size_t j = 0;
+    for (; j + 8 <= count; j += 8) {
+        __m256 dX, dY, d2;
+        __m256 mask = wrappedDeltaAVX2<Wrap>(k, _mm256_loadu_ps(bx + j), _mm256_loadu_ps(by + j), dX, dY, d2);
+        if (_mm256_movemask_ps(mask) == 0)
+            continue;
+
+        __m256 g, gB;
+        if (Gather) {
+            __m256i types = _mm256_loadu_si256((const __m256i*) (bTypes + j));
+            g  = _mm256_i32gather_ps(interactions, types, 4);
+            gB = _mm256_i32gather_ps(reactions, types, 4);
+        } else {
+            g  = _mm256_set1_ps(interactions[0]);
+            gB = _mm256_set1_ps(reactions[0]);
+        }
+        __m256 d = _mm256_sqrt_ps(d2);
+        __m256 f  = _mm256_div_ps(g, d);
+        __m256 fB = _mm256_div_ps(gB, d);
+        if (Collisions) {
+            __m256 collision = collisionForceAVX2(k, d);
+            f  = _mm256_add_ps(f, collision);
+            fB = _mm256_add_ps(fB, collision);
+        }
+        f  = _mm256_and_ps(f, mask);
+        fB = _mm256_and_ps(fB, mask);
+
+        accX = _mm256_add_ps(accX, _mm256_mul_ps(f, dX));
+        accY = _mm256_add_ps(accY, _mm256_mul_ps(f, dY));
+        _mm256_storeu_ps(bFx + j, _mm256_sub_ps(_mm256_loadu_ps(bFx + j), _mm256_mul_ps(fB, dX)));
+        _mm256_storeu_ps(bFy + j, _mm256_sub_ps(_mm256_loadu_ps(bFy + j), _mm256_mul_ps(fB, dY)));
+    }
+    fx += horizontalSum(accX);
+    fy += horizontalSum(accY);
+
+    pairForceKernelScalar<Collisions, Wrap, Gather>(params, ax, ay, interactions, reactions, bx + j, by + j, bTypes + j,
+                                                    count - j, fx, fy, bFx + j, bFy + j);
+}
+
+template<bool Collisions, bool Wrap>
+KERNEL_TARGET("avx2")
+static void runForceKernelAVX2(const ForceKernelParams& params, float ax, float ay, const float* interactions,
+                               const float* bx, const float* by, const unsigned int* runStarts, size_t runCount,
+                               size_t begin, float& fx, float& fy) {
+    const KernelConstantsAVX2 k = getKernelConstantsAVX2(params, ax, ay);
+    __m256 accX = k.zero;
+    __m256 accY = k.zero;
+
+    for (size_t t = 0; t < runCount; t++) {
+        if (!Collisions && interactions[t] == 0.0f)
+            continue;
+        size_t end = runStarts[t + 1];
+        __m256 g = _mm256_set1_ps(interactions[t]);
+        // Masked loads handle the tail of each run, so runs share one accumulator
+        for (size_t j = std::max((size_t) runStarts[t], begin); j < end; j += 8) {
+            __m256 lanes = laneMaskAVX2(end - j);
+            __m256 bX = _mm256_maskload_ps(bx + j, _mm256_castps_si256(lanes));
+            __m256 bY = _mm256_maskload_ps(by + j, _mm256_castps_si256(lanes));
+            __m256 dX, dY, d2;
+            __m256 mask = _mm256_and_ps(wrappedDeltaAVX2<Wrap>(k, bX, bY, dX, dY, d2), lanes);
+            if (_mm256_movemask_ps(mask) == 0)
+                continue;
+
+            // With g constant, each pair only needs one division
+            __m256 d = _mm256_sqrt_ps(d2);
+            __m256 invD = _mm256_div_ps(k.one, d);
+            __m256 f = _mm256_mul_ps(g, invD);
+            if (Collisions)
+                f = _mm256_add_ps(f, scaledCollisionForceAVX2(k, d));
+            f = _mm256_and_ps(f, mask);
+
+            accX = _mm256_add_ps(accX, _mm256_mul_ps(f, dX));
+            accY = _mm256_add_ps(accY, _mm256_mul_ps(f, dY));
+        }
+    }
+    fx += horizontalSum(accX);
+    fy += horizontalSum(accY);
+}
+
+template<bool Collisions, bool Wrap>
+KERNEL_TARGET("avx2")
+static void pairRunForceKernelAVX2(const ForceKernelParams& params, float ax, float ay,
+                                   const float* interactions, const float* reactions,
+                                   const float* bx, const float* by, const unsigned int* runStarts, size_t runCount,
+                                   size_t begin, float& fx, float& fy, float* bFx, float* bFy) {
+    const KernelConstantsAVX2 k = getKernelConstantsAVX2(params, ax, ay);
+    __m256 accX = k.zero;
+    __m256 accY = k.zero;
+
+    for (size_t t = 0; t < runCount; t++) {
+        if (!Collisions && interactions[t] == 0.0f && reactions[t] == 0.0f)
+            continue;
+        size_t end = runStarts[t + 1];
+        __m256 g  = _mm256_set1_ps(interactions[t]);
+        __m256 gB = _mm256_set1_ps(reactions[t]);
+        for (size_t j = std::max((size_t) runStarts[t], begin); j < end; j += 8) {
+            __m256i lanes = _mm256_castps_si256(laneMaskAVX2(end - j));
+            __m256 bX = _mm256_maskload_ps(bx + j, lanes);
+            __m256 bY = _mm256_maskload_ps(by + j, lanes);
+            __m256 dX, dY, d2;
+            __m256 mask = _mm256_and_ps(wrappedDeltaAVX2<Wrap>(k, bX, bY, dX, dY, d2), _mm256_castsi256_ps(lanes));
+            if (_mm256_movemask_ps(mask) == 0)
+                continue;
+
+            __m256 d = _mm256_sqrt_ps(d2);
+            __m256 invD = _mm256_div_ps(k.one, d);
+            __m256 f  = _mm256_mul_ps(g, invD);
+            __m256 fB = _mm256_mul_ps(gB, invD);
+            if (Collisions) {
+                __m256 collision = scaledCollisionForceAVX2(k, d);
+                f  = _mm256_add_ps(f, collision);
+                fB = _mm256_add_ps(fB, collision);
+            }
+            f  = _mm256_and_ps(f, mask);
+            fB = _mm256_and_ps(fB, mask);
+
+            accX = _mm256_add_ps(accX, _mm256_mul_ps(f, dX));
+            accY = _mm256_add_ps(accY, _mm256_mul_ps(f, dY));
+            __m256 bFX = _mm256_maskload_ps(bFx + j, lanes);
+            __m256 bFY = _mm256_maskload_ps(bFy + j, lanes);
+            _mm256_maskstore_ps(bFx + j, lanes, _mm256_sub_ps(bFX, _mm256_mul_ps(fB, dX)));
+            _mm256_maskstore_ps(bFy + j, lanes, _mm256_sub_ps(bFY, _mm256_mul_ps(fB, dY)));
+        }
+    }
+    fx += horizontalSum(accX);
+    fy += horizontalSum(accY);
+}
+
+// GCC's AVX-512 intrinsics (e.g. _mm512_sqrt_ps, _mm512_reduce_add_ps) pass
+// their own _mm*_undefined_* placeholders through, which it then reports as
+// uninitialized in every kernel they are inlined into
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+/**
+ * Simulation parameters and the position of atom A, broadcast across every
+ * lane for the AVX-512 kernels.
+ */
+struct KernelConstantsAVX512 {
+    __m512 zero;
+    __m512 one;
+    __m512 minusOne;
+
+    __m512 simWidth;
+    __m512 simHeight;
+    __m512 interactionRange2;
+    __m512 atomDiameter;
+    __m512 collisionForce;
+    /** collisionForce / atomDiameter, so the run kernels can multiply rather than divide. */
+    __m512 collisionScale;
+
+    __m512 aX;
+    __m512 aY;
+};
+
+KERNEL_TARGET("avx512f")
+static inline KernelConstantsAVX512 getKernelConstantsAVX512(const ForceKernelParams& params, float ax, float ay) {
+    return KernelConstantsAVX512{
+        _mm512_setzero_ps(), _mm512_set1_ps(1.0f), _mm512_set1_ps(-1.0f),
+        _mm512_set1_ps(params.simWidth), _mm512_set1_ps(params.simHeight), _mm512_set1_ps(params.interactionRange2),
+        _mm512_set1_ps(params.atomDiameter), _mm512_set1_ps(params.collisionForce),
+        _mm512_set1_ps(params.collisionForce / params.atomDiameter),
+        _mm512_set1_ps(ax), _mm512_set1_ps(ay)
+    };
+}
+
+/**
+ * As wrappedDelta, for 16 atoms at a time.
+ * @returns Mask of the lanes within the interaction range.
+ */
+template<bool Wrap>
+KERNEL_TARGET("avx512f")
+static inline __mmask16 wrappedDeltaAVX512(const KernelConstantsAVX512& k, __m512 bX, __m512 bY,
+                                           __m512& dX, __m512& dY, __m512& d2) {
+    dX = _mm512_sub_ps(k.aX, bX);
+    dY = _mm512_sub_ps(k.aY, bY);
+
+    if (Wrap) {
+        __m512 dXAbs  = _mm512_abs_ps(dX);
+        __m512 dXAlt  = _mm512_sub_ps(k.simWidth, dXAbs);
+        __m512 dXSign = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(k.aX, bX, _CMP_LT_OQ), k.minusOne, k.one);
+        dX = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(dXAlt, dXAbs, _CMP_LT_OQ), dX, _mm512_mul_ps(dXAlt, dXSign));
+
+        __m512 dYAbs  = _mm512_abs_ps(dY);
+        __m512 dYAlt  = _mm512_sub_ps(k.simHeight, dYAbs);
+        __m512 dYSign = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(k.aY, bY, _CMP_LT_OQ), k.minusOne, k.one);
+        dY = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(dYAlt, dYAbs, _CMP_LT_OQ), dY, _mm512_mul_ps(dYAlt, dYSign));
+    }
+
+    d2 = _mm512_add_ps(_mm512_mul_ps(dX, dX), _mm512_mul_ps(dY, dY));
+    return _mm512_cmp_ps_mask(d2, k.interactionRange2, _CMP_LT_OQ)
+         & (_mm512_cmp_ps_mask(dX, k.zero, _CMP_NEQ_OQ) | _mm512_cmp_ps_mask(dY, k.zero, _CMP_NEQ_OQ));
+}
+
+/**
+ * Add the collision force (see collisionForce) to the lanes of f where the
+ * atoms overlap.
+ */
+KERNEL_TARGET("avx512f")
+static inline __m512 addCollisionForceAVX512(const KernelConstantsAVX512& k, __m512 f, __m512 d, __m512 collision) {
+    return _mm512_mask_add_ps(f, _mm512_cmp_ps_mask(d, k.atomDiameter, _CMP_LT_OQ), f, collision);
+}
+
+KERNEL_TARGET("avx512f")
+static inline __m512 collisionForceAVX512(const KernelConstantsAVX512& k, __m512 d) {
+    return _mm512_div_ps(_mm512_mul_ps(_mm512_sub_ps(k.atomDiameter, d), k.collisionForce), k.atomDiameter);
+}
+
+/** As collisionForceAVX512, multiplying by collisionScale rather than dividing. */
+KERNEL_TARGET("avx512f")
+static inline __m512 scaledCollisionForceAVX512(const KernelConstantsAVX512& k, __m512 d) {
+    return _mm512_mul_ps(_mm512_sub_ps(k.atomDiameter, d), k.collisionScale);
+}
+
+/**
+ * @returns Mask of the first count lanes (all of them if count is 16 or more).
+ */
+static inline __mmask16 laneMaskAVX512(size_t count) {
+    return (count >= 16) ? (__mmask16) 0xFFFF : (__mmask16) ((1u << count) - 1u);
+}
+
+template<bool Collisions, bool Wrap, bool Gather>
+KERNEL_TARGET("avx512f")
+static void forceKernelAVX512(const ForceKernelParams& params, float ax, float ay, const float* interactions,
+                              const float* bx, const float* by, const atom_type_id* bTypes, size_t count,
+                              float& fx, float& fy) {
+    const KernelConstantsAVX512 k = getKernelConstantsAVX512(params, ax, ay);
+    __m512 accX = k.zero;
+    __m512 accY = k.zero;
+
+    for (size_t j = 0; j < count; j += 16) {
+        // Masked loads handle the tail, so no scalar remainder loop is needed
+        __mmask16 lanes = laneMaskAVX512(count - j);
+        __m512 bX = _mm512_maskz_loadu_ps(lanes, bx + j);
+        __m512 bY = _mm512_maskz_loadu_ps(lanes, by + j);
+        __m512 dX, dY, d2;
+        __mmask16 mask = lanes & wrappedDeltaAVX512<Wrap>(k, bX, bY, dX, dY, d2);
+        if (mask == 0)
+            continue;
+
+        __m512 g;
+        if (Gather) {
+            __m512i types = _mm512_maskz_loadu_epi32(mask, bTypes + j);
+            g = _mm512_mask_i32gather_ps(k.zero, mask, types, interactions, 4);
+        } else {
+            g = _mm512_set1_ps(interactions[0]);
+        }
+        __m512 d = _mm512_sqrt_ps(d2);
+        __m512 f = _mm512_div_ps(g, d);
+        if (Collisions)
+            f = addCollisionForceAVX512(k, f, d, collisionForceAVX512(k, d));
+
+        accX = _mm512_mask_add_ps(accX, mask, accX, _mm512_mul_ps(f, dX));
+        accY = _mm512_mask_add_ps(accY, mask, accY, _mm512_mul_ps(f, dY));
+    }
+    fx += _mm512_reduce_add_ps(accX);
+    fy += _mm512_reduce_add_ps(accY);
+}
+
+template<bool Collisions, bool Wrap, bool Gather>
+KERNEL_TARGET("avx512f")
+static void pairForceKernelAVX512(const ForceKernelParams& params, float ax, float ay,
+                                  const float* interactions, const float* reactions,
+                                  const float* bx, const float* by, const atom_type_id* bTypes, size_t count,
+                                  float& fx, float& fy, float* bFx, float* bFy) {
+    const KernelConstantsAVX512 k = getKernelConstantsAVX512(params, ax, ay);
+    __m512 accX = k.zero;
+    __m512 accY = k.zero;
+
+    for (size_t j = 0; j < count; j += 16) {
+        __mmask16 lanes = laneMaskAVX512(count - j);
+        __m512 bX = _mm512_maskz_loadu_ps(lanes, bx + j);
+        __m512 bY = _mm512_maskz_loadu_ps(lanes, by + j);
+        __m512 dX, dY, d2;
+        __mmask16 mask = lanes & wrappedDeltaAVX512<Wrap>(k, bX, bY, dX, dY, d2);
+        if (mask == 0)
+            continue;
+
+        __m512 g, gB;
+        if (Gather) {
+            __m512i types = _mm512_maskz_loadu_epi32(mask, bTypes + j);
+            g  = _mm512_mask_i32gather_ps(k.zero, mask, types, interactions, 4);
+            gB = _mm512_mask_i32gather_ps(k.zero, mask, types, reactions, 4);
+        } else {
+            g  = _mm512_set1_ps(interactions[0]);
+            gB = _mm512_set1_ps(reactions[0]);
+        }
+        __m512 d = _mm512_sqrt_ps(d2);
+        __m512 f  = _mm512_div_ps(g, d);
+        __m512 fB = _mm512_div_ps(gB, d);
+        if (Collisions) {
+            __m512 collision = collisionForceAVX512(k, d);
+            f  = addCollisionForceAVX512(k, f, d, collision);
+            fB = addCollisionForceAVX512(k, fB, d, collision);
+        }
+
+        accX = _mm512_mask_add_ps(accX, mask, accX, _mm512_mul_ps(f, dX));
+        accY = _mm512_mask_add_ps(accY, mask, accY, _mm512_mul_ps(f, dY));
+        __m512 bFX = _mm512_maskz_loadu_ps(mask, bFx + j);
+        __m512 bFY = _mm512_maskz_loadu_ps(mask, bFy + j);
+        _mm512_mask_storeu_ps(bFx + j, mask, _mm512_sub_ps(bFX, _mm512_mul_ps(fB, dX)));
+        _mm512_mask_storeu_ps(bFy + j, mask, _mm512_sub_ps(bFY, _mm512_mul_ps(fB, dY)));
+    }
+    fx += _mm512_reduce_add_ps(accX);
+    fy += _mm512_reduce_add_ps(accY);
+}
+
+template<bool Collisions, bool Wrap>
+KERNEL_TARGET("avx512f")
+static void runForceKernelAVX512(const ForceKernelParams& params, float ax, float ay, const float* interactions,
+                                 const float* bx, const float* by, const unsigned int* runStarts, size_t runCount,
+                                 size_t begin, float& fx, float& fy) {
+    const KernelConstantsAVX512 k = getKernelConstantsAVX512(params, ax, ay);
+    __m512 accX = k.zero;
+    __m512 accY = k.zero;
+
+    for (size_t t = 0; t < runCount; t++) {
+        if (!Collisions && interactions[t] == 0.0f)
+            continue;
+        size_t end = runStarts[t + 1];
+        __m512 g = _mm512_set1_ps(interactions[t]);
+        for (size_t j = std::max((size_t) runStarts[t], begin); j < end; j += 16) {
+            __mmask16 lanes = laneMaskAVX512(end - j);
+            __m512 bX = _mm512_maskz_loadu_ps(lanes, bx + j);
+            __m512 bY = _mm512_maskz_loadu_ps(lanes, by + j);
+            __m512 dX, dY, d2;
+            __mmask16 mask = lanes & wrappedDeltaAVX512<Wrap>(k, bX, bY, dX, dY, d2);
+            if (mask == 0)
+                continue;
+
+            // With g constant, each pair only needs one division
+            __m512 d = _mm512_sqrt_ps(d2);
+            __m512 invD = _mm512_div_ps(k.one, d);
+            __m512 f = _mm512_mul_ps(g, invD);
+            if (Collisions)
+                f = addCollisionForceAVX512(k, f, d, scaledCollisionForceAVX512(k, d));
+
+            accX = _mm512_mask_add_ps(accX, mask, accX, _mm512_mul_ps(f, dX));
+            accY = _mm512_mask_add_ps(accY, mask, accY, _mm512_mul_ps(f, dY));
+        }
+    }
+    fx += _mm512_reduce_add_ps(accX);
+    fy += _mm512_reduce_add_ps(accY);
+}
+
+template<bool Collisions, bool Wrap>
+KERNEL_TARGET("avx512f")
+static void pairRunForceKernelAVX512(const ForceKernelParams& params, float ax, float ay,
+                                     const float* interactions, const float* reactions,
+                                     const float* bx, const float* by, const unsigned int* runStarts, size_t runCount,
+                                     size_t begin, float& fx, float& fy, float* bFx, float* bFy) {
+    const KernelConstantsAVX512 k = getKernelConstantsAVX512(params, ax, ay);
+    __m512 accX = k.zero;
+    __m512 accY = k.zero;
+
+    for (size_t t = 0; t < runCount; t++) {
+        if (!Collisions && interactions[t] == 0.0f && reactions[t] == 0.0f)
+            continue;
+        size_t end = runStarts[t + 1];
+        __m512 g  = _mm512_set1_ps(interactions[t]);
+        __m512 gB = _mm512_set1_ps(reactions[t]);
+        for (size_t j = std::max((size_t) runStarts[t], begin); j < end; j += 16) {
+            __mmask16 lanes = laneMaskAVX512(end - j);
+            __m512 bX = _mm512_maskz_loadu_ps(lanes, bx + j);
+            __m512 bY = _mm512_maskz_loadu_ps(lanes, by + j);
+            __m512 dX, dY, d2;
+            __mmask16 mask = lanes & wrappedDeltaAVX512<Wrap>(k, bX, bY, dX, dY, d2);
+            if (mask == 0)
+                continue;
+
+            __m512 d = _mm512_sqrt_ps(d2);
+            __m512 invD = _mm512_div_ps(k.one, d);
+            __m512 f  = _mm512_mul_ps(g, invD);
+            __m512 fB = _mm512_mul_ps(gB, invD);
+            if (Collisions) {
+                __m512 collision = scaledCollisionForceAVX512(k, d);
+                f  = addCollisionForceAVX512(k, f, d, collision);
+                fB = addCollisionForceAVX512(k, fB, d, collision);
+            }
+
+            accX = _mm512_mask_add_ps(accX, mask, accX, _mm512_mul_ps(f, dX));
+            accY = _mm512_mask_add_ps(accY, mask, accY, _mm512_mul_ps(f, dY));
+            __m512 bFX = _mm512_maskz_loadu_ps(mask, bFx + j);
+            __m512 bFY = _mm512_maskz_loadu_ps(mask, bFy + j);
+            _mm512_mask_storeu_ps(bFx + j, mask, _mm512_sub_ps(bFX, _mm512_mul_ps(fB, dX)));
+            _mm512_mask_storeu_ps(bFy + j, mask, _mm512_sub_ps(bFY, _mm512_mul_ps(fB, dY)));
+        }
+    }
+    fx += _mm512_reduce_add_ps(accX);
+    fy += _mm512_reduce_add_ps(accY);
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+/**
+ * Query CPUID (and the OS's saved register state) for AVX2/AVX-512F support.
+ */
+static bool cpuSupports(InstructionSet instructionSet) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+
+    __cpuid(info, 1);
+    bool osxsave = (info[2] >> 27) & 1;
+    bool avx     = (info[2] >> 28) & 1;
+    if (!osxsave || !avx)
+        return false;
+    unsigned long long xcr0 = _xgetbv(0);
+
+    __cpuidex(info, 7, 0);
+    switch (instructionSet) {
+        case InstructionSetAVX2  : return (xcr0 & 0x06) == 0x06 && ((info[1] >> 5 ) & 1);
+        case InstructionSetAVX512: return (xcr0 & 0xE6) == 0xE6 && ((info[1] >> 16) & 1);
+        default                  : return false;
+    }
+#else
+    __builtin_cpu_init();
+    switch (instructionSet) {
+        case InstructionSetAVX2  : return __builtin_cpu_supports("avx2");
+        case InstructionSetAVX512: return __builtin_cpu_supports("avx512f");
+        default                  : return false;
+    }
+#endif
+}
+#endif
+
+bool isInstructionSetSupported(InstructionSet instructionSet) {
+    switch (instructionSet) {
+        case InstructionSetScalar: return true;
+#ifdef FORCE_KERNELS_X86
+        case InstructionSetAVX2  :
+        case InstructionSetAVX512: {
+            static const bool supported[InstructionSetMax] = {
+                true, cpuSupports(InstructionSetAVX2), cpuSupports(InstructionSetAVX512)
+            };
+            return supported[instructionSet];
+        }
+#endif
+        default: return false;
+    }
+}
+
+InstructionSet getBestInstructionSet() {
+    if (isInstructionSetSupported(InstructionSetAVX512))
+        return InstructionSetAVX512;
+    if (isInstructionSetSupported(InstructionSetAVX2))
+        return InstructionSetAVX2;
+    return InstructionSetScalar;
+}
+
+/**
+ * @returns The kernels of instructionSet specialised for the KernelFeature
+ * combination Features.
+ */
+template<unsigned int Features>
+static ForceKernelSet getSpecialisedKernels(InstructionSet instructionSet) {
+    constexpr bool c = (Features & KernelFeatureCollisions) != 0;
+    constexpr bool w = (Features & KernelFeatureWrap) != 0;
+    constexpr bool g = (Features & KernelFeatureGather) != 0;
+    switch (instructionSet) {
+#ifdef FORCE_KERNELS_X86
+        case InstructionSetAVX2  :
+            return ForceKernelSet{
+                &forceKernelAVX2<c, w, g>, &pairForceKernelAVX2<c, w, g>,
+                &runForceKernelAVX2<c, w>, &pairRunForceKernelAVX2<c, w>
+            };
+        case InstructionSetAVX512:
+            return ForceKernelSet{
+                &forceKernelAVX512<c, w, g>, &pairForceKernelAVX512<c, w, g>,
+                &runForceKernelAVX512<c, w>, &pairRunForceKernelAVX512<c, w>
+            };
+#endif
+        default                  :
+            return ForceKernelSet{
+                &forceKernelScalar<c, w, g>, &pairForceKernelScalar<c, w, g>,
+                &runForceKernelScalar<c, w>, &pairRunForceKernelScalar<c, w>
+            };
+    }
+}
+
+ForceKernelSet getForceKernels(InstructionSet instructionSet, unsigned int features) {
+    static ForceKernelSet (*const specialisations[KERNEL_FEATURE_COMBINATIONS])(InstructionSet) = {
+        &getSpecialisedKernels<0>, &getSpecialisedKernels<1>, &getSpecialisedKernels<2>, &getSpecialisedKernels<3>,
+        &getSpecialisedKernels<4>, &getSpecialisedKernels<5>, &getSpecialisedKernels<6>, &getSpecialisedKernels<7>
+    };
+    if (!isInstructionSetSupported(instructionSet))
+        instructionSet = InstructionSetScalar;
+    return specialisations[features & KernelFeatureAll](instructionSet);
+}
+
+const char* getInstructionSetName(InstructionSet instructionSet) {
+    switch (instructionSet) {
+        case InstructionSetScalar: return "Scalar";
+        case InstructionSetAVX2  : return "AVX2";
+        case InstructionSetAVX512: return "AVX-512";
+        default                  : return "Unknown";
+    }
+}
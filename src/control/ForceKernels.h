@@ -0,0 +1,156 @@
+/**
+ * @file   ForceKernels.h
+ * @brief  Inner loop of the CPU simulation, with SIMD implementations.
+ *
+ * @author Stuart Lewis
+ * @date   January 2023
+ */
+#pragma once
+#include "../model/SimulationStructures.h"
+
+#include <cstddef>
+
+/** Instruction sets the force kernel can be run with. */
+enum InstructionSet {
+    InstructionSetScalar, /** Portable scalar implementation. */
+    InstructionSetAVX2,   /** 8 atoms at a time using AVX2. */
+    InstructionSetAVX512, /** 16 atoms at a time using AVX-512F. */
+    InstructionSetMax     /** Max value used for array indexing. */
+};
+
+/**
+ * Work in the force kernels which can be compiled out, combined as bit flags
+ * (see getForceKernels). A kernel compiled without a feature gives the same
+ * results as one with it, as long as the atoms passed to it do not need it.
+ */
+enum KernelFeature {
+    /** Push apart overlapping atoms. Not needed if the collision force is 0. */
+    KernelFeatureCollisions = 1 << 0,
+    /**
+     * Wrap deltas around the edges of the simulation. Not needed if every
+     * atom passed in is less than half the simulation away from atom A along
+     * both axes (see SpatialGrid::isWrappingCell).
+     */
+    KernelFeatureWrap = 1 << 1,
+    /**
+     * Look up each interaction by the type of the other atom. Not needed if
+     * every interaction (and reaction) passed in is the same. The run kernels
+     * never look them up.
+     */
+    KernelFeatureGather = 1 << 2,
+    KernelFeatureAll = (1 << 3) - 1 /** Every feature. */
+};
+
+/** Number of combinations of KernelFeature flags, for sizing dispatch tables. */
+const size_t KERNEL_FEATURE_COMBINATIONS = KernelFeatureAll + 1;
+
+/**
+ * Simulation parameters used by the force kernels.
+ */
+struct ForceKernelParams {
+    float simWidth;
+    float simHeight;
+    float interactionRange2;
+    float atomDiameter;
+    float collisionForce;
+};
+
+/**
+ * Accumulate the force acting on atom A from a contiguous span of atoms.
+ * Atoms in exactly the same position as A (including A itself) are ignored.
+ * @param params Simulation parameters.
+ * @param ax X position of atom A.
+ * @param ay Y position of atom A.
+ * @param interactions Interaction values of atom A's type, indexed by the
+ * type of the other atom.
+ * @param bx X positions of the other atoms.
+ * @param by Y positions of the other atoms.
+ * @param bTypes Atom types of the other atoms.
+ * @param count Number of other atoms.
+ * @param fx Accumulated force on atom A along the X axis.
+ * @param fy Accumulated force on atom A along the Y axis.
+ */
+typedef void (*ForceKernel)(const ForceKernelParams& params, float ax, float ay, const float* interactions,
+                            const float* bx, const float* by, const atom_type_id* bTypes, size_t count,
+                            float& fx, float& fy);
+
+/**
+ * Accumulate the forces between atom A and a contiguous span of atoms, in both
+ * directions, so the distance to each pair is only computed once (Newton's
+ * third law). The geometry is symmetric even though the interactions are not,
+ * so A and the other atoms are pushed along the same line but by their own
+ * interaction values.
+ * Atoms in exactly the same position as A (including A itself) are ignored.
+ * @param params Simulation parameters.
+ * @param ax X position of atom A.
+ * @param ay Y position of atom A.
+ * @param interactions Interaction values of atom A's type acting on A, indexed
+ * by the type of the other atom.
+ * @param reactions Interaction values of each type acting on the other atom,
+ * from atom A's type, indexed by the type of the other atom.
+ * @param bx X positions of the other atoms.
+ * @param by Y positions of the other atoms.
+ * @param bTypes Atom types of the other atoms.
+ * @param count Number of other atoms.
+ * @param fx Accumulated force on atom A along the X axis.
+ * @param fy Accumulated force on atom A along the Y axis.
+ * @param bFx Accumulated forces on the other atoms along the X axis.
+ * @param bFy Accumulated forces on the other atoms along the Y axis.
+ */
+typedef void (*PairForceKernel)(const ForceKernelParams& params, float ax, float ay,
+                                const float* interactions, const float* reactions,
+                                const float* bx, const float* by, const atom_type_id* bTypes, size_t count,
+                                float& fx, float& fy, float* bFx, float* bFy);
+
+/**
+ * As ForceKernel, but the other atoms are grouped into runs of a single atom
+ * type each (see SpatialGrid::getRunStarts), so each run's interaction value
+ * is held constant in a register rather than looked up for every atom.
+ * Without collisions, runs of types with no interaction are skipped.
+ * @param interactions Interaction values of atom A's type, indexed by run.
+ * @param bx X positions, indexed by runStarts.
+ * @param by Y positions, indexed by runStarts.
+ * @param runStarts Start of each run in bx and by, plus the end of the last.
+ * @param runCount Number of runs.
+ * @param begin Atoms before this index are skipped.
+ */
+typedef void (*RunForceKernel)(const ForceKernelParams& params, float ax, float ay, const float* interactions,
+                               const float* bx, const float* by, const unsigned int* runStarts, size_t runCount,
+                               size_t begin, float& fx, float& fy);
+
+/**
+ * As PairForceKernel, over runs of a single atom type each (see
+ * RunForceKernel). bFx and bFy are indexed the same as bx and by.
+ */
+typedef void (*PairRunForceKernel)(const ForceKernelParams& params, float ax, float ay,
+                                   const float* interactions, const float* reactions,
+                                   const float* bx, const float* by, const unsigned int* runStarts, size_t runCount,
+                                   size_t begin, float& fx, float& fy, float* bFx, float* bFy);
+
+/**
+ * @returns true if the instruction set is supported by this CPU (and build).
+ */
+bool isInstructionSetSupported(InstructionSet instructionSet);
+/**
+ * @returns The fastest instruction set supported by this CPU.
+ */
+InstructionSet getBestInstructionSet();
+/**
+ * Every kernel of one instruction set, compiled for one combination of
+ * KernelFeature flags.
+ */
+struct ForceKernelSet {
+    ForceKernel force;
+    PairForceKernel pair;
+    RunForceKernel run;
+    PairRunForceKernel pairRun;
+};
+
+/**
+ * @returns The kernels implemented with instructionSet (or the scalar kernels
+ * if instructionSet is not supported), compiled with only the work in
+ * features (a combination of KernelFeature flags).
+ */
+ForceKernelSet getForceKernels(InstructionSet instructionSet, unsigned int features);
+
+const char* getInstructionSetName(InstructionSet instructionSet);
@@ -46,19 +46,19 @@ void APIENTRY glDebugOutput(GLenum source, GLenum type, unsigned int id, GLenum
     }
 
     if (severity == GL_DEBUG_SEVERITY_HIGH)
-        Logger::getLogger().logError(
+        LOG_ERROR(
             std::string("OpenGL exception - Source: ").append(sourceString)
             .append(" - Type:").append(typeString)
             .append(" - Severity: ").append(severityString)
         );
     else if (severity == GL_DEBUG_SEVERITY_MEDIUM)
-        Logger::getLogger().logWarning(
+        LOG_WARNING(
             std::string("OpenGL warning - Source: ").append(sourceString)
             .append(" - Type:").append(typeString)
             .append(" - Severity: ").append(severityString)
         );
     else
-        Logger::getLogger().logMessage(
+        LOG_MESSAGE(
             std::string("OpenGL message - Source: ").append(sourceString)
             .append(" - Type:").append(typeString)
             .append(" - Severity: ").append(severityString)
@@ -79,7 +79,7 @@ void glCheckError_(const char *file, int line) {
             case GL_INVALID_FRAMEBUFFER_OPERATION: error = "INVALID_FRAMEBUFFER_OPERATION"; break;
             default                              : error = "__UNKNOWN_ERROR__"            ; break;
         }
-        Logger::getLogger().logError(
+        LOG_ERROR(
             std::string("OpenGL Error - ").append(error)
             .append(" (").append(file).append(" LINE:").append(std::to_string(line)).append(")")
         );
@@ -0,0 +1,62 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& location) {
+#ifdef _WIN32
+	mFile = CreateFileA(location.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (mFile == INVALID_HANDLE_VALUE)
+		return;
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(mFile, &size) || size.QuadPart == 0)
+		return;
+	mMapping = CreateFileMappingA(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mMapping == nullptr)
+		return;
+	mData = static_cast<const unsigned char*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+	if (mData != nullptr)
+		mSize = (size_t) size.QuadPart;
+#else
+	mFile = open(location.c_str(), O_RDONLY);
+	if (mFile < 0)
+		return;
+	struct stat info{};
+	if (fstat(mFile, &info) != 0 || info.st_size == 0)
+		return;
+	void* data = mmap(nullptr, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, mFile, 0);
+	if (data == MAP_FAILED)
+		return;
+	madvise(data, (size_t) info.st_size, MADV_SEQUENTIAL);
+	mData = static_cast<const unsigned char*>(data);
+	mSize = (size_t) info.st_size;
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifdef _WIN32
+	if (mData != nullptr)
+		UnmapViewOfFile(mData);
+	if (mMapping != nullptr)
+		CloseHandle(mMapping);
+	if (mFile != INVALID_HANDLE_VALUE)
+		CloseHandle(mFile);
+#else
+	if (mData != nullptr)
+		munmap(const_cast<unsigned char*>(mData), mSize);
+	if (mFile >= 0)
+		close(mFile);
+#endif
+}
@@ -0,0 +1,36 @@
+/**
+ * @file   MappedFile.h
+ * @brief  Read-only memory mapping of a file.
+ *
+ * @author Stuart Lewis
+ * @date   January 2023
+ */
+#pragma once
+#include <cstddef>
+#include <string>
+
+/**
+ * Read-only memory mapping of an entire file.
+ */
+class MappedFile {
+public:
+	explicit MappedFile(const std::string& location);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	[[nodiscard]] inline bool isValid() const { return mData != nullptr; }
+	[[nodiscard]] inline const unsigned char* data() const { return mData; }
+	[[nodiscard]] inline size_t size() const { return mSize; }
+private:
+#ifdef _WIN32
+	/** File and mapping HANDLEs, kept as void* so windows.h stays out of the header. */
+	void* mFile;
+	void* mMapping = nullptr;
+#else
+	int mFile = -1;
+#endif
+	const unsigned char* mData = nullptr;
+	size_t mSize = 0;
+};
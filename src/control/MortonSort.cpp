@@ -0,0 +1,93 @@
+#include "MortonSort.h"
+
+#include <algorithm>
+#include <utility>
+
+/** Bits of the key sorted by each radix pass. */
+const unsigned int RADIX_BITS = 8;
+const size_t RADIX = (size_t) 1 << RADIX_BITS;
+/** Smallest block of keys counted and scattered by one task. */
+const size_t MIN_BLOCK_SIZE = 4096;
+
+/**
+ * @returns The low 16 bits of value spread out to the even bits.
+ */
+static uint32_t spreadBits(uint32_t value) {
+    value &= 0x0000FFFF;
+    value = (value | (value << 8)) & 0x00FF00FF;
+    value = (value | (value << 4)) & 0x0F0F0F0F;
+    value = (value | (value << 2)) & 0x33333333;
+    value = (value | (value << 1)) & 0x55555555;
+    return value;
+}
+
+MortonSort::MortonSort() :
+mKeys(), mIndices(), mKeysScratch(), mIndicesScratch(), mBlockCounts(), mBlockCount(0), mBlockSize(0) {
+}
+
+void MortonSort::sort(ThreadPool& threadPool, float width, float height, const float* x, const float* y, size_t count) {
+    mKeys.resize(count);
+    mIndices.resize(count);
+    mKeysScratch.resize(count);
+    mIndicesScratch.resize(count);
+
+    // A few blocks per thread keeps them balanced, but every block adds a row of counts to scan
+    mBlockSize = std::max(MIN_BLOCK_SIZE, (count + threadPool.getThreadCount() * 4 - 1) / (threadPool.getThreadCount() * 4));
+    mBlockCount = (count + mBlockSize - 1) / mBlockSize;
+    mBlockCounts.resize(mBlockCount * RADIX);
+
+    const float cells = (float) (1 << MORTON_BITS_PER_AXIS);
+    const float scaleX = cells / width;
+    const float scaleY = cells / height;
+    threadPool.parallelFor(count, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            auto cellX = (uint32_t) std::min(std::max(x[i] * scaleX, 0.0f), cells - 1.0f);
+            auto cellY = (uint32_t) std::min(std::max(y[i] * scaleY, 0.0f), cells - 1.0f);
+            mKeys[i] = spreadBits(cellX) | (spreadBits(cellY) << 1);
+            mIndices[i] = (unsigned int) i;
+        }
+    }, 1024);
+
+    for (unsigned int shift = 0; shift < MORTON_BITS_PER_AXIS * 2; shift += RADIX_BITS)
+        sortDigit(threadPool, shift, count);
+}
+
+bool MortonSort::sortDigit(ThreadPool& threadPool, unsigned int shift, size_t count) {
+    threadPool.parallelFor(mBlockCount, [&](size_t beginBlock, size_t endBlock) {
+        for (size_t block = beginBlock; block < endBlock; block++) {
+            size_t* counts = mBlockCounts.data() + block * RADIX;
+            std::fill(counts, counts + RADIX, (size_t) 0);
+            size_t end = std::min(count, (block + 1) * mBlockSize);
+            for (size_t i = block * mBlockSize; i < end; i++)
+                counts[(mKeys[i] >> shift) & (RADIX - 1)]++;
+        }
+    }, 1);
+
+    // Scan the counts digit-major, so each block scatters after the earlier
+    // blocks' keys with the same digit and the sort stays stable
+    size_t slot = 0;
+    for (size_t digit = 0; digit < RADIX; digit++) {
+        for (size_t block = 0; block < mBlockCount; block++) {
+            size_t blockCount = mBlockCounts[block * RADIX + digit];
+            if (blockCount == count)
+                return false;
+            mBlockCounts[block * RADIX + digit] = slot;
+            slot += blockCount;
+        }
+    }
+
+    threadPool.parallelFor(mBlockCount, [&](size_t beginBlock, size_t endBlock) {
+        for (size_t block = beginBlock; block < endBlock; block++) {
+            size_t* slots = mBlockCounts.data() + block * RADIX;
+            size_t end = std::min(count, (block + 1) * mBlockSize);
+            for (size_t i = block * mBlockSize; i < end; i++) {
+                size_t to = slots[(mKeys[i] >> shift) & (RADIX - 1)]++;
+                mKeysScratch[to] = mKeys[i];
+                mIndicesScratch[to] = mIndices[i];
+            }
+        }
+    }, 1);
+    std::swap(mKeys, mKeysScratch);
+    std::swap(mIndices, mIndicesScratch);
+    return true;
+}
@@ -0,0 +1,61 @@
+/**
+ * @file   MortonSort.h
+ * @brief  Parallel radix sort of atoms along a Morton (Z-order) curve.
+ *
+ * @author Stuart Lewis
+ * @date   January 2023
+ */
+#pragma once
+#include "ThreadPool.h"
+#include "../model/AlignedAllocator.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/** Bits of each axis of the quantized positions interleaved into a Morton key. */
+const unsigned int MORTON_BITS_PER_AXIS = 10;
+
+/**
+ * Orders atoms along a Morton curve, which visits a 2^MORTON_BITS_PER_AXIS
+ * square grid over the simulation space a quadrant at a time, so atoms close
+ * together in space end up close together in the order.
+ *
+ * Keys are sorted with a least significant digit radix sort, split into fixed
+ * blocks so each pass counts and scatters across threads. The sort is stable,
+ * so the order only depends on the positions, not on the thread count.
+ */
+class MortonSort {
+public:
+    MortonSort();
+
+    /**
+     * Sort the atoms by the Morton key of their position.
+     * @param width Width of the simulation space.
+     * @param height Height of the simulation space.
+     * @param x X positions of the atoms to sort.
+     * @param y Y positions of the atoms to sort.
+     * @param count Number of atoms to sort.
+     */
+    void sort(ThreadPool& threadPool, float width, float height, const float* x, const float* y, size_t count);
+
+    /** @returns Index of the atom at each position of the sorted order. */
+    [[nodiscard]] inline const unsigned int* getOrder() const { return mIndices.data(); }
+private:
+    /**
+     * Stably scatter the keys and indices into the scratch buffers by the
+     * digit starting at shift, then swap them back.
+     * @returns false if every key has the same digit (so nothing was moved).
+     */
+    bool sortDigit(ThreadPool& threadPool, unsigned int shift, size_t count);
+
+    AlignedVector<uint32_t> mKeys;
+    AlignedVector<unsigned int> mIndices;
+    AlignedVector<uint32_t> mKeysScratch;
+    AlignedVector<unsigned int> mIndicesScratch;
+
+    /** Count of each digit in each block (then the slot it scatters to), indexed [block * radix + digit]. */
+    std::vector<size_t> mBlockCounts;
+    size_t mBlockCount;
+    size_t mBlockSize;
+};
@@ -0,0 +1,129 @@
+#include "NeighbourList.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+NeighbourList::NeighbourList() :
+mValid(false), mWidth(0.0f), mHeight(0.0f), mCutoff(0.0f), mSkin(0.0f), mHalf(false),
+mStart(), mNeighbours(), mMaxNeighbourCount(0), mBuildCount(0),
+mBuildX(), mBuildY(), mSlotThread(), mSlotOffset(), mThreadNeighbours(), mThreadMaxDisplacement2() {
+}
+
+void NeighbourList::invalidate() {
+    mValid = false;
+}
+
+bool NeighbourList::update(ThreadPool& threadPool, SpatialGrid& grid, float width, float height, float range, float skin,
+                           bool half, const float* x, const float* y, size_t count) {
+    float cutoff = range + skin;
+    bool valid = mValid && width == mWidth && height == mHeight && cutoff == mCutoff && skin == mSkin
+              && half == mHalf && count == mBuildX.size();
+    if (valid && getMaxDisplacement2(threadPool, grid, x, y, count) <= skin * skin * 0.25f)
+        return false;
+
+    mValid = true;
+    mWidth = width;
+    mHeight = height;
+    mCutoff = cutoff;
+    mSkin = skin;
+    mHalf = half;
+    mBuildCount++;
+    grid.build(width, height, cutoff, x, y, count);
+
+    mBuildX.resize(count);
+    mBuildY.resize(count);
+    threadPool.parallelFor(count, [&](size_t begin, size_t end) {
+        for (size_t slot = begin; slot < end; slot++) {
+            unsigned int i = grid.getBinnedAtom(slot);
+            mBuildX[slot] = x[i];
+            mBuildY[slot] = y[i];
+        }
+    });
+
+    // Search once into per-thread buffers, as the offset of each list is not
+    // known until every list before it has been found, then concatenate them
+    mStart.resize(count + 1);
+    mSlotThread.resize(count);
+    mSlotOffset.resize(count);
+    mThreadNeighbours.resize(threadPool.getThreadCount());
+    for (ThreadNeighbours& buffer : mThreadNeighbours)
+        buffer.used = 0;
+    threadPool.parallelForIndexed(count, [&](size_t begin, size_t end, size_t thread) {
+        for (size_t slot = begin; slot < end; slot++)
+            findNeighbours(grid, slot, thread);
+    });
+
+    mStart[0] = 0;
+    mMaxNeighbourCount = 0;
+    for (size_t slot = 0; slot < count; slot++) {
+        mMaxNeighbourCount = std::max(mMaxNeighbourCount, mStart[slot + 1]);
+        mStart[slot + 1] += mStart[slot];
+    }
+    mNeighbours.resize(mStart[count]);
+    threadPool.parallelFor(count, [&](size_t begin, size_t end) {
+        for (size_t slot = begin; slot < end; slot++) {
+            const unsigned int* list = mThreadNeighbours[mSlotThread[slot]].slots.data() + mSlotOffset[slot];
+            std::memcpy(mNeighbours.data() + mStart[slot], list, getNeighbourCount(slot) * sizeof(unsigned int));
+        }
+    });
+    return true;
+}
+
+float NeighbourList::getMaxDisplacement2(ThreadPool& threadPool, const SpatialGrid& grid, const float* x, const float* y,
+                                         size_t count) {
+    mThreadMaxDisplacement2.assign(threadPool.getThreadCount(), 0.0f);
+    threadPool.parallelForIndexed(count, [&](size_t begin, size_t end, size_t thread) {
+        float max2 = 0.0f;
+        for (size_t slot = begin; slot < end; slot++) {
+            unsigned int i = grid.getBinnedAtom(slot);
+            float dX = std::abs(x[i] - mBuildX[slot]);
+            float dY = std::abs(y[i] - mBuildY[slot]);
+            dX = std::min(dX, mWidth - dX);
+            dY = std::min(dY, mHeight - dY);
+            max2 = std::max(max2, dX * dX + dY * dY);
+        }
+        mThreadMaxDisplacement2[thread] = std::max(mThreadMaxDisplacement2[thread], max2);
+    }, 1024);
+    return *std::max_element(mThreadMaxDisplacement2.begin(), mThreadMaxDisplacement2.end());
+}
+
+void NeighbourList::findNeighbours(const SpatialGrid& grid, size_t slot, size_t thread) {
+    float cutoff2 = mCutoff * mCutoff;
+    float x = mBuildX[slot];
+    float y = mBuildY[slot];
+    std::array<size_t, 9> cells{};
+    size_t cellCount = grid.getNeighbourCells(grid.getAtomCell(grid.getBinnedAtom(slot)), cells);
+
+    // Reserve room for every candidate so the search can write unconditionally
+    ThreadNeighbours& buffer = mThreadNeighbours[thread];
+    size_t candidates = 0;
+    for (size_t c = 0; c < cellCount; c++)
+        candidates += grid.getCellEnd(cells[c]) - grid.getCellStart(cells[c]);
+    if (buffer.slots.size() < buffer.used + candidates)
+        buffer.slots.resize(std::max(buffer.slots.size() * 2, buffer.used + candidates));
+    unsigned int* out = buffer.slots.data() + buffer.used;
+
+    size_t found = 0;
+    for (size_t c = 0; c < cellCount; c++) {
+        // Slots are ordered by cell, so half lists only need the later slots of each cell
+        size_t begin = grid.getCellStart(cells[c]);
+        size_t end = grid.getCellEnd(cells[c]);
+        if (mHalf)
+            begin = std::max(begin, slot + 1);
+        for (size_t other = begin; other < end; other++) {
+            float dX = std::abs(x - mBuildX[other]);
+            float dY = std::abs(y - mBuildY[other]);
+            dX = std::min(dX, mWidth - dX);
+            dY = std::min(dY, mHeight - dY);
+            out[found] = (unsigned int) other;
+            found += (dX * dX + dY * dY < cutoff2) & (other != slot);
+        }
+    }
+
+    mSlotThread[slot] = (unsigned int) thread;
+    mSlotOffset[slot] = buffer.used;
+    mStart[slot + 1] = found;
+    buffer.used += found;
+}
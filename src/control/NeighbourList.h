@@ -0,0 +1,99 @@
+/**
+ * @file   NeighbourList.h
+ * @brief  Verlet neighbour lists, reused across iterations until atoms have moved too far.
+ *
+ * @author Stuart Lewis
+ * @date   January 2023
+ */
+#pragma once
+#include "ThreadPool.h"
+#include "../model/AlignedAllocator.h"
+#include "../model/SpatialGrid.h"
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * Verlet neighbour lists: for every binned slot (see SpatialGrid::getBinnedAtom),
+ * the slots of every atom within the interaction range plus a skin.
+ *
+ * As long as no atom has moved more than half the skin since the lists were
+ * built, no pair of atoms can have closed more than the skin, so every pair
+ * within the interaction range is still listed. The lists (and the binning
+ * they index) are only rebuilt once that is no longer true, so most
+ * iterations skip binning and only test the listed pairs, rather than every
+ * atom of the 9 surrounding cells.
+ */
+class NeighbourList {
+public:
+    NeighbourList();
+
+    /**
+     * Rebuild on the next call to NeighbourList::update, e.g. when the atoms
+     * have been replaced.
+     */
+    void invalidate();
+
+    /**
+     * Rebuild the lists if any atom has moved more than half of skin since
+     * they were last built, or if any parameter has changed. grid is rebuilt
+     * with them, and must not be rebuilt elsewhere while the lists are in use.
+     * @param range Interaction range.
+     * @param skin Margin beyond the interaction range, trading longer lists
+     * for less frequent rebuilds.
+     * @param half List each pair once, under the earlier slot (for pair
+     * symmetric force accumulation), rather than under both slots.
+     * @returns true if the lists were rebuilt.
+     */
+    bool update(ThreadPool& threadPool, SpatialGrid& grid, float width, float height, float range, float skin,
+                bool half, const float* x, const float* y, size_t count);
+
+    /** @returns Binned slots of the atoms listed as neighbours of slot. */
+    [[nodiscard]] inline const unsigned int* getNeighbours(size_t slot) const { return mNeighbours.data() + mStart[slot]; }
+    [[nodiscard]] inline size_t getNeighbourCount(size_t slot) const { return mStart[slot + 1] - mStart[slot]; }
+    /** @returns Length of the longest list, for sizing per-thread buffers. */
+    [[nodiscard]] inline size_t getMaxNeighbourCount() const { return mMaxNeighbourCount; }
+    /** @returns Number of times the lists have been built. */
+    [[nodiscard]] inline size_t getBuildCount() const { return mBuildCount; }
+private:
+    /**
+     * @returns The square of the largest distance moved by any atom since the
+     * lists were built, taking the shortest way around the wrapped space.
+     */
+    float getMaxDisplacement2(ThreadPool& threadPool, const SpatialGrid& grid, const float* x, const float* y,
+                              size_t count);
+    /**
+     * Find the neighbours of slot, appending them to the buffer of thread and
+     * recording where they were written and how many there are (in mStart).
+     */
+    void findNeighbours(const SpatialGrid& grid, size_t slot, size_t thread);
+
+    bool mValid;
+    float mWidth;
+    float mHeight;
+    float mCutoff;
+    float mSkin;
+    bool mHalf;
+
+    /** Offset into mNeighbours of the list of each slot (plus one past the end). */
+    std::vector<size_t> mStart;
+    std::vector<unsigned int> mNeighbours;
+    size_t mMaxNeighbourCount;
+    size_t mBuildCount;
+
+    /** Position of the atom in each binned slot when the lists were built. */
+    AlignedVector<float> mBuildX;
+    AlignedVector<float> mBuildY;
+
+    /** Lists found by one thread during a rebuild, before they are concatenated. */
+    struct ThreadNeighbours {
+        std::vector<unsigned int> slots;
+        size_t used = 0;
+    };
+    /** Thread which found the list of each slot, and its offset in that thread's buffer. */
+    std::vector<unsigned int> mSlotThread;
+    std::vector<size_t> mSlotOffset;
+    std::vector<ThreadNeighbours> mThreadNeighbours;
+    /** Per-thread maxima of the squared displacement. */
+    std::vector<float> mThreadMaxDisplacement2;
+};
@@ -0,0 +1,78 @@
+#include "ReadbackBuffer.h"
+
+#include "GLUtilities.h"
+#include "../model/AtomArrays.h"
+
+#include <algorithm>
+
+static const GLbitfield READBACK_MAP_FLAGS = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+static const GLbitfield READBACK_FLAGS = READBACK_MAP_FLAGS | GL_CLIENT_STORAGE_BIT;
+
+ReadbackBuffer::ReadbackBuffer() :
+mBufferID(0), mCapacity(0), mSize(0), mMapping(nullptr), mFence(nullptr) {
+}
+
+ReadbackBuffer::~ReadbackBuffer() {
+    releaseFence();
+    if (mBufferID != 0)
+        glDeleteBuffers(1, &mBufferID);
+}
+
+void ReadbackBuffer::request(const StorageBuffer& source, GLsizeiptr offset, GLsizeiptr size) {
+    releaseFence();
+    mSize = size;
+    if (mBufferID == 0 || size > mCapacity) {
+        // Nothing is pending, so the old contents can be discarded
+        if (mBufferID != 0)
+            glDeleteBuffers(1, &mBufferID);
+        mCapacity = (GLsizeiptr) growCapacity((size_t) mCapacity, (size_t) std::max(size, MIN_STORAGE_BUFFER_SIZE), (size_t) MIN_STORAGE_BUFFER_SIZE);
+        glGenBuffers(1, &mBufferID);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, mBufferID);
+        glBufferStorage(GL_COPY_WRITE_BUFFER, mCapacity, nullptr, READBACK_FLAGS);
+        mMapping = glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, mCapacity, READBACK_MAP_FLAGS);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    if (size > 0) {
+        // Make compute shader writes to the source visible to the copy
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+        glBindBuffer(GL_COPY_READ_BUFFER, source.getID());
+        glBindBuffer(GL_COPY_WRITE_BUFFER, mBufferID);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offset, 0, size);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    }
+    mFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    // Submit the copy now, so it completes even if nothing else is issued before polling
+    glFlush();
+#ifdef _DEBUG
+    glCheckError();
+#endif
+}
+
+bool ReadbackBuffer::isReady() {
+    if (mFence == nullptr)
+        return false;
+    GLenum status = glClientWaitSync(mFence, 0, 0);
+    return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+}
+
+const void* ReadbackBuffer::getData() {
+    if (mFence == nullptr)
+        return mSize > 0 ? mMapping : nullptr;
+    GLenum status = glClientWaitSync(mFence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    while (status == GL_TIMEOUT_EXPIRED)
+        status = glClientWaitSync(mFence, 0, 1000000000);
+    releaseFence();
+#ifdef _DEBUG
+    glCheckError();
+#endif
+    return mMapping;
+}
+
+void ReadbackBuffer::releaseFence() {
+    if (mFence == nullptr)
+        return;
+    glDeleteSync(mFence);
+    mFence = nullptr;
+}
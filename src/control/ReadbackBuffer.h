@@ -0,0 +1,58 @@
+/**
+ * @file   ReadbackBuffer.h
+ * @brief  Host visible buffer for copying StorageBuffers back from the GPU without stalling.
+ * 
+ * @author Stuart Lewis
+ * @date   January 2023
+ */
+#pragma once
+#include "StorageBuffer.h"
+
+/**
+ * Persistently mapped buffer in client memory (see GL_CLIENT_STORAGE_BIT)
+ * for reading back the contents of a StorageBuffer.
+ *
+ * ReadbackBuffer::request queues a GPU-side copy into this buffer followed by
+ * a fence, then returns immediately. The GPU carries on with later commands
+ * (which may overwrite the source) while the copy is in flight, and the copy
+ * is only waited on when its data is needed (see ReadbackBuffer::isReady and
+ * ReadbackBuffer::getData), so the StorageBuffer itself never needs to be
+ * host visible.
+ */
+class ReadbackBuffer {
+public:
+	ReadbackBuffer();
+	~ReadbackBuffer();
+
+	ReadbackBuffer(const ReadbackBuffer&) = delete;
+	ReadbackBuffer& operator=(const ReadbackBuffer&) = delete;
+
+	/**
+	 * Queue a copy of size bytes from offset in source, replacing any copy
+	 * still pending. Requires a current OpenGL context.
+	 */
+	void request(const StorageBuffer& source, GLsizeiptr offset, GLsizeiptr size);
+	[[nodiscard]] inline bool isPending() const { return mFence != nullptr; }
+	/**
+	 * @returns true if the pending copy has completed, without waiting.
+	 */
+	[[nodiscard]] bool isReady();
+	/**
+	 * Wait for the pending copy to complete.
+	 * @returns The copied data, valid until the next call to
+	 * ReadbackBuffer::request, or nullptr if no copy was requested.
+	 */
+	const void* getData();
+	[[nodiscard]] inline GLsizeiptr getSize() const { return mSize; }
+private:
+	void releaseFence();
+
+	GLuint mBufferID;
+	GLsizeiptr mCapacity;
+	/** Size of the last requested copy. */
+	GLsizeiptr mSize;
+	/** Persistent coherent mapping of the whole buffer. */
+	const void* mMapping;
+	/** Signalled once the pending copy completes, or nullptr if none is pending. */
+	GLsync mFence;
+};
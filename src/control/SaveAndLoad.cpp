@@ -1,20 +1,25 @@
 #include "SaveAndLoad.h"
+#include "MappedFile.h"
 #include "../view/Logger.h"
 
 #include "../../glm/vec3.hpp"
 
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <map>
 #include <string>
 
 bool getLoadableFiles(std::string (&files)[MAX_FILE_COUNT], int& count) {
-	Logger::getLogger().logMessage("Loading available config files");
+	LOG_MESSAGE("Loading available config files");
 	const std::regex CONFIG_FILE_REGEX(CONFIG_FILE_LOCATION + std::string(R"([/\\]([a-zA-Z0-9_-]+)\.)") + CONFIG_FILE_EXTENSION);
 	try {
 		std::filesystem::create_directory(CONFIG_FILE_LOCATION);
 	} catch (const std::filesystem::filesystem_error& e) {
-		Logger::getLogger().logError(
+		LOG_ERROR(
 			std::string("Failed to create config directory '").append(CONFIG_FILE_LOCATION)
 			.append("' - Filesystem Error: ").append(e.what())
 		);
@@ -36,7 +41,7 @@ bool getLoadableFiles(std::string (&files)[MAX_FILE_COUNT], int& count) {
 }
 
 bool saveToFile(const std::string& location, const SimulationHandler& handler) {
-	Logger::getLogger().logMessage(std::string("Saving current state to config file '").append(location).append("'"));
+	LOG_MESSAGE(std::string("Saving current state to config file '").append(location).append("'"));
 	std::string data;
 
 	data += "Width:" + std::to_string(handler.getWidth()) + " Height:" + std::to_string(handler.getHeight()) + "\n";
@@ -46,6 +51,7 @@ bool saveToFile(const std::string& location, const SimulationHandler& handler) {
 	data += "CollisionForce:" + std::to_string(handler.getCollisionForce()) + "\n";
 	data += "AtomDiameter:" + std::to_string(handler.getAtomDiameter()) + "\n";
 	data += "StartCondition:" + std::to_string(handler.startCondition) + "\n";
+	data += "Seed:" + std::to_string(handler.getSeed()) + "\n";
 
 	std::vector<unsigned int> atomTypeIds = handler.getAtomTypeIds();
 	for (unsigned int atomTypeId : atomTypeIds) {
@@ -65,14 +71,14 @@ bool saveToFile(const std::string& location, const SimulationHandler& handler) {
 	try {
 		file.open(location);
 		if (!file) {
-			Logger::getLogger().logError(std::string("Failed to open file '").append(location).append("'"));
+			LOG_ERROR(std::string("Failed to open file '").append(location).append("'"));
 			return false;
 		}
 		file << data;
 		file.close();
 	} catch (const std::fstream::failure& e) {
-		Logger::getLogger().logError(
-			std::string("Failed to read file '").append(location)
+		LOG_ERROR(
+			std::string("Failed to write to file '").append(location)
 			.append("' - Filesystem Error: ").append(e.what())
 		);
 		return false;
@@ -81,17 +87,118 @@ bool saveToFile(const std::string& location, const SimulationHandler& handler) {
 	return true;
 }
 
+/**
+ * Single-pass tokenizer over one line of a config file. Each method consumes
+ * a token if it matches, otherwise it returns false and the line should be
+ * ignored (as it is not part of the format).
+ */
+class ConfigLineParser {
+public:
+	ConfigLineParser(const char* begin, const char* end) : mBegin(begin), mPos(begin), mEnd(end) {}
+
+	/** Consume text exactly. */
+	bool literal(const char* text) {
+		const char* pos = mPos;
+		for (; *text != '\0'; text++, pos++)
+			if (pos == mEnd || *pos != *text)
+				return false;
+		mPos = pos;
+		return true;
+	}
+
+	/** Consume [0-9]+. */
+	template<typename T>
+	bool uint(T& value) {
+		const char* start = mPos;
+		while (mPos != mEnd && isDigit(*mPos))
+			mPos++;
+		if (mPos == start)
+			return false;
+		if (std::from_chars(start, mPos, value).ec != std::errc())
+			mInvalidValue = true;
+		return true;
+	}
+
+	/** Consume [0-9]+(\.[0-9]+)?, or -?[0-9]+(\.[0-9]+)? if allowNegative. */
+	bool decimal(float& value, bool allowNegative = false) {
+		const char* start = mPos;
+		const char* pos = mPos;
+		if (allowNegative && pos != mEnd && *pos == '-')
+			pos++;
+		const char* digits = pos;
+		while (pos != mEnd && isDigit(*pos))
+			pos++;
+		if (pos == digits)
+			return false;
+		if (pos != mEnd && *pos == '.' && pos + 1 != mEnd && isDigit(pos[1])) {
+			pos++;
+			while (pos != mEnd && isDigit(*pos))
+				pos++;
+		}
+		mPos = pos;
+		if (std::from_chars(start, mPos, value).ec != std::errc())
+			mInvalidValue = true;
+		return true;
+	}
+
+	/** Consume [A-Za-z0-9_-]*. */
+	bool name(std::string& value) {
+		const char* start = mPos;
+		while (mPos != mEnd && (isDigit(*mPos) || (*mPos >= 'A' && *mPos <= 'Z') || (*mPos >= 'a' && *mPos <= 'z') || *mPos == '_' || *mPos == '-'))
+			mPos++;
+		value.assign(start, mPos);
+		return true;
+	}
+
+	/** Consume the end of the line (including an optional carriage return). */
+	bool end() {
+		if (mPos != mEnd && *mPos == '\r')
+			mPos++;
+		return mPos == mEnd;
+	}
+
+	/** Restart at the beginning of the line. */
+	void rewind() {
+		mPos = mBegin;
+		mInvalidValue = false;
+	}
+
+	/** @returns true if a matched token could not be converted (e.g. out of range). */
+	[[nodiscard]] inline bool hasInvalidValue() const { return mInvalidValue; }
+	[[nodiscard]] inline std::string line() const { return std::string(mBegin, mEnd); }
+private:
+	static bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+	const char* mBegin;
+	const char* mPos;
+	const char* mEnd;
+	bool mInvalidValue = false;
+};
+
 bool loadFromFile(const std::string& location, SimulationHandler& handler) {
-	Logger::getLogger().logMessage(std::string("Reading contents of config file '").append(location).append("'"));
-	static const std::regex atomTypeRegex = std::regex("^ID:([0-9]+) Name:([A-Za-z0-9_-]*) Quantity:([0-9]+) R:([0-9]+(\\.[0-9]+)?) G:([0-9]+(\\.[0-9]+)?) B:([0-9]+(\\.[0-9]+)?)\r?$");
-	static const std::regex interactionRegex = std::regex("^Aid:([0-9]+) Bid:([0-9]+) Value:(-?[0-9]+(\\.[0-9]+)?)\r?$");
-	static const std::regex sizeRegex = std::regex("^Width:([0-9]+(\\.[0-9]+)?) Height:([0-9]+(\\.[0-9]+)?)\r?$");
-	static const std::regex dtRegex = std::regex("^DT:([0-9]+(\\.[0-9]+)?)\r?$");
-	static const std::regex dragRegex = std::regex("^Drag:([0-9]+(\\.[0-9]+)?)\r?$");
-	static const std::regex interactionRangeRegex = std::regex("^Range:([0-9]+(\\.[0-9]+)?)\r?$");
-	static const std::regex collisionForceRegex = std::regex("^CollisionForce:([0-9]+(\\.[0-9]+)?)\r?$");
-	static const std::regex atomDiameterRegex = std::regex("^AtomDiameter:([0-9]+(\\.[0-9]+)?)\r?$");
-	static const std::regex startConditionRegex = std::regex("^StartCondition:([0-9]+)\r?$");
+	LOG_MESSAGE(std::string("Reading contents of config file '").append(location).append("'"));
+
+	std::string data;
+	std::ifstream file;
+	try {
+		file.open(location, std::ios::binary);
+
+		if (!file.is_open()) {
+			LOG_ERROR(std::string("Failed to open file '").append(location).append("' for reading"));
+			return false;
+		}
+		file.seekg(0, std::ios::end);
+		data.resize((size_t) file.tellg());
+		file.seekg(0, std::ios::beg);
+		file.read(data.data(), (std::streamsize) data.size());
+		file.close();
+	} catch (const std::fstream::failure& e) {
+		LOG_ERROR(
+			std::string("Failed to read file '").append(location)
+			.append("' - Filesystem Error: ").append(e.what())
+		);
+		return false;
+	}
 
 	handler.clearAtomTypes();
 	handler.setBounds(1000.0f, 1000.0f);
@@ -102,126 +209,449 @@ bool loadFromFile(const std::string& location, SimulationHandler& handler) {
 	handler.setAtomDiameter(3.0f);
 
 	handler.startCondition = StartConditionRandom;
+	// Configs without a seed keep the current one
+	uint64_t seed = handler.getSeed();
 
-	std::string line;
-	std::ifstream file;
-	std::vector<std::string> atomTypes{};
-	std::vector<std::string> interactions{};
-	try {
-		file.open(location);
+	struct AtomTypeRecord {
+		unsigned int id;
+		std::string name;
+		unsigned int quantity;
+		glm::vec3 color;
+	};
+	struct InteractionRecord {
+		unsigned int aId;
+		unsigned int bId;
+		float value;
+	};
+	std::vector<AtomTypeRecord> atomTypes{};
+	std::vector<InteractionRecord> interactions{};
 
-		if (!file.is_open()) {
-			Logger::getLogger().logError(std::string("Failed to open file '").append(location).append("' for writing"));
-			return false;
+	const char* lineStart = data.data();
+	const char* dataEnd = data.data() + data.size();
+	while (lineStart < dataEnd) {
+		const char* lineEnd = static_cast<const char*>(std::memchr(lineStart, '\n', dataEnd - lineStart));
+		if (lineEnd == nullptr)
+			lineEnd = dataEnd;
+		ConfigLineParser line(lineStart, lineEnd);
+		lineStart = lineEnd + 1;
+
+		AtomTypeRecord atomType;
+		InteractionRecord interaction;
+		float width;
+		float height;
+		float value;
+		unsigned int startCondition;
+		uint64_t lineSeed;
+		if (line.literal("ID:") && line.uint(atomType.id) && line.literal(" Name:") && line.name(atomType.name) &&
+			line.literal(" Quantity:") && line.uint(atomType.quantity) &&
+			line.literal(" R:") && line.decimal(atomType.color.r) && line.literal(" G:") && line.decimal(atomType.color.g) &&
+			line.literal(" B:") && line.decimal(atomType.color.b) && line.end()) {
+			if (line.hasInvalidValue())
+				LOG_ERROR(std::string("Failed to parse values on line: ").append(line.line()));
+			else
+				atomTypes.push_back(atomType);
+			continue;
 		}
-		while (getline(file, line)) {
-			std::smatch matches;
-			if (std::regex_match(line, atomTypeRegex)) {
-				atomTypes.push_back(line);
-			} else if (std::regex_match(line, interactionRegex)) {
-				interactions.push_back(line);
-			} else if (std::regex_search(line, matches, sizeRegex)) {
-				float width;
-				float height;
-				if (!parseFloat(matches[1], width) || !parseFloat(matches[3], height))
-					Logger::getLogger().logError(std::string("Failed to parse float on line: ").append(matches.str(0)));
-				else
-					handler.setBounds(width, height);
-			} else if (std::regex_search(line, matches, dtRegex)) {
-				float dt;
-				if (!parseFloat(matches[1], dt))
-					Logger::getLogger().logError(std::string("Failed to parse float on line: ").append(matches.str(0)));
-				else
-					handler.setDt(dt);
-			} else if (std::regex_search(line, matches, dragRegex)) {
-				float drag;
-				if (!parseFloat(matches[1], drag))
-					Logger::getLogger().logError(std::string("Failed to parse float on line: ").append(matches.str(0)));
-				else
-					handler.setDrag(drag);
-			} else if (std::regex_search(line, matches, interactionRangeRegex)) {
-				float interactionRange;
-				if (!parseFloat(matches[1], interactionRange))
-					Logger::getLogger().logError(std::string("Failed to parse float on line: ").append(matches.str(0)));
-				else
-					handler.setInteractionRange(interactionRange);
-			} else if (std::regex_search(line, matches, collisionForceRegex)) {
-				float collisionForce;
-				if (!parseFloat(matches[1], collisionForce))
-					Logger::getLogger().logError(std::string("Failed to parse float on line: ").append(matches.str(0)));
-				else
-					handler.setCollisionForce(collisionForce);
-			} else if (std::regex_search(line, matches, atomDiameterRegex)) {
-				float atomDiameter;
-				if (!parseFloat(matches[1], atomDiameter))
-					Logger::getLogger().logError(std::string("Failed to parse float on line: ").append(matches.str(0)));
-				else
-					handler.setAtomDiameter(atomDiameter);
-			} else if (std::regex_search(line, matches, startConditionRegex)) {
-				unsigned int startCondition;
-				if (!parseUint(matches[1], startCondition))
-					Logger::getLogger().logError(std::string("Failed to parse float on line: ").append(matches.str(0)));
+		line.rewind();
+		if (line.literal("Aid:") && line.uint(interaction.aId) && line.literal(" Bid:") && line.uint(interaction.bId) &&
+			line.literal(" Value:") && line.decimal(interaction.value, true) && line.end()) {
+			if (line.hasInvalidValue())
+				LOG_ERROR(std::string("Failed to parse interaction values on line: ").append(line.line()));
+			else
+				interactions.push_back(interaction);
+			continue;
+		}
+		line.rewind();
+		if (line.literal("Width:") && line.decimal(width) && line.literal(" Height:") && line.decimal(height) && line.end()) {
+			if (line.hasInvalidValue())
+				LOG_ERROR(std::string("Failed to parse float on line: ").append(line.line()));
+			else
+				handler.setBounds(width, height);
+			continue;
+		}
+		line.rewind();
+		if (line.literal("StartCondition:") && line.uint(startCondition) && line.end()) {
+			if (line.hasInvalidValue())
+				LOG_ERROR(std::string("Failed to parse uint on line: ").append(line.line()));
+			else
+				handler.startCondition = (StartCondition) startCondition;
+			continue;
+		}
+		line.rewind();
+		if (line.literal("Seed:") && line.uint(lineSeed) && line.end()) {
+			if (line.hasInvalidValue())
+				LOG_ERROR(std::string("Failed to parse seed on line: ").append(line.line()));
+			else
+				seed = lineSeed;
+			continue;
+		}
+
+		static const std::pair<const char*, void (SimulationHandler::*)(float)> floatFields[] = {
+			{ "DT:",             &SimulationHandler::setDt },
+			{ "Drag:",           &SimulationHandler::setDrag },
+			{ "Range:",          &SimulationHandler::setInteractionRange },
+			{ "CollisionForce:", &SimulationHandler::setCollisionForce },
+			{ "AtomDiameter:",   &SimulationHandler::setAtomDiameter },
+		};
+		for (const auto& [label, setter] : floatFields) {
+			line.rewind();
+			if (line.literal(label) && line.decimal(value) && line.end()) {
+				if (line.hasInvalidValue())
+					LOG_ERROR(std::string("Failed to parse float on line: ").append(line.line()));
 				else
-					handler.startCondition = (StartCondition)startCondition;
+					(handler.*setter)(value);
+				break;
 			}
 		}
+	}
+
+	std::map<unsigned int, unsigned int> idMap;
+	for (const AtomTypeRecord& atomType : atomTypes) {
+		unsigned int newId = handler.newAtomType();
+		idMap.emplace(atomType.id, newId);
+		handler.setAtomTypeFriendlyName(newId, atomType.name);
+		handler.setAtomTypeQuantity(newId, atomType.quantity);
+		handler.setAtomTypeColor(newId, atomType.color);
+	}
+
+	for (const InteractionRecord& interaction : interactions) {
+		auto a = idMap.find(interaction.aId);
+		auto b = idMap.find(interaction.bId);
+		if (a == idMap.end() || b == idMap.end())
+			LOG_ERROR(
+				std::string("Interaction between unknown atom types ").append(std::to_string(interaction.aId))
+				.append(" and ").append(std::to_string(interaction.bId))
+			);
+		else
+			handler.setInteraction(a->second, b->second, interaction.value);
+	}
+
+	// Seeded last, so the atoms generated next only depend on the config
+	handler.setSeed(seed);
+
+	return true;
+}
+
+/** Alignment of each atom component block within a checkpoint. */
+static const size_t CHECKPOINT_BLOCK_ALIGNMENT = 64;
+static const size_t CHECKPOINT_HEADER_SIZE = 64;
+static const char CHECKPOINT_MAGIC[4] = { 'C', 'S', 'C', 'K' };
+/** Offset of the first byte covered by the checksum (everything after the checksum itself). */
+static const size_t CHECKPOINT_CHECKSUM_START = 16;
+
+static size_t alignCheckpointOffset(size_t offset) {
+	return (offset + CHECKPOINT_BLOCK_ALIGNMENT - 1) / CHECKPOINT_BLOCK_ALIGNMENT * CHECKPOINT_BLOCK_ALIGNMENT;
+}
+
+static void storeU32(unsigned char* dst, uint32_t v) {
+	for (int i = 0; i < 4; i++)
+		dst[i] = (unsigned char) (v >> (i * 8));
+}
+
+static void storeU64(unsigned char* dst, uint64_t v) {
+	for (int i = 0; i < 8; i++)
+		dst[i] = (unsigned char) (v >> (i * 8));
+}
+
+static void storeF32(unsigned char* dst, float f) {
+	uint32_t v;
+	std::memcpy(&v, &f, sizeof(v));
+	storeU32(dst, v);
+}
+
+static uint32_t loadU32(const unsigned char* src) {
+	uint32_t v = 0;
+	for (int i = 0; i < 4; i++)
+		v |= (uint32_t) src[i] << (i * 8);
+	return v;
+}
+
+static uint64_t loadU64(const unsigned char* src) {
+	uint64_t v = 0;
+	for (int i = 0; i < 8; i++)
+		v |= (uint64_t) src[i] << (i * 8);
+	return v;
+}
+
+static float loadF32(const unsigned char* src) {
+	uint32_t v = loadU32(src);
+	float f;
+	std::memcpy(&f, &v, sizeof(f));
+	return f;
+}
+
+/**
+ * Copy 32 bit values into a little-endian block, which is a straight copy on
+ * little-endian hosts.
+ */
+template<typename T>
+static void storeBlock(unsigned char* dst, const T* src, size_t count) {
+	static_assert(sizeof(T) == 4, "Checkpoint blocks hold 32 bit values");
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	for (size_t i = 0; i < count; i++) {
+		uint32_t v;
+		std::memcpy(&v, &src[i], sizeof(v));
+		storeU32(dst + i * 4, v);
+	}
+#else
+	std::memcpy(dst, src, count * sizeof(T));
+#endif
+}
+
+/**
+ * Fast 64 bit checksum, processing four independent 8 byte lanes per 32 byte
+ * stripe so it keeps up with the copy it guards.
+ */
+static uint64_t checkpointChecksum(const unsigned char* data, size_t size) {
+	const uint64_t PRIME_1 = 0x9E3779B185EBCA87ull;
+	const uint64_t PRIME_2 = 0xC2B2AE3D27D4EB4Full;
+	auto rotl = [](uint64_t v, int r) { return (v << r) | (v >> (64 - r)); };
+
+	uint64_t lanes[4] = { PRIME_1, PRIME_2, ~PRIME_1, ~PRIME_2 };
+	size_t i = 0;
+	for (; i + 32 <= size; i += 32)
+		for (int l = 0; l < 4; l++)
+			lanes[l] = rotl(lanes[l] + loadU64(data + i + l * 8) * PRIME_2, 31) * PRIME_1;
+
+	uint64_t hash = (uint64_t) size * PRIME_1;
+	for (uint64_t lane : lanes)
+		hash = rotl(hash ^ lane, 27) * PRIME_1 + PRIME_2;
+	for (; i < size; i++)
+		hash = rotl(hash ^ (data[i] * PRIME_1), 11) * PRIME_2;
+
+	hash ^= hash >> 33;
+	hash *= PRIME_2;
+	hash ^= hash >> 29;
+	return hash;
+}
+
+bool saveCheckpoint(const std::string& location, const SimulationHandler& handler) {
+	LOG_MESSAGE(std::string("Saving checkpoint to '").append(location).append("'"));
+	std::vector<atom_type_id> atomTypeIds = handler.getAtomTypeIds();
+	std::vector<std::string> names;
+	AtomsView atoms = handler.getAtoms();
+	const AtomArrays& arrays = atoms.getArrays();
+	size_t atomCount = atoms.size();
+	size_t atomTypeCount = atomTypeIds.size();
+
+	size_t size = CHECKPOINT_HEADER_SIZE;
+	for (atom_type_id id : atomTypeIds) {
+		names.push_back(handler.getAtomTypeFriendlyName(id));
+		size += 5 * 4 + names.back().size();
+	}
+	size += atomTypeCount * atomTypeCount * 4;
+	size_t blockSize = alignCheckpointOffset(atomCount * 4);
+	size_t blocksStart = alignCheckpointOffset(size);
+	size = blocksStart + 5 * blockSize;
+
+	std::vector<unsigned char> data(size, 0);
+	unsigned char* header = data.data();
+	std::memcpy(header, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+	storeU32(header + 4, CHECKPOINT_VERSION);
+	storeU32(header + 16, (uint32_t) CHECKPOINT_HEADER_SIZE);
+	storeU32(header + 20, (uint32_t) handler.startCondition);
+	storeU64(header + 24, (uint64_t) atomCount);
+	storeU32(header + 32, (uint32_t) atomTypeCount);
+	storeF32(header + 36, handler.getWidth());
+	storeF32(header + 40, handler.getHeight());
+	storeF32(header + 44, handler.getDt());
+	storeF32(header + 48, handler.getDrag());
+	storeF32(header + 52, handler.getInteractionRange());
+	storeF32(header + 56, handler.getCollisionForce());
+	storeF32(header + 60, handler.getAtomDiameter());
+
+	unsigned char* p = data.data() + CHECKPOINT_HEADER_SIZE;
+	for (size_t t = 0; t < atomTypeCount; t++) {
+		glm::vec3 color = handler.getAtomTypeColor(atomTypeIds[t]);
+		storeU32(p, handler.getAtomTypeQuantity(atomTypeIds[t]));
+		storeF32(p + 4, color.r);
+		storeF32(p + 8, color.g);
+		storeF32(p + 12, color.b);
+		storeU32(p + 16, (uint32_t) names[t].size());
+		std::memcpy(p + 20, names[t].data(), names[t].size());
+		p += 20 + names[t].size();
+	}
+	for (atom_type_id aId : atomTypeIds) {
+		for (atom_type_id bId : atomTypeIds) {
+			storeF32(p, handler.getInteraction(aId, bId));
+			p += 4;
+		}
+	}
+
+	unsigned char* blocks = data.data() + blocksStart;
+	storeBlock(blocks,                 arrays.x.data(),        atomCount);
+	storeBlock(blocks + blockSize,     arrays.y.data(),        atomCount);
+	storeBlock(blocks + blockSize * 2, arrays.vx.data(),       atomCount);
+	storeBlock(blocks + blockSize * 3, arrays.vy.data(),       atomCount);
+	storeBlock(blocks + blockSize * 4, arrays.atomType.data(), atomCount);
+
+	storeU64(header + 8, checkpointChecksum(data.data() + CHECKPOINT_CHECKSUM_START, size - CHECKPOINT_CHECKSUM_START));
+
+	std::ofstream file;
+	try {
+		file.open(location, std::ios::binary);
+		if (!file) {
+			LOG_ERROR(std::string("Failed to open file '").append(location).append("' for writing"));
+			return false;
+		}
+		file.write(reinterpret_cast<const char*>(data.data()), (std::streamsize) data.size());
 		file.close();
+		if (!file) {
+			LOG_ERROR(std::string("Failed to write checkpoint '").append(location).append("'"));
+			return false;
+		}
 	} catch (const std::fstream::failure& e) {
-		Logger::getLogger().logError(
+		LOG_ERROR(
 			std::string("Failed to write to file '").append(location)
 			.append("' - Filesystem Error: ").append(e.what())
 		);
 		return false;
 	}
 
-	std::map<unsigned int, unsigned int> idMap;
-	for (auto& l : atomTypes) {
-		std::smatch matches;
-		if (std::regex_search(l, matches, atomTypeRegex)) {
-			unsigned int id;
-			std::string name = matches[2];
-			unsigned int quantity;
-			float r;
-			float g;
-			float b;
-			if (!parseUint(matches[1], id) || !parseUint(matches[3], quantity) ||
-				!parseFloat(matches[4], r) || !parseFloat(matches[6], g) || !parseFloat(matches[8], b)) {
-				Logger::getLogger().logError(std::string("Failed to parse values on line: ").append(matches.str(0)));
-			} else {
-				unsigned int newId = handler.newAtomType();
-				idMap.emplace(id, newId);
-				handler.setAtomTypeFriendlyName(newId, name);
-				handler.setAtomTypeQuantity(newId, quantity);
-				handler.setAtomTypeColor(newId, { r, g, b });
-			}
-		}
+	return true;
+}
+
+/**
+ * Read a little-endian block of 32 bit values. On little-endian hosts the
+ * mapped block is returned directly, otherwise it is converted into storage.
+ */
+template<typename T>
+static const T* loadBlock(const unsigned char* src, size_t count, std::vector<T>& storage) {
+	static_assert(sizeof(T) == 4, "Checkpoint blocks hold 32 bit values");
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	storage.resize(count);
+	for (size_t i = 0; i < count; i++) {
+		uint32_t v = loadU32(src + i * 4);
+		std::memcpy(&storage[i], &v, sizeof(v));
 	}
+	return storage.data();
+#else
+	(void) count;
+	(void) storage;
+	return reinterpret_cast<const T*>(src);
+#endif
+}
 
-	for (auto& l : interactions) {
-		std::smatch matches;
-		if (std::regex_search(l, matches, interactionRegex)) {
-			unsigned int aId;
-			unsigned int bId;
-			float value;
-			if (!parseUint(matches[1], aId) || !parseUint(matches[2], bId) || !parseFloat(matches[3], value))
-				Logger::getLogger().logError(std::string("Failed to parse interaction values on line: ").append(matches.str(0)));
-			else
-				handler.setInteraction(idMap[aId], idMap[bId], value);
-		}
+bool loadCheckpoint(const std::string& location, SimulationHandler& handler) {
+	LOG_MESSAGE(std::string("Reading checkpoint '").append(location).append("'"));
+	MappedFile file(location);
+	if (!file.isValid()) {
+		LOG_ERROR(std::string("Failed to open file '").append(location).append("' for reading"));
+		return false;
 	}
 
+	const unsigned char* data = file.data();
+	size_t size = file.size();
+	if (size < CHECKPOINT_HEADER_SIZE || std::memcmp(data, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0) {
+		LOG_ERROR(std::string("File '").append(location).append("' is not a checkpoint"));
+		return false;
+	}
+	uint32_t version = loadU32(data + 4);
+	if (version != CHECKPOINT_VERSION) {
+		LOG_ERROR(
+			std::string("Unsupported checkpoint version ").append(std::to_string(version))
+			.append(" in '").append(location).append("'")
+		);
+		return false;
+	}
+	if (loadU64(data + 8) != checkpointChecksum(data + CHECKPOINT_CHECKSUM_START, size - CHECKPOINT_CHECKSUM_START)) {
+		LOG_ERROR(std::string("Checksum mismatch in checkpoint '").append(location).append("'"));
+		return false;
+	}
+
+	size_t headerSize = loadU32(data + 16);
+	uint32_t startCondition = loadU32(data + 20);
+	uint64_t atomCount = loadU64(data + 24);
+	size_t atomTypeCount = loadU32(data + 32);
+	auto corrupt = [&location]() {
+		LOG_ERROR(std::string("Checkpoint '").append(location).append("' is corrupt"));
+		return false;
+	};
+	if (headerSize < CHECKPOINT_HEADER_SIZE || headerSize > size || atomCount > size / 4)
+		return corrupt();
+
+	struct AtomTypeRecord {
+		unsigned int quantity;
+		glm::vec3 color;
+		std::string name;
+	};
+	std::vector<AtomTypeRecord> atomTypes(atomTypeCount);
+	size_t offset = headerSize;
+	for (AtomTypeRecord& atomType : atomTypes) {
+		if (size - offset < 20)
+			return corrupt();
+		atomType.quantity = loadU32(data + offset);
+		atomType.color = { loadF32(data + offset + 4), loadF32(data + offset + 8), loadF32(data + offset + 12) };
+		size_t nameLength = loadU32(data + offset + 16);
+		offset += 20;
+		if (size - offset < nameLength)
+			return corrupt();
+		atomType.name.assign(reinterpret_cast<const char*>(data + offset), nameLength);
+		offset += nameLength;
+	}
+	const unsigned char* interactions = data + offset;
+	if ((size - offset) / 4 / std::max<size_t>(atomTypeCount, 1) < atomTypeCount)
+		return corrupt();
+	offset += atomTypeCount * atomTypeCount * 4;
+
+	size_t blockSize = alignCheckpointOffset((size_t) atomCount * 4);
+	size_t blocksStart = alignCheckpointOffset(offset);
+	if (blocksStart > size || (size - blocksStart) / 5 < blockSize)
+		return corrupt();
+
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> vx;
+	std::vector<float> vy;
+	std::vector<atom_type_id> types;
+	const unsigned char* blocks = data + blocksStart;
+	const atom_type_id* atomType = loadBlock(blocks + blockSize * 4, atomCount, types);
+	for (size_t i = 0; i < atomCount; i++)
+		if (atomType[i] >= atomTypeCount)
+			return corrupt();
+
+	handler.clearAtomTypes();
+	handler.setBounds(loadF32(data + 36), loadF32(data + 40));
+	handler.setDt(loadF32(data + 44));
+	handler.setDrag(loadF32(data + 48));
+	handler.setInteractionRange(loadF32(data + 52));
+	handler.setCollisionForce(loadF32(data + 56));
+	handler.setAtomDiameter(loadF32(data + 60));
+	handler.startCondition = (StartCondition) startCondition;
+
+	std::vector<atom_type_id> ids;
+	for (const AtomTypeRecord& record : atomTypes) {
+		atom_type_id id = handler.newAtomType();
+		ids.push_back(id);
+		handler.setAtomTypeFriendlyName(id, record.name);
+		handler.setAtomTypeQuantity(id, record.quantity);
+		handler.setAtomTypeColor(id, record.color);
+	}
+	for (size_t a = 0; a < atomTypeCount; a++)
+		for (size_t b = 0; b < atomTypeCount; b++)
+			handler.setInteraction(ids[a], ids[b], loadF32(interactions + (a * atomTypeCount + b) * 4));
+
+	handler.setAtoms(
+		(size_t) atomCount,
+		loadBlock(blocks,                 atomCount, x),
+		loadBlock(blocks + blockSize,     atomCount, y),
+		loadBlock(blocks + blockSize * 2, atomCount, vx),
+		loadBlock(blocks + blockSize * 3, atomCount, vy),
+		atomType
+	);
+
 	return true;
 }
 
 bool deleteFile(const std::string& location) {
-	Logger::getLogger().logMessage(std::string("Deleting config file '").append(location).append("'"));
+	LOG_MESSAGE(std::string("Deleting config file '").append(location).append("'"));
 	try {
 		if (!std::filesystem::remove(location)) {
-			Logger::getLogger().logError(std::string("Failed to find file '").append(location).append("' - Unable to delete"));
+			LOG_ERROR(std::string("Failed to find file '").append(location).append("' - Unable to delete"));
 			return false;
 		}
 	} catch(const std::filesystem::filesystem_error& e) {
-		Logger::getLogger().logError(
+		LOG_ERROR(
 			std::string("Failed to delete file '").append(location)
 			.append("' Filesystem Error: ").append(e.what())
 		);
@@ -231,42 +661,36 @@ bool deleteFile(const std::string& location) {
 }
 
 bool parseFloat(const std::string& s, float& f) {
-	std::size_t pos{};
-	try {
-		f = std::stof(s, &pos);
-	} catch (std::invalid_argument const& e) {
-		Logger::getLogger().logError(std::string("Error parsing float (Invalid Argument) - stof error: ").append(e.what()));
+	const char* end = s.data() + s.size();
+	std::from_chars_result result = std::from_chars(s.data(), end, f);
+	if (result.ec == std::errc::result_out_of_range) {
+		LOG_ERROR(std::string("Error parsing float (Out of Range) - '").append(s).append("'"));
 		return false;
-	} catch (std::out_of_range const& e) {
-		const long long ll {std::stoll(s, &pos)};
-		Logger::getLogger().logError(
-			std::string("Error parsing float (Out of Range) - std::stoll('")
-			.append(std::to_string(ll)).append("'); pos: ").append(std::to_string(pos))
-			.append("stof error: ").append(e.what())
-		);
+	} else if (result.ec != std::errc() || result.ptr != end) {
+		LOG_ERROR(std::string("Error parsing float (Invalid Argument) - '").append(s).append("'"));
 		return false;
 	}
 	return true;
 }
 
-bool parseUint(const std::string& s, unsigned int& i) {
-	std::size_t pos{};
-	try {
-		unsigned long l = std::stoul(s, &pos);
-		if (l > std::numeric_limits<unsigned int>::max())
-			Logger::getLogger().logError(std::string("Error parsing uint (Out of Range)"));
-		i = l;
-	} catch (std::invalid_argument const& e) {
-		Logger::getLogger().logError(std::string("Error parsing uint (Invalid Argument) - stof error: ").append(e.what()));
+template<typename T>
+static bool parseUnsigned(const std::string& s, T& i) {
+	const char* end = s.data() + s.size();
+	std::from_chars_result result = std::from_chars(s.data(), end, i);
+	if (result.ec == std::errc::result_out_of_range) {
+		LOG_ERROR(std::string("Error parsing uint (Out of Range) - '").append(s).append("'"));
 		return false;
-	} catch (std::out_of_range const& e) {
-		const long long ll {std::stoll(s, &pos)};
-		Logger::getLogger().logError(
-			std::string("Error parsing uint (Out of Range) - std::stoll('")
-			.append(std::to_string(ll)).append("'); pos: ").append(std::to_string(pos))
-			.append("stof error: ").append(e.what())
-		);
+	} else if (result.ec != std::errc() || result.ptr != end) {
+		LOG_ERROR(std::string("Error parsing uint (Invalid Argument) - '").append(s).append("'"));
 		return false;
 	}
 	return true;
 }
+
+bool parseUint(const std::string& s, unsigned int& i) {
+	return parseUnsigned(s, i);
+}
+
+bool parseUint(const std::string& s, uint64_t& i) {
+	return parseUnsigned(s, i);
+}
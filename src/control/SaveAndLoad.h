@@ -13,6 +13,8 @@
 #define MAX_FILE_COUNT 1000
 #define CONFIG_FILE_LOCATION "SimConfigs"
 #define CONFIG_FILE_EXTENSION "csdat"
+#define CHECKPOINT_FILE_EXTENSION "cschk"
+#define CHECKPOINT_VERSION 1u
 
 /**
  * Find and populate an array of all existing config files.
@@ -33,18 +35,42 @@ bool saveToFile(const std::string& location, const SimulationHandler& handler);
  * @param Handler to write the configuration to.
  */
 bool loadFromFile(const std::string& location, SimulationHandler& handler);
+/**
+ * Save the full state of the simulation (configuration and every atom's
+ * position, velocity and type) to a binary checkpoint, so it can be resumed
+ * later with loadCheckpoint.
+ *
+ * The checkpoint is little-endian: a fixed header (magic, version, checksum,
+ * parameters and counts), followed by the atom types, the interaction matrix
+ * and one 64 byte aligned block per atom component. The whole file is built
+ * in memory and written with a single sequential write.
+ * @param location File path to save to.
+ * @param handler Handler containing the simulation to save. In the GPU build
+ * its atoms must first be downloaded (see SimulationHandler::downloadAtoms).
+ */
+bool saveCheckpoint(const std::string& location, const SimulationHandler& handler);
+/**
+ * Restore a checkpoint written by saveCheckpoint. The file is memory mapped
+ * and verified against its checksum before the handler is modified.
+ * @param location File path to load from.
+ * @param handler Handler to restore the simulation to.
+ */
+bool loadCheckpoint(const std::string& location, SimulationHandler& handler);
 /**
  * Delete the file at location.
  */
 bool deleteFile(const std::string& location);
 
 /**
- * Safe cast a string to a float. Failure will be logged.
+ * Safe cast a string to a float. The whole string must be a number. Failure
+ * will be logged.
  * @returns true if parsing is successful, otherwise false
  */
 bool parseFloat(const std::string& s, float& f);
 /**
- * Safe cast a string to an unsigned int. Failure will be logged.
+ * Safe cast a string to an unsigned int. The whole string must be a number.
+ * Failure will be logged.
  * @returns true if parsing is successful, otherwise false
  */
 bool parseUint(const std::string&, unsigned int& i);
+bool parseUint(const std::string&, uint64_t& i);
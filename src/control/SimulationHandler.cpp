@@ -5,12 +5,30 @@
 #include "../../glm/vec3.hpp"
 
 #include <algorithm>
-#include <climits>
+#include <array>
+#include <cmath>
+#include <cstdint>
 #include <iterator>
-#include <random>
+#include <numeric>
+#include <utility>
 #ifdef ITERATE_ON_COMPUTE_SHADER
 #include <iostream>
 
+const char* SHADER_CODE_BIN_COUNT =
+#include "../shaders/BinCount.comp"
+;
+const char* SHADER_CODE_BIN_SCAN =
+#include "../shaders/BinScan.comp"
+;
+const char* SHADER_CODE_BIN_SCAN_BLOCKS =
+#include "../shaders/BinScanBlocks.comp"
+;
+const char* SHADER_CODE_BIN_SCAN_ADD =
+#include "../shaders/BinScanAdd.comp"
+;
+const char* SHADER_CODE_BIN_SCATTER =
+#include "../shaders/BinScatter.comp"
+;
 const char* SHADER_CODE_PASS1 =
 #include "../shaders/IterationPass1.comp"
 ;
@@ -24,36 +42,63 @@ startCondition(StartConditionRandom),
 mSimWidth(0), mSimHeight(0), mDt(1.0f), mDrag(0.5f),
 mInteractionRange(80), mInteractionRange2(6400), mCollisionForce(1.0f), mAtomDiameter(3.0f)
 #ifdef ITERATE_ON_COMPUTE_SHADER
-, mIterationComputePass1(SHADER_CODE_PASS1), mIterationComputePass2(SHADER_CODE_PASS2),
-mAtomTypesBufferID(), mAtomsBufferID(), mInteractionsBufferID()
+, mBinCountPass(SHADER_CODE_BIN_COUNT), mBinScanPass(SHADER_CODE_BIN_SCAN),
+mBinScanBlocksPass(SHADER_CODE_BIN_SCAN_BLOCKS), mBinScanAddPass(SHADER_CODE_BIN_SCAN_ADD),
+mBinScatterPass(SHADER_CODE_BIN_SCATTER),
+mIterationComputePass1(SHADER_CODE_PASS1), mIterationComputePass2(SHADER_CODE_PASS2),
+mAtomTypesStorage(1), mAtomsStorage(2), mInteractionsStorage(3),
+mCellStartStorage(4), mAtomBinsStorage(5), mBinnedAtomsStorage(6), mScanBlocksStorage(7)
 #endif
 , mAtomCount(0), mAtomTypeCount(0), mInteractionCount(0),
-mAtomTypes(), mAtomTypesBuffer(), mAtomsBuffer(), mInteractionsBuffer()
+mAtomTypes(), mAtomTypesBuffer(), mAtoms(), mInteractionsBuffer(), mRandom(Random::randomSeed())
+#ifndef ITERATE_ON_COMPUTE_SHADER
+, mGrid(), mThreadPool(), mBinnedX(), mBinnedY(), mBinnedTypes(), mInteractionMatrix(), mReactionMatrix(),
+mInteractionStride(0), mThreadForcesX(), mThreadForcesY(), mInstructionSet(getBestInstructionSet()),
+mForceKernels(), mTypeKernelFeatures(), mInertTypes(), mTypeKernelFeaturesDirty(true),
+mPairSymmetry(true), mTypeRuns(true), mBinnedTypeRuns(false),
+mNeighbourList(), mNeighbourSkin(DEFAULT_NEIGHBOUR_SKIN), mThreadNeighbours(),
+mMortonSort(), mReorderInterval(DEFAULT_REORDER_INTERVAL), mIterationsSinceReorder(0), mAtomsReordered(false),
+mAtomIds(), mAtomIdsScratch(), mAtomsScratch(), mOrderedAtoms(), mOrderedAtomsValid(false)
+#else
+, mAtomsStaging(), mAtomsReadback(), mAtomsVersion(0), mHostAtomsVersion(0), mReadbackAtomsVersion(0), mReadbackAtomCount(0)
+#endif
 {
-    Logger::getLogger().logMessage("Constructing Handler");
+    LOG_MESSAGE("Constructing Handler");
+#ifndef ITERATE_ON_COMPUTE_SHADER
+    selectForceKernels();
+#endif
 }
 
 SimulationHandler::~SimulationHandler() {
-    Logger::getLogger().logMessage("Destroying Handler");
+    LOG_MESSAGE("Destroying Handler");
     clearAtoms();
 }
 
 #ifdef ITERATE_ON_COMPUTE_SHADER
 void SimulationHandler::initComputeShaders() {
-    Logger::getLogger().logMessage("Initializing Handler Compute Shaders");
-    mIterationComputePass1.init();
-    if (!mIterationComputePass1.isValid()) {
-        Logger::getLogger().logError(std::string("Failed to initialize Compute Shader Pass1"));
-        return;
-    }
-    mIterationComputePass2.init();
-    if (!mIterationComputePass2.isValid()) {
-        Logger::getLogger().logError(std::string("Failed to initialize Compute Shader Pass2"));
-        return;
+    LOG_MESSAGE("Initializing Handler Compute Shaders");
+    const std::array<std::pair<ComputeShader*, const char*>, 7> passes{{
+        { &mBinCountPass,          "BinCount"      },
+        { &mBinScanPass,           "BinScan"       },
+        { &mBinScanBlocksPass,     "BinScanBlocks" },
+        { &mBinScanAddPass,        "BinScanAdd"    },
+        { &mBinScatterPass,        "BinScatter"    },
+        { &mIterationComputePass1, "Pass1"         },
+        { &mIterationComputePass2, "Pass2"         },
+    }};
+    for (auto& [pass, name] : passes) {
+        pass->init();
+        if (!pass->isValid()) {
+            LOG_ERROR(std::string("Failed to initialize Compute Shader ") + name);
+            return;
+        }
     }
-    mAtomTypesBufferID    = BaseShader::createBuffer(mAtomTypesBuffer.data(), sizeof(mAtomTypesBuffer), 1);
-    mAtomsBufferID        = BaseShader::createBuffer(mAtomsBuffer.data(), sizeof(mAtomsBuffer), 2);
-    mInteractionsBufferID = BaseShader::createBuffer(mInteractionsBuffer.data(), sizeof(mInteractionsBuffer), 3);
+    mAtomTypesStorage.reserve(mAtomTypesBuffer.size() * sizeof(AtomTypeRaw));
+    mAtomsStorage.reserve(mAtomsStaging.size() * sizeof(Atom));
+    mInteractionsStorage.reserve(mInteractionsBuffer.size() * sizeof(float));
+    uploadAtomTypes(0, mAtomTypeCount);
+    uploadAtoms();
+    uploadInteractions(0, mInteractionCount);
 }
 #endif
 
@@ -61,6 +106,7 @@ void SimulationHandler::setBounds(float simWidth, float simHeight) {
     mSimWidth  = std::min(std::max(simWidth , MIN_SIM_WIDTH) , MAX_SIM_WIDTH);
     mSimHeight = std::min(std::max(simHeight, MIN_SIM_HEIGHT), MAX_SIM_HEIGHT);
 #ifdef ITERATE_ON_COMPUTE_SHADER
+    mBinCountPass.setUniform(SIMULATION_BOUNDS_UNIFORM, mSimWidth, mSimHeight);
     mIterationComputePass1.setUniform(SIMULATION_BOUNDS_UNIFORM, mSimWidth, mSimHeight);
     mIterationComputePass2.setUniform(SIMULATION_BOUNDS_UNIFORM, mSimWidth, mSimHeight);
 #endif
@@ -100,6 +146,8 @@ void SimulationHandler::setCollisionForce(float collisionForce) {
     mCollisionForce = std::min(std::max(collisionForce, MIN_COLLISION_FORCE), MAX_COLLISION_FORCE);
 #ifdef ITERATE_ON_COMPUTE_SHADER
     mIterationComputePass1.setUniform(COLLISION_FORCE_UNIFORM, mCollisionForce);
+#else
+    mTypeKernelFeaturesDirty = true;
 #endif
 }
 
@@ -110,26 +158,84 @@ void SimulationHandler::setAtomDiameter(float atomDiameter) {
 #endif
 }
 
-void SimulationHandler::clearAtoms() {
-    mAtomCount = 0;
+#ifndef ITERATE_ON_COMPUTE_SHADER
+void SimulationHandler::setThreadCount(size_t threadCount) {
+    mThreadPool.setThreadCount(std::min(std::max(threadCount, (size_t) 1), MAX_THREADS));
 }
 
-void SimulationHandler::initSimulation() {
-    Logger::getLogger().logMessage("Initializing Simulation");
+size_t SimulationHandler::getThreadCount() const {
+    return mThreadPool.getThreadCount();
+}
+
+void SimulationHandler::setInstructionSet(InstructionSet instructionSet) {
+    mInstructionSet = isInstructionSetSupported(instructionSet) ? instructionSet : InstructionSetScalar;
+    selectForceKernels();
+}
+
+void SimulationHandler::setPairSymmetry(bool pairSymmetry) {
+    mPairSymmetry = pairSymmetry;
+    mTypeKernelFeaturesDirty = true;
+}
+
+void SimulationHandler::setTypeRuns(bool typeRuns) {
+    mTypeRuns = typeRuns;
+}
+
+void SimulationHandler::setNeighbourSkin(float skin) {
+    mNeighbourSkin = std::min(std::max(skin, MIN_NEIGHBOUR_SKIN), MAX_NEIGHBOUR_SKIN);
+    // The grid may have been rebuilt without the lists in the meantime
+    mNeighbourList.invalidate();
+}
+
+void SimulationHandler::setReorderInterval(size_t interval) {
+    mReorderInterval = std::min(interval, MAX_REORDER_INTERVAL);
+    mIterationsSinceReorder = 0;
+}
+#endif
+
+void SimulationHandler::setSeed(uint64_t seed) {
+    mRandom.setSeed(seed);
+}
+
+void SimulationHandler::copyConfiguration(const SimulationHandler& source) {
     clearAtoms();
-    for (size_t at = 0; at < mAtomTypeCount; at++) {
-        for (size_t a = 0; a < mAtomTypes[at].quantity; a++) {
-            if (mAtomCount >= MAX_ATOMS)
-                break;
-            mAtomsBuffer[mAtomCount++] = Atom(mAtomTypes[at].id);
-        }
-    }
+    setBounds(source.mSimWidth, source.mSimHeight);
+    setDt(source.mDt);
+    setDrag(source.mDrag);
+    setInteractionRange(source.mInteractionRange);
+    setCollisionForce(source.mCollisionForce);
+    setAtomDiameter(source.mAtomDiameter);
+    startCondition = source.startCondition;
+
+    mAtomTypeCount = source.mAtomTypeCount;
+    mInteractionCount = source.mInteractionCount;
+    mAtomTypes.assign(source.mAtomTypes.begin(), source.mAtomTypes.begin() + mAtomTypeCount);
+    mAtomTypesBuffer.assign(source.mAtomTypesBuffer.begin(), source.mAtomTypesBuffer.begin() + mAtomTypeCount);
+    mInteractionsBuffer.assign(source.mInteractionsBuffer.begin(), source.mInteractionsBuffer.begin() + mInteractionCount);
 #ifdef ITERATE_ON_COMPUTE_SHADER
-    BaseShader::writeBuffer(mAtomsBufferID, mAtomsBuffer.data(), sizeof(mAtomsBuffer));
+    uploadAtomTypes(0, mAtomTypeCount);
+    uploadInteractions(0, mInteractionCount);
+#else
+    buildInteractionMatrices();
 #endif
-#ifdef ITERATE_ON_COMPUTE_SHADER
-    BaseShader::readBuffer(mAtomsBufferID, mAtomsBuffer.data(), sizeof(mAtomsBuffer));
+}
+
+void SimulationHandler::clearAtoms() {
+    mAtomCount = 0;
+#ifndef ITERATE_ON_COMPUTE_SHADER
+    mNeighbourList.invalidate();
+    mAtomsReordered = false;
+    mIterationsSinceReorder = 0;
 #endif
+}
+
+void SimulationHandler::initSimulation() {
+    LOG_MESSAGE("Initializing Simulation");
+    clearAtoms();
+    mAtoms.resize(getAtomCount());
+    for (size_t at = 0; at < mAtomTypeCount; at++)
+        for (size_t a = 0; a < mAtomTypes[at].quantity; a++)
+            mAtoms.set(mAtomCount++, Atom(mAtomTypes[at].id));
     switch (startCondition) {
         default:
         case StartConditionRandom:            initAtomPositionsRandom();            break;
@@ -138,104 +244,529 @@ void SimulationHandler::initSimulation() {
         case StartConditionRings:             initAtomPositionsRings();             break;
     }
 #ifdef ITERATE_ON_COMPUTE_SHADER
-    BaseShader::writeBuffer(mAtomsBufferID, mAtomsBuffer.data(), sizeof(mAtomsBuffer));
+    uploadAtoms();
+#endif
+}
+
+void SimulationHandler::setAtoms(size_t count, const float* x, const float* y, const float* vx, const float* vy, const atom_type_id* atomType) {
+    clearAtoms();
+    mAtoms.resize(count);
+    std::copy(x, x + count, mAtoms.x.begin());
+    std::copy(y, y + count, mAtoms.y.begin());
+    std::copy(vx, vx + count, mAtoms.vx.begin());
+    std::copy(vy, vy + count, mAtoms.vy.begin());
+    std::fill(mAtoms.fx.begin(), mAtoms.fx.end(), 0.0f);
+    std::fill(mAtoms.fy.begin(), mAtoms.fy.end(), 0.0f);
+    std::copy(atomType, atomType + count, mAtoms.atomType.begin());
+    mAtomCount = count;
+#ifdef ITERATE_ON_COMPUTE_SHADER
+    uploadAtoms();
 #endif
 }
 
 void SimulationHandler::iterateSimulation() {
 #ifdef ITERATE_ON_COMPUTE_SHADER
-    mIterationComputePass1.run(mAtomCount, mAtomCount, 1);
-    mIterationComputePass2.run(mAtomCount, 1, 1);
+    size_t cellsX;
+    size_t cellsY;
+    SpatialGrid::getGridSize(mSimWidth, mSimHeight, mInteractionRange, mAtomCount, cellsX, cellsY);
+    binAtoms((GLuint) cellsX, (GLuint) cellsY);
+
+    GLuint workgroups = (GLuint) ((mAtomCount + COMPUTE_WORKGROUP_SIZE - 1) / COMPUTE_WORKGROUP_SIZE);
+    mIterationComputePass1.setUniform(ATOM_COUNT_UNIFORM, (GLuint) mAtomCount);
+    mIterationComputePass1.setUniform(CELLS_X_UNIFORM, (GLuint) cellsX);
+    mIterationComputePass1.setUniform(CELLS_Y_UNIFORM, (GLuint) cellsY);
+    mIterationComputePass2.setUniform(ATOM_COUNT_UNIFORM, (GLuint) mAtomCount);
+    mIterationComputePass1.run(workgroups, 1, 1);
+    mIterationComputePass2.run(workgroups, 1, 1);
+    mAtomsVersion++;
 #else
-    for (size_t i = 0; i < mAtomCount; i++) {
-        Atom& atomA = mAtomsBuffer[i];
-        for (size_t j = 0; j < mAtomCount; j++) {
-            if (i == j) continue;
-            Atom& atomB = mAtomsBuffer[j];
-
-            float g = mInteractionsBuffer[INTERACTION_INDEX(atomA.atomType, atomB.atomType)];
-
-            float dX = atomA.x - atomB.x;
-            float dY = atomA.y - atomB.y;
-
-            float dXAbs = std::abs(dX);
-            float dXAlt = mSimWidth - dXAbs;
-            dX = (dXAlt < dXAbs) ? dXAlt * (atomA.x < atomB.x ? 1.0f : -1.0f) : dX;
-
-            float dYAbs = std::abs(dY);
-            float dYAlt = mSimHeight - dYAbs;
-            dY = (dYAlt < dYAbs) ? dYAlt * (atomA.y < atomB.y ? 1.0f : -1.0f) : dY;
-
-            if (dX == 0 && dY == 0)
-                continue;
-
-            float d2 = dX * dX + dY * dY;
-            if (d2 < mInteractionRange2) {
-                float d = std::sqrt(d2);
-                float f = g / d;
-                f += (d < mAtomDiameter) ? (mAtomDiameter - d) * mCollisionForce / mAtomDiameter : 0.0f;
-                atomA.fx += f * dX;
-                atomA.fy += f * dY;
+    mOrderedAtomsValid = false;
+    if (mReorderInterval > 0 && ++mIterationsSinceReorder >= mReorderInterval)
+        reorderAtoms();
+
+    if (mTypeKernelFeaturesDirty)
+        selectTypeKernelFeatures();
+
+    mBinnedX.resize(mAtomCount);
+    mBinnedY.resize(mAtomCount);
+    mBinnedTypes.resize(mAtomCount);
+
+    bool neighbourLists = mNeighbourSkin > 0.0f;
+    mBinnedTypeRuns = false;
+    if (neighbourLists) {
+        mNeighbourList.update(mThreadPool, mGrid, mSimWidth, mSimHeight, mInteractionRange, mNeighbourSkin,
+                              mPairSymmetry, mAtoms.x.data(), mAtoms.y.data(), mAtomCount);
+        mThreadNeighbours.resize(getThreadCount());
+        for (NeighbourBuffer& buffer : mThreadNeighbours) {
+            size_t capacity = mNeighbourList.getMaxNeighbourCount();
+            buffer.x.resize(capacity);
+            buffer.y.resize(capacity);
+            buffer.types.resize(capacity);
+            buffer.fx.resize(capacity);
+            buffer.fy.resize(capacity);
+        }
+    } else {
+        // Type runs only pay for the extra per-run calls once the runs are long
+        size_t cellsX;
+        size_t cellsY;
+        SpatialGrid::getGridSize(mSimWidth, mSimHeight, mInteractionRange, mAtomCount, cellsX, cellsY);
+        mBinnedTypeRuns = mTypeRuns && mAtomCount >= cellsX * cellsY * mAtomTypeCount * MIN_TYPE_RUN_LENGTH;
+        mGrid.build(mSimWidth, mSimHeight, mInteractionRange, mAtoms.x.data(), mAtoms.y.data(), mAtomCount,
+                    mBinnedTypeRuns ? mAtoms.atomType.data() : nullptr, mAtomTypeCount);
+    }
+    mThreadPool.parallelFor(mAtomCount, [this](size_t begin, size_t end) {
+        for (size_t slot = begin; slot < end; slot++) {
+            unsigned int i = mGrid.getBinnedAtom(slot);
+            mBinnedX[slot] = mAtoms.x[i];
+            mBinnedY[slot] = mAtoms.y[i];
+            mBinnedTypes[slot] = mAtoms.atomType[i];
+        }
+    });
+
+    if (mPairSymmetry) {
+        mThreadForcesX.resize(getThreadCount());
+        mThreadForcesY.resize(getThreadCount());
+        for (size_t t = 0; t < getThreadCount(); t++) {
+            mThreadForcesX[t].resize(mAtomCount, 0.0f);
+            mThreadForcesY[t].resize(mAtomCount, 0.0f);
+        }
+        // A fixed partition per buffer keeps the summation order, and so the
+        // result, independent of how the threads are scheduled
+        mThreadPool.parallelForPartitioned(mAtomCount, [this, neighbourLists](size_t begin, size_t end, size_t partition) {
+            if (neighbourLists)
+                accumulatePairListForces(begin, end, partition);
+            else
+                accumulatePairForces(begin, end, partition);
+        });
+        mThreadPool.parallelFor(mAtomCount, [this](size_t begin, size_t end) { reduceForces(begin, end); });
+    } else if (neighbourLists) {
+        mThreadPool.parallelForIndexed(mAtomCount, [this](size_t begin, size_t end, size_t thread) {
+            accumulateListForces(begin, end, thread);
+        });
+    } else {
+        mThreadPool.parallelFor(mAtomCount, [this](size_t begin, size_t end) { accumulateForces(begin, end); });
+    }
+    mThreadPool.parallelFor(mAtomCount, [this](size_t begin, size_t end) { integrateAtoms(begin, end); });
+#endif
+}
+
+#ifndef ITERATE_ON_COMPUTE_SHADER
+void SimulationHandler::accumulateForces(size_t begin, size_t end) {
+    const ForceKernelParams params{ mSimWidth, mSimHeight, mInteractionRange2, mAtomDiameter, mCollisionForce };
+    std::array<size_t, 9> neighbourCells{};
+    size_t neighbourCount = 0;
+    size_t currentCell = SIZE_MAX;
+    unsigned int wrapMask = KernelFeatureAll;
+    for (size_t slot = begin; slot < end; slot++) {
+        unsigned int i = mGrid.getBinnedAtom(slot);
+        size_t cell = mGrid.getAtomCell(i);
+        if (cell != currentCell) {
+            neighbourCount = mGrid.getNeighbourCells(currentCell = cell, neighbourCells);
+            wrapMask = mGrid.isWrappingCell(cell) ? KernelFeatureAll : KernelFeatureAll & ~KernelFeatureWrap;
+        }
+
+        float fx = 0.0f;
+        float fy = 0.0f;
+        if (mInertTypes[mBinnedTypes[slot]]) {
+            mAtoms.fx[i] = fx;
+            mAtoms.fy[i] = fy;
+            continue;
+        }
+        const ForceKernelSet& kernels = mForceKernels[mTypeKernelFeatures[mBinnedTypes[slot]] & wrapMask];
+        const float* interactions = mInteractionMatrix.data() + mBinnedTypes[slot] * mInteractionStride;
+        for (size_t n = 0; n < neighbourCount; n++) {
+            if (mBinnedTypeRuns) {
+                kernels.run(
+                    params, mBinnedX[slot], mBinnedY[slot], interactions, mBinnedX.data(), mBinnedY.data(),
+                    mGrid.getRunStarts(neighbourCells[n]), mAtomTypeCount, 0, fx, fy
+                );
+            } else {
+                size_t cellStart = mGrid.getCellStart(neighbourCells[n]);
+                kernels.force(
+                    params, mBinnedX[slot], mBinnedY[slot], interactions,
+                    mBinnedX.data() + cellStart, mBinnedY.data() + cellStart, mBinnedTypes.data() + cellStart,
+                    mGrid.getCellEnd(neighbourCells[n]) - cellStart, fx, fy
+                );
             }
         }
+        mAtoms.fx[i] = fx;
+        mAtoms.fy[i] = fy;
     }
-    for (Atom& atom : mAtomsBuffer) {
-        atom.vx = (atom.vx + atom.fx * mDt) * mDrag;
-        atom.vy = (atom.vy + atom.fy * mDt) * mDrag;
-        atom.fx = 0.0f;
-        atom.fy = 0.0f;
-        atom.x += atom.vx * mDt;
-        atom.y += atom.vy * mDt;
-
-        atom.x += (atom.x < 0) ? mSimWidth :
-            (atom.x >= mSimWidth) ? -mSimWidth : 0.0f;
-        atom.y += (atom.y < 0) ? mSimHeight :
-            (atom.y >= mSimHeight) ? -mSimHeight : 0.0f;
+}
+
+void SimulationHandler::accumulatePairForces(size_t begin, size_t end, size_t partition) {
+    const ForceKernelParams params{ mSimWidth, mSimHeight, mInteractionRange2, mAtomDiameter, mCollisionForce };
+    float* forcesX = mThreadForcesX[partition].data();
+    float* forcesY = mThreadForcesY[partition].data();
+    std::array<size_t, 9> neighbourCells{};
+    size_t neighbourCount = 0;
+    size_t currentCell = SIZE_MAX;
+    unsigned int wrapMask = KernelFeatureAll;
+    for (size_t slot = begin; slot < end; slot++) {
+        unsigned int i = mGrid.getBinnedAtom(slot);
+        size_t cell = mGrid.getAtomCell(i);
+        if (cell != currentCell) {
+            // Only the neighbours with a higher index, the others visit this cell instead
+            std::array<size_t, 9> cells{};
+            size_t cellCount = mGrid.getNeighbourCells(currentCell = cell, cells);
+            neighbourCount = 0;
+            for (size_t n = 0; n < cellCount; n++)
+                if (cells[n] > cell)
+                    neighbourCells[neighbourCount++] = cells[n];
+            wrapMask = mGrid.isWrappingCell(cell) ? KernelFeatureAll : KernelFeatureAll & ~KernelFeatureWrap;
+        }
+
+        // The forces on this atom from earlier slots are kept, only its own pairs are skipped
+        if (mInertTypes[mBinnedTypes[slot]])
+            continue;
+        const ForceKernelSet& kernels = mForceKernels[mTypeKernelFeatures[mBinnedTypes[slot]] & wrapMask];
+        const float* interactions = mInteractionMatrix.data() + mBinnedTypes[slot] * mInteractionStride;
+        const float* reactions = mReactionMatrix.data() + mBinnedTypes[slot] * mInteractionStride;
+        float fx = 0.0f;
+        float fy = 0.0f;
+        if (mBinnedTypeRuns) {
+            // Own cell from the next slot on, then the later neighbouring cells
+            for (size_t n = 0; n <= neighbourCount; n++) {
+                kernels.pairRun(
+                    params, mBinnedX[slot], mBinnedY[slot], interactions, reactions, mBinnedX.data(), mBinnedY.data(),
+                    mGrid.getRunStarts(n == 0 ? cell : neighbourCells[n - 1]), mAtomTypeCount, n == 0 ? slot + 1 : 0,
+                    fx, fy, forcesX, forcesY
+                );
+            }
+            forcesX[slot] += fx;
+            forcesY[slot] += fy;
+            continue;
+        }
+
+        size_t next = slot + 1;
+        kernels.pair(
+            params, mBinnedX[slot], mBinnedY[slot], interactions, reactions,
+            mBinnedX.data() + next, mBinnedY.data() + next, mBinnedTypes.data() + next,
+            mGrid.getCellEnd(cell) - next, fx, fy, forcesX + next, forcesY + next
+        );
+        for (size_t n = 0; n < neighbourCount; n++) {
+            size_t cellStart = mGrid.getCellStart(neighbourCells[n]);
+            kernels.pair(
+                params, mBinnedX[slot], mBinnedY[slot], interactions, reactions,
+                mBinnedX.data() + cellStart, mBinnedY.data() + cellStart, mBinnedTypes.data() + cellStart,
+                mGrid.getCellEnd(neighbourCells[n]) - cellStart, fx, fy, forcesX + cellStart, forcesY + cellStart
+            );
+        }
+        forcesX[slot] += fx;
+        forcesY[slot] += fy;
     }
+}
+
+void SimulationHandler::accumulateListForces(size_t begin, size_t end, size_t thread) {
+    const ForceKernelParams params{ mSimWidth, mSimHeight, mInteractionRange2, mAtomDiameter, mCollisionForce };
+    NeighbourBuffer& buffer = mThreadNeighbours[thread];
+    for (size_t slot = begin; slot < end; slot++) {
+        float fx = 0.0f;
+        float fy = 0.0f;
+        if (!mInertTypes[mBinnedTypes[slot]]) {
+            const unsigned int* neighbours = mNeighbourList.getNeighbours(slot);
+            size_t count = mNeighbourList.getNeighbourCount(slot);
+            for (size_t n = 0; n < count; n++) {
+                buffer.x[n] = mBinnedX[neighbours[n]];
+                buffer.y[n] = mBinnedY[neighbours[n]];
+                buffer.types[n] = mBinnedTypes[neighbours[n]];
+            }
+
+            // Listed neighbours can be from across the edges of the simulation, so always wrap
+            const float* interactions = mInteractionMatrix.data() + mBinnedTypes[slot] * mInteractionStride;
+            mForceKernels[mTypeKernelFeatures[mBinnedTypes[slot]]].force(
+                params, mBinnedX[slot], mBinnedY[slot], interactions,
+                buffer.x.data(), buffer.y.data(), buffer.types.data(), count, fx, fy
+            );
+        }
+        unsigned int i = mGrid.getBinnedAtom(slot);
+        mAtoms.fx[i] = fx;
+        mAtoms.fy[i] = fy;
+    }
+}
+
+void SimulationHandler::accumulatePairListForces(size_t begin, size_t end, size_t partition) {
+    const ForceKernelParams params{ mSimWidth, mSimHeight, mInteractionRange2, mAtomDiameter, mCollisionForce };
+    NeighbourBuffer& buffer = mThreadNeighbours[partition];
+    float* forcesX = mThreadForcesX[partition].data();
+    float* forcesY = mThreadForcesY[partition].data();
+    for (size_t slot = begin; slot < end; slot++) {
+        if (mInertTypes[mBinnedTypes[slot]])
+            continue;
+        const unsigned int* neighbours = mNeighbourList.getNeighbours(slot);
+        size_t count = mNeighbourList.getNeighbourCount(slot);
+        for (size_t n = 0; n < count; n++) {
+            buffer.x[n] = mBinnedX[neighbours[n]];
+            buffer.y[n] = mBinnedY[neighbours[n]];
+            buffer.types[n] = mBinnedTypes[neighbours[n]];
+            buffer.fx[n] = 0.0f;
+            buffer.fy[n] = 0.0f;
+        }
+
+        const float* interactions = mInteractionMatrix.data() + mBinnedTypes[slot] * mInteractionStride;
+        const float* reactions = mReactionMatrix.data() + mBinnedTypes[slot] * mInteractionStride;
+        float fx = 0.0f;
+        float fy = 0.0f;
+        mForceKernels[mTypeKernelFeatures[mBinnedTypes[slot]]].pair(
+            params, mBinnedX[slot], mBinnedY[slot], interactions, reactions,
+            buffer.x.data(), buffer.y.data(), buffer.types.data(), count, fx, fy, buffer.fx.data(), buffer.fy.data()
+        );
+        for (size_t n = 0; n < count; n++) {
+            forcesX[neighbours[n]] += buffer.fx[n];
+            forcesY[neighbours[n]] += buffer.fy[n];
+        }
+        forcesX[slot] += fx;
+        forcesY[slot] += fy;
+    }
+}
+
+void SimulationHandler::reduceForces(size_t begin, size_t end) {
+    float* totalX = mThreadForcesX[0].data();
+    float* totalY = mThreadForcesY[0].data();
+    for (size_t t = 1; t < mThreadForcesX.size(); t++) {
+        float* forcesX = mThreadForcesX[t].data();
+        float* forcesY = mThreadForcesY[t].data();
+        for (size_t slot = begin; slot < end; slot++) {
+            totalX[slot] += forcesX[slot];
+            totalY[slot] += forcesY[slot];
+            forcesX[slot] = 0.0f;
+            forcesY[slot] = 0.0f;
+        }
+    }
+    for (size_t slot = begin; slot < end; slot++) {
+        unsigned int i = mGrid.getBinnedAtom(slot);
+        mAtoms.fx[i] = totalX[slot];
+        mAtoms.fy[i] = totalY[slot];
+        totalX[slot] = 0.0f;
+        totalY[slot] = 0.0f;
+    }
+}
+
+void SimulationHandler::integrateAtoms(size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        mAtoms.vx[i] = (mAtoms.vx[i] + mAtoms.fx[i] * mDt) * mDrag;
+        mAtoms.vy[i] = (mAtoms.vy[i] + mAtoms.fy[i] * mDt) * mDrag;
+        mAtoms.fx[i] = 0.0f;
+        mAtoms.fy[i] = 0.0f;
+        mAtoms.x[i] += mAtoms.vx[i] * mDt;
+        mAtoms.y[i] += mAtoms.vy[i] * mDt;
+
+        // Fast atoms can move more than the whole simulation in one step
+        mAtoms.x[i] = wrapPosition(mAtoms.x[i], mSimWidth);
+        mAtoms.y[i] = wrapPosition(mAtoms.y[i], mSimHeight);
+    }
+}
+
+/**
+ * Copy the first count atoms of from into to, moving the atom at each index i
+ * to index destination[i].
+ */
+static void scatterAtoms(const AtomArrays& from, AtomArrays& to, const unsigned int* destination, size_t count) {
+    to.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        unsigned int d = destination[i];
+        to.x[d] = from.x[i];
+        to.y[d] = from.y[i];
+        to.vx[d] = from.vx[i];
+        to.vy[d] = from.vy[i];
+        to.fx[d] = from.fx[i];
+        to.fy[d] = from.fy[i];
+        to.atomType[d] = from.atomType[i];
+    }
+}
+
+void SimulationHandler::selectForceKernels() {
+    for (unsigned int features = 0; features < KERNEL_FEATURE_COMBINATIONS; features++)
+        mForceKernels[features] = getForceKernels(mInstructionSet, features);
+}
+
+void SimulationHandler::selectTypeKernelFeatures() {
+    // Pick the cheapest kernels each type can use, so the common cases skip
+    // the collision test and the per-pair interaction lookup
+    bool collisions = mCollisionForce > 0.0f;
+    mTypeKernelFeatures.assign(mAtomTypeCount, KernelFeatureWrap | (collisions ? (unsigned int) KernelFeatureCollisions : 0u));
+    mInertTypes.assign(mAtomTypeCount, false);
+    for (atom_type_id a = 0; a < mAtomTypeCount; a++) {
+        const float* interactions = mInteractionMatrix.data() + a * mInteractionStride;
+        const float* reactions = mReactionMatrix.data() + a * mInteractionStride;
+        bool uniform = true;
+        for (atom_type_id b = 1; b < mAtomTypeCount; b++)
+            uniform = uniform && interactions[b] == interactions[0] && (!mPairSymmetry || reactions[b] == reactions[0]);
+        if (!uniform)
+            mTypeKernelFeatures[a] |= KernelFeatureGather;
+        else if (!collisions && interactions[0] == 0.0f && (!mPairSymmetry || reactions[0] == 0.0f))
+            mInertTypes[a] = true;
+    }
+    mTypeKernelFeaturesDirty = false;
+}
+
+void SimulationHandler::buildInteractionMatrices() {
+    mInteractionStride = (mAtomTypeCount + INTERACTION_ROW_ALIGNMENT - 1) / INTERACTION_ROW_ALIGNMENT * INTERACTION_ROW_ALIGNMENT;
+    mInteractionMatrix.assign(mAtomTypeCount * mInteractionStride, 0.0f);
+    mReactionMatrix.assign(mAtomTypeCount * mInteractionStride, 0.0f);
+    for (atom_type_id a = 0; a < mAtomTypeCount; a++) {
+        for (atom_type_id b = 0; b < mAtomTypeCount; b++) {
+            mInteractionMatrix[a * mInteractionStride + b] = mInteractionsBuffer[INTERACTION_INDEX(a, b)];
+            mReactionMatrix[a * mInteractionStride + b] = mInteractionsBuffer[INTERACTION_INDEX(b, a)];
+        }
+    }
+    mTypeKernelFeaturesDirty = true;
+}
+
+void SimulationHandler::reorderAtoms() {
+    mIterationsSinceReorder = 0;
+    if (!mAtomsReordered) {
+        mAtomIds.resize(mAtomCount);
+        std::iota(mAtomIds.begin(), mAtomIds.end(), 0u);
+        mAtomsReordered = true;
+    }
+    mMortonSort.sort(mThreadPool, mSimWidth, mSimHeight, mAtoms.x.data(), mAtoms.y.data(), mAtomCount);
+
+    const unsigned int* order = mMortonSort.getOrder();
+    mAtomsScratch.resize(mAtomCount);
+    mAtomIdsScratch.resize(mAtomCount);
+    mThreadPool.parallelFor(mAtomCount, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            unsigned int from = order[i];
+            mAtomsScratch.x[i] = mAtoms.x[from];
+            mAtomsScratch.y[i] = mAtoms.y[from];
+            mAtomsScratch.vx[i] = mAtoms.vx[from];
+            mAtomsScratch.vy[i] = mAtoms.vy[from];
+            mAtomsScratch.fx[i] = mAtoms.fx[from];
+            mAtomsScratch.fy[i] = mAtoms.fy[from];
+            mAtomsScratch.atomType[i] = mAtoms.atomType[from];
+            mAtomIdsScratch[i] = mAtomIds[from];
+        }
+    }, 1024);
+    std::swap(mAtoms, mAtomsScratch);
+    std::swap(mAtomIds, mAtomIdsScratch);
+    // The lists index the atoms by their old positions
+    mNeighbourList.invalidate();
+}
+
+void SimulationHandler::restoreAtomOrder() {
+    if (!mAtomsReordered)
+        return;
+    scatterAtoms(mAtoms, mAtomsScratch, mAtomIds.data(), mAtomCount);
+    std::swap(mAtoms, mAtomsScratch);
+    mAtomsReordered = false;
+    mNeighbourList.invalidate();
+}
 #endif
+
+#ifdef ITERATE_ON_COMPUTE_SHADER
+void SimulationHandler::binAtoms(GLuint cellsX, GLuint cellsY) {
+    GLuint atomWorkgroups = (GLuint) ((mAtomCount + COMPUTE_WORKGROUP_SIZE - 1) / COMPUTE_WORKGROUP_SIZE);
+    // One extra (always empty) cell, which scans to one past the last slot
+    GLuint scanCount = cellsX * cellsY + 1;
+    GLuint blockCount = (scanCount + COMPUTE_WORKGROUP_SIZE - 1) / COMPUTE_WORKGROUP_SIZE;
+
+    mCellStartStorage.clear(0, scanCount * sizeof(GLuint));
+    mAtomBinsStorage.reserve(mAtomCount * 2 * sizeof(GLuint));
+    mBinnedAtomsStorage.reserve(mAtomCount * 4 * sizeof(GLuint));
+    mScanBlocksStorage.reserve(blockCount * sizeof(GLuint));
+
+    mBinCountPass.setUniform(ATOM_COUNT_UNIFORM, (GLuint) mAtomCount);
+    mBinCountPass.setUniform(CELLS_X_UNIFORM, cellsX);
+    mBinCountPass.setUniform(CELLS_Y_UNIFORM, cellsY);
+    mBinCountPass.run(atomWorkgroups, 1, 1);
+
+    mBinScanPass.setUniform(SCAN_COUNT_UNIFORM, scanCount);
+    mBinScanPass.run(blockCount, 1, 1);
+    mBinScanBlocksPass.setUniform(BLOCK_COUNT_UNIFORM, blockCount);
+    mBinScanBlocksPass.run(1, 1, 1);
+    mBinScanAddPass.setUniform(SCAN_COUNT_UNIFORM, scanCount);
+    mBinScanAddPass.run(blockCount, 1, 1);
+
+    mBinScatterPass.setUniform(ATOM_COUNT_UNIFORM, (GLuint) mAtomCount);
+    mBinScatterPass.run(atomWorkgroups, 1, 1);
+}
+
+void SimulationHandler::uploadAtoms() {
+    mAtomsStaging.resize(mAtomCount);
+    for (size_t i = 0; i < mAtomCount; i++)
+        mAtomsStaging[i] = mAtoms.get(i);
+    mAtomsStorage.write(mAtomsStaging.data(), 0, mAtomCount * sizeof(Atom));
+    mHostAtomsVersion = ++mAtomsVersion;
 }
 
-atom_type_id SimulationHandler::newAtomType() {
-    if (mAtomTypeCount >= MAX_ATOM_TYPES)
-        return INT_MAX;
+void SimulationHandler::downloadAtoms() {
+    if (mHostAtomsVersion == mAtomsVersion)
+        return;
+    if (!mAtomsReadback.isPending() || mReadbackAtomsVersion != mAtomsVersion)
+        requestAtoms();
+    receiveAtoms(true);
+}
+
+void SimulationHandler::requestAtoms() {
+    mAtomsReadback.request(mAtomsStorage, 0, mAtomCount * sizeof(Atom));
+    mReadbackAtomsVersion = mAtomsVersion;
+    mReadbackAtomCount = mAtomCount;
+}
 
+bool SimulationHandler::receiveAtoms(bool wait) {
+    if (!mAtomsReadback.isPending() || !(wait || mAtomsReadback.isReady()))
+        return false;
+    const auto* atoms = static_cast<const Atom*>(mAtomsReadback.getData());
+    if (mReadbackAtomCount != mAtomCount)
+        return false;
+    for (size_t i = 0; i < mAtomCount; i++)
+        mAtoms.set(i, atoms[i]);
+    mHostAtomsVersion = mReadbackAtomsVersion;
+    return true;
+}
+
+void SimulationHandler::uploadAtomTypes(size_t first, size_t count) {
+    mAtomTypesStorage.write(mAtomTypesBuffer.data() + first, first * sizeof(AtomTypeRaw), count * sizeof(AtomTypeRaw));
+}
+
+void SimulationHandler::uploadInteractions(size_t first, size_t count) {
+    mInteractionsStorage.write(mInteractionsBuffer.data() + first, first * sizeof(float), count * sizeof(float));
+}
+#endif
+
+atom_type_id SimulationHandler::newAtomType() {
     int index = mAtomTypeCount++;
-    atom_type_id id = (mAtomTypes[index] = AtomType(index)).id;
-    mAtomTypesBuffer[index] = AtomTypeRaw(mAtomTypes[index]);
-
-    for (atom_type_id id2 : getAtomTypeIds()) {
-        if (mInteractionCount >= MAX_INTERACTIONS)
-            break;
-        mInteractionsBuffer[mInteractionCount++] = 0.0f;
-        if (id != id2)
-            mInteractionsBuffer[mInteractionCount++] = 0.0f;
-    }
+    atom_type_id id = mAtomTypes.emplace_back(index, mRandom).id;
+    mAtomTypesBuffer.emplace_back(mAtomTypes[index]);
+
+    mInteractionCount = mAtomTypeCount * mAtomTypeCount;
+    mInteractionsBuffer.resize(mInteractionCount, 0.0f);
 
 #ifdef ITERATE_ON_COMPUTE_SHADER
-    BaseShader::writeBuffer(mAtomTypesBufferID, mAtomTypesBuffer.data(), sizeof(mAtomTypesBuffer));
-    BaseShader::writeBuffer(mInteractionsBufferID, mInteractionsBuffer.data(), sizeof(mInteractionsBuffer));
+    // The interactions of a new type are appended after the index * index
+    // interactions of the earlier types (see INTERACTION_INDEX)
+    size_t interactionCount = index * index;
+    uploadAtomTypes(index, 1);
+    uploadInteractions(interactionCount, mInteractionCount - interactionCount);
+#else
+    buildInteractionMatrices();
 #endif
     return id;
 }
 
 void SimulationHandler::removeAtomType(atom_type_id atomTypeId) {
 #ifdef ITERATE_ON_COMPUTE_SHADER
-    BaseShader::readBuffer(mAtomsBufferID, mAtomsBuffer.data(), sizeof(mAtomsBuffer));
+    downloadAtoms();
+#else
+    restoreAtomOrder();
 #endif
 
-    mAtomCount = std::remove_if(mAtomsBuffer.begin(), mAtomsBuffer.begin() + mAtomCount,
-        [atomTypeId](Atom& atom) {
-            return atom.atomType == atomTypeId;
-        }) - mAtomsBuffer.begin();
+    size_t atomCount = 0;
+    for (size_t a = 0; a < mAtomCount; a++)
+        if (mAtoms.atomType[a] != atomTypeId)
+            mAtoms.set(atomCount++, mAtoms.get(a));
+    mAtomCount = atomCount;
+    mAtoms.resize(mAtomCount);
 
-    std::array<unsigned int, MAX_ATOM_TYPES> newIndices{};
+    std::vector<unsigned int> newIndices(mAtomTypeCount);
     int counter = 0;
     for (size_t at = 0; at < mAtomTypeCount; at++)
         if (mAtomTypes[at].id != atomTypeId)
             newIndices[at] = counter++;
     for (size_t a = 0; a < mAtomCount; a++)
-        mAtomsBuffer[a].atomType = newIndices[mAtomsBuffer[a].atomType];
-    bool toRemove[MAX_INTERACTIONS]{false };
+        mAtoms.atomType[a] = newIndices[mAtoms.atomType[a]];
+    std::vector<bool> toRemove(mInteractionCount, false);
     for (unsigned int i = atomTypeId * atomTypeId; i < (atomTypeId + 1) * (atomTypeId + 1); i++)
         toRemove[i] = true;
     for (unsigned int n = atomTypeId + 1; n < mAtomTypeCount; n++) {
@@ -244,14 +775,17 @@ void SimulationHandler::removeAtomType(atom_type_id atomTypeId) {
     }
     unsigned int index = 0;
     mInteractionCount = std::remove_if(mInteractionsBuffer.begin(), mInteractionsBuffer.begin() + mInteractionCount,
-        [&index, toRemove](float& in) {
+        [&index, &toRemove](float& in) {
             return toRemove[index++];
         }) - mInteractionsBuffer.begin();
+    mInteractionsBuffer.resize(mInteractionCount);
 
     mAtomTypeCount = std::remove_if(mAtomTypes.begin(), mAtomTypes.begin() + mAtomTypeCount,
         [atomTypeId](AtomType& atomType) {
             return atomType.id == atomTypeId;
         }) - mAtomTypes.begin();
+    mAtomTypes.erase(mAtomTypes.begin() + mAtomTypeCount, mAtomTypes.end());
+    mAtomTypesBuffer.resize(mAtomTypeCount);
     for (unsigned int i = 0; i < mAtomTypeCount; i++) {
         mAtomTypes[i].id = i;
         mAtomTypesBuffer[i] = AtomTypeRaw(mAtomTypes[i]);
@@ -259,9 +793,11 @@ void SimulationHandler::removeAtomType(atom_type_id atomTypeId) {
     mInteractionCount = mAtomTypeCount * mAtomTypeCount;
 
 #ifdef ITERATE_ON_COMPUTE_SHADER
-    BaseShader::writeBuffer(mInteractionsBufferID, mInteractionsBuffer.data(), sizeof(mInteractionsBuffer));
-    BaseShader::writeBuffer(mAtomsBufferID, mAtomsBuffer.data(), sizeof(mAtomsBuffer));
-    BaseShader::writeBuffer(mAtomTypesBufferID, mAtomTypesBuffer.data(), sizeof(mAtomTypesBuffer));
+    uploadInteractions(0, mInteractionCount);
+    uploadAtoms();
+    uploadAtomTypes(0, mAtomTypeCount);
+#else
+    buildInteractionMatrices();
 #endif
 }
 
@@ -269,9 +805,11 @@ void SimulationHandler::clearAtomTypes() {
     clearAtoms();
     mAtomTypeCount = 0;
     mInteractionCount = 0;
-#ifdef ITERATE_ON_COMPUTE_SHADER
-    BaseShader::writeBuffer(mAtomTypesBufferID, mAtomTypesBuffer.data(), sizeof(mAtomTypesBuffer));
-    BaseShader::writeBuffer(mInteractionsBufferID, mInteractionsBuffer.data(), sizeof(mInteractionsBuffer));
+    mAtomTypes.clear();
+    mAtomTypesBuffer.clear();
+    mInteractionsBuffer.clear();
+#ifndef ITERATE_ON_COMPUTE_SHADER
+    buildInteractionMatrices();
 #endif
 }
 
@@ -289,40 +827,40 @@ void SimulationHandler::setAtomTypeColor(atom_type_id atomTypeId, glm::vec3 colo
         mAtomTypes[atomTypeId].g = color.g;
         mAtomTypes[atomTypeId].b = color.b;
         mAtomTypesBuffer[atomTypeId] = AtomTypeRaw(mAtomTypes[atomTypeId]);
-    }
 #ifdef ITERATE_ON_COMPUTE_SHADER
-    BaseShader::writeBuffer(mAtomTypesBufferID, mAtomTypesBuffer.data(), sizeof(mAtomTypesBuffer));
+        uploadAtomTypes(atomTypeId, 1);
 #endif
+    }
 }
 
 void SimulationHandler::setAtomTypeColorR(atom_type_id atomTypeId, float r) {
     if (atomTypeId < mAtomTypeCount) {
         mAtomTypes[atomTypeId].r = r;
         mAtomTypesBuffer[atomTypeId] = AtomTypeRaw(mAtomTypes[atomTypeId]);
-    }
 #ifdef ITERATE_ON_COMPUTE_SHADER
-    BaseShader::writeBuffer(mAtomTypesBufferID, mAtomTypesBuffer.data(), sizeof(mAtomTypesBuffer));
+        uploadAtomTypes(atomTypeId, 1);
 #endif
+    }
 }
 
 void SimulationHandler::setAtomTypeColorG(atom_type_id atomTypeId, float g) {
     if (atomTypeId < mAtomTypeCount) {
         mAtomTypes[atomTypeId].g = g;
         mAtomTypesBuffer[atomTypeId] = AtomTypeRaw(mAtomTypes[atomTypeId]);
-    }
 #ifdef ITERATE_ON_COMPUTE_SHADER
-    BaseShader::writeBuffer(mAtomTypesBufferID, mAtomTypesBuffer.data(), sizeof(mAtomTypesBuffer));
+        uploadAtomTypes(atomTypeId, 1);
 #endif
+    }
 }
 
 void SimulationHandler::setAtomTypeColorB(atom_type_id atomTypeId, float b) {
     if (atomTypeId < mAtomTypeCount) {
         mAtomTypes[atomTypeId].b = b;
         mAtomTypesBuffer[atomTypeId] = AtomTypeRaw(mAtomTypes[atomTypeId]);
-    }
 #ifdef ITERATE_ON_COMPUTE_SHADER
-    BaseShader::writeBuffer(mAtomTypesBufferID, mAtomTypesBuffer.data(), sizeof(mAtomTypesBuffer));
+        uploadAtomTypes(atomTypeId, 1);
 #endif
+    }
 }
 
 glm::vec3 SimulationHandler::getAtomTypeColor(atom_type_id atomTypeId) const {
@@ -331,9 +869,6 @@ glm::vec3 SimulationHandler::getAtomTypeColor(atom_type_id atomTypeId) const {
 
 void SimulationHandler::setAtomTypeQuantity(atom_type_id atomTypeId, unsigned int quantity) {
     if (atomTypeId < mAtomTypeCount) mAtomTypes[atomTypeId].quantity = quantity;
-#ifdef ITERATE_ON_COMPUTE_SHADER
-    BaseShader::writeBuffer(mAtomTypesBufferID, mAtomTypesBuffer.data(), sizeof(mAtomTypesBuffer));
-#endif
 }
 
 unsigned int SimulationHandler::getAtomTypeQuantity(atom_type_id atomTypeId) const {
@@ -342,9 +877,6 @@ unsigned int SimulationHandler::getAtomTypeQuantity(atom_type_id atomTypeId) con
 
 void SimulationHandler::setAtomTypeFriendlyName(atom_type_id atomTypeId, const std::string& friendlyName) {
     if (atomTypeId < mAtomTypeCount) mAtomTypes[atomTypeId].friendlyName = friendlyName;
-#ifdef ITERATE_ON_COMPUTE_SHADER
-    BaseShader::writeBuffer(mAtomTypesBufferID, mAtomTypesBuffer.data(), sizeof(mAtomTypesBuffer));
-#endif
 }
 
 std::string SimulationHandler::getAtomTypeFriendlyName(atom_type_id atomTypeId) const {
@@ -358,19 +890,21 @@ float SimulationHandler::getInteraction(atom_type_id aId, atom_type_id bId) cons
 void SimulationHandler::setInteraction(atom_type_id aId, atom_type_id bId, float value) {
     mInteractionsBuffer[INTERACTION_INDEX(aId, bId)] = value;
 #ifdef ITERATE_ON_COMPUTE_SHADER
-    BaseShader::writeBuffer(mInteractionsBufferID, mInteractionsBuffer.data(), sizeof(mInteractionsBuffer));
+    uploadInteractions(INTERACTION_INDEX(aId, bId), 1);
+#else
+    mInteractionMatrix[aId * mInteractionStride + bId] = value;
+    mReactionMatrix[bId * mInteractionStride + aId] = value;
+    mTypeKernelFeaturesDirty = true;
 #endif
 }
 
 void SimulationHandler::shuffleAtomInteractions() {
-    std::random_device rd;
-    std::mt19937 mt(rd());
-    std::uniform_real_distribution<float> range(-1.0f, 1.0f);
-
     for (size_t i = 0; i < mInteractionCount; i++)
-        mInteractionsBuffer[i] = range(mt);
+        mInteractionsBuffer[i] = mRandom.nextFloat(MIN_INTERACTION, MAX_INTERACTION);
 #ifdef ITERATE_ON_COMPUTE_SHADER
-    BaseShader::writeBuffer(mInteractionsBufferID, mInteractionsBuffer.data(), sizeof(mInteractionsBuffer));
+    uploadInteractions(0, mInteractionCount);
+#else
+    buildInteractionMatrices();
 #endif
 }
 
@@ -378,7 +912,9 @@ void SimulationHandler::zeroAtomInteractions() {
     for (size_t i = 0; i < mInteractionCount; i++)
         mInteractionsBuffer[i] = 0.0f;
 #ifdef ITERATE_ON_COMPUTE_SHADER
-    BaseShader::writeBuffer(mInteractionsBufferID, mInteractionsBuffer.data(), sizeof(mInteractionsBuffer));
+    uploadInteractions(0, mInteractionCount);
+#else
+    buildInteractionMatrices();
 #endif
 }
 
@@ -397,19 +933,23 @@ size_t SimulationHandler::getAtomTypeCount() const {
     return mAtomTypeCount;
 }
 
-const std::array<Atom, MAX_ATOMS>& SimulationHandler::getAtoms() {
-    return mAtomsBuffer;
+AtomsView SimulationHandler::getAtoms() const {
+#ifndef ITERATE_ON_COMPUTE_SHADER
+    if (mAtomsReordered) {
+        if (!mOrderedAtomsValid) {
+            scatterAtoms(mAtoms, mOrderedAtoms, mAtomIds.data(), mAtomCount);
+            mOrderedAtomsValid = true;
+        }
+        return AtomsView(mOrderedAtoms, mAtomCount);
+    }
+#endif
+    return AtomsView(mAtoms, mAtomCount);
 }
 
 void SimulationHandler::initAtomPositionsRandom() {
-    std::random_device rd;
-    std::mt19937 mt(rd());
-    std::uniform_real_distribution<float> rangeX(0, mSimWidth);
-    std::uniform_real_distribution<float> rangeY(0, mSimHeight);
-
     for (size_t i = 0; i < mAtomCount; i++) {
-        mAtomsBuffer[i].x = rangeX(mt);
-        mAtomsBuffer[i].y = rangeY(mt);
+        mAtoms.x[i] = mRandom.nextFloat(0.0f, mSimWidth);
+        mAtoms.y[i] = mRandom.nextFloat(0.0f, mSimHeight);
     }
 }
 
@@ -425,17 +965,13 @@ void SimulationHandler::initAtomPositionsEquidistant() {
     for (size_t i = 0; i < rootCount; i++) {
         for (size_t j = 0; j < rootCount; j++) {
             if (((i == 0) && (j < d1 || j >= rootCount - d2)) || ((i == rootCount - 1) && (j < d3 || j >= rootCount - d4))) continue;
-            mAtomsBuffer[index].x = (j + 1) * mSimWidth / (rootCount + 1);
-            mAtomsBuffer[index++].y = (i + 1) * mSimHeight / (rootCount + 1);
+            mAtoms.x[index  ] = (j + 1) * mSimWidth / (rootCount + 1);
+            mAtoms.y[index++] = (i + 1) * mSimHeight / (rootCount + 1);
         }
     }
 }
 
 void SimulationHandler::initAtomPositionsRandomEquidistant() {
-    std::random_device rd;
-    std::mt19937 mt(rd());
-    std::uniform_int_distribution<int> range(0, mAtomCount - 1);
-
     size_t rootCount = std::ceil(std::sqrt(mAtomCount));
     size_t delta = rootCount * rootCount - mAtomCount;
     size_t halfD = delta / 2;
@@ -448,7 +984,7 @@ void SimulationHandler::initAtomPositionsRandomEquidistant() {
     for (size_t i = 0; i < mAtomCount; i++)
         randSequence[i] = i;
     for (size_t i = 0; i < mAtomCount; i++) {
-        size_t swap = range(mt);
+        size_t swap = mRandom.nextIndex(mAtomCount);
         size_t temp = randSequence[i];
         randSequence[i] = randSequence[swap];
         randSequence[swap] = temp;
@@ -457,8 +993,8 @@ void SimulationHandler::initAtomPositionsRandomEquidistant() {
     for (size_t i = 0; i < rootCount; i++) {
         for (size_t j = 0; j < rootCount; j++) {
             if (((i == 0) && (j < d1 || j >= rootCount - d2)) || ((i == rootCount - 1) && (j < d3 || j >= rootCount - d4))) continue;
-            mAtomsBuffer[randSequence[index  ]].x = (j + 1) * mSimWidth / (rootCount + 1);
-            mAtomsBuffer[randSequence[index++]].y = (i + 1) * mSimHeight / (rootCount + 1);
+            mAtoms.x[randSequence[index  ]] = (j + 1) * mSimWidth / (rootCount + 1);
+            mAtoms.y[randSequence[index++]] = (i + 1) * mSimHeight / (rootCount + 1);
         }
     }
 }
@@ -468,10 +1004,10 @@ void SimulationHandler::initAtomPositionsRings() {
     size_t index = 0;
     for (size_t at = 0; at < mAtomTypeCount; at++) {
         AtomType& atomType = mAtomTypes[at];
-        for (size_t i = 0; i < atomType.quantity; i++) {
+        for (size_t i = 0; i < atomType.quantity && index < mAtomCount; i++) {
             float theta = i * (2.0f * 3.141592653589f) / atomType.quantity;
-            mAtomsBuffer[index  ].x = std::cos(theta) * ringDist * (at + 1) + mSimWidth / 2;
-            mAtomsBuffer[index++].y = std::sin(theta) * ringDist * (at + 1) + mSimHeight / 2;
+            mAtoms.x[index  ] = std::cos(theta) * ringDist * (at + 1) + mSimWidth / 2;
+            mAtoms.y[index++] = std::sin(theta) * ringDist * (at + 1) + mSimHeight / 2;
         }
     }
 }
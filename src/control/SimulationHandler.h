@@ -6,23 +6,26 @@
  * @date   January 2023
  */
 #pragma once
-#include "GLUtilities.h"
+#include "../model/AtomArrays.h"
+#include "../model/Random.h"
 #include "../model/SimulationStructures.h"
+#include "../model/SpatialGrid.h"
 #ifdef ITERATE_ON_COMPUTE_SHADER
 #include "ComputeShader.h"
+#include "ReadbackBuffer.h"
+#include "StorageBuffer.h"
+#include "GLUtilities.h"
 
 #include "glad/glad.h"
+#else
+#include "ForceKernels.h"
+#include "MortonSort.h"
+#include "NeighbourList.h"
+#include "ThreadPool.h"
 #endif
 
 #include <array>
-
-#ifdef ITERATE_ON_COMPUTE_SHADER
-const size_t MAX_ATOMS = 10000;
-#else
-const size_t MAX_ATOMS = 3000;
-#endif
-const size_t MAX_ATOM_TYPES = 50;
-const size_t MAX_INTERACTIONS = MAX_ATOM_TYPES * MAX_ATOM_TYPES;
+#include <vector>
 
 const float MIN_SIM_WIDTH = 10.0f;
 const float MAX_SIM_WIDTH = 1000000.0f;
@@ -46,6 +49,29 @@ const float MIN_ATOM_DIAMETER = 1.0f;
 const float MIN_INTERACTION = -1.0f;
 const float MAX_INTERACTION = 1.0f;
 
+const size_t MAX_THREADS = 256;
+
+#ifndef ITERATE_ON_COMPUTE_SHADER
+const float MIN_NEIGHBOUR_SKIN = 0.0f;
+const float MAX_NEIGHBOUR_SKIN = 100.0f;
+const float DEFAULT_NEIGHBOUR_SKIN = 0.0f;
+/**
+ * Average number of atoms of each type per cell needed before the atoms of
+ * each cell are sorted into type runs (see SimulationHandler::setTypeRuns).
+ */
+const size_t MIN_TYPE_RUN_LENGTH = 32;
+/** Row stride of the CPU interaction matrices is padded to a multiple of this many floats (one cache line). */
+const size_t INTERACTION_ROW_ALIGNMENT = 16;
+
+const size_t MAX_REORDER_INTERVAL = 10000;
+const size_t DEFAULT_REORDER_INTERVAL = 0;
+#endif
+
+#ifdef ITERATE_ON_COMPUTE_SHADER
+/** Invocations per workgroup of the iteration compute shaders (must match WORKGROUP_SIZE in each). */
+const GLuint COMPUTE_WORKGROUP_SIZE = 128;
+#endif
+
 #define INTERACTION_INDEX(aId, bId) (aId == bId ? aId * aId : (aId < bId ? bId * bId + aId * 2 + 1 : aId * aId + bId * 2 + 2))
 
 /** Defines the initial positioning of the Atoms. */
@@ -91,9 +117,112 @@ public:
     void setAtomDiameter(float atomDiameter);
     [[nodiscard]] inline float getAtomDiameter() const { return mAtomDiameter; }
 
+#ifndef ITERATE_ON_COMPUTE_SHADER
+    /**
+     * Set the number of threads used to iterate the simulation (including the
+     * calling thread).
+     */
+    void setThreadCount(size_t threadCount);
+    [[nodiscard]] size_t getThreadCount() const;
+
+    /**
+     * Set the instruction set used by the force kernel. Falls back to the
+     * scalar kernel if the instruction set is not supported by this CPU.
+     */
+    void setInstructionSet(InstructionSet instructionSet);
+    [[nodiscard]] inline InstructionSet getInstructionSet() const { return mInstructionSet; }
+
+    /**
+     * Set whether each pair of atoms is only visited once, applying the forces
+     * in both directions (see PairForceKernel), rather than once per atom.
+     */
+    void setPairSymmetry(bool pairSymmetry);
+    [[nodiscard]] inline bool getPairSymmetry() const { return mPairSymmetry; }
+
+    /**
+     * Set whether the atoms of each cell are sorted by type, so the force
+     * kernels can visit each run of one type with its interaction value held
+     * constant rather than looked up for every pair. Only used while there
+     * are at least MIN_TYPE_RUN_LENGTH atoms of each type per cell on
+     * average, and not with neighbour lists.
+     */
+    void setTypeRuns(bool typeRuns);
+    [[nodiscard]] inline bool getTypeRuns() const { return mTypeRuns; }
+    /** @returns true if the last iteration visited the atoms in type runs. */
+    [[nodiscard]] inline bool isUsingTypeRuns() const { return mBinnedTypeRuns; }
+
+    /**
+     * Set the margin beyond the interaction range of the neighbour lists (see
+     * NeighbourList), which are rebuilt once any atom has moved half of it.
+     * A skin of 0 disables the lists, searching the grid every iteration
+     * instead.
+     */
+    void setNeighbourSkin(float skin);
+    [[nodiscard]] inline float getNeighbourSkin() const { return mNeighbourSkin; }
+    /** @returns Number of times the neighbour lists have been built. */
+    [[nodiscard]] inline size_t getNeighbourListBuildCount() const { return mNeighbourList.getBuildCount(); }
+
+    /**
+     * Set how many iterations pass between sorting the stored atoms along a
+     * Morton curve (see MortonSort), so atoms close together in space are
+     * close together in memory and binning gathers them from fewer cache
+     * lines. 0 never sorts them. The sort only changes the order in which
+     * forces are summed, and SimulationHandler::getAtoms still lists the
+     * atoms in their original order.
+     */
+    void setReorderInterval(size_t interval);
+    [[nodiscard]] inline size_t getReorderInterval() const { return mReorderInterval; }
+#endif
+
+    /**
+     * Restart the random sequence used to generate atom type colours, atom
+     * positions and shuffled interactions from seed, so the same seed and
+     * configuration always generate the same simulation. Stored in config
+     * files (see saveToFile).
+     */
+    void setSeed(uint64_t seed);
+    [[nodiscard]] inline uint64_t getSeed() const { return mRandom.getSeed(); }
+
+    /**
+     * Replace the configuration (parameters, start condition, atom types and
+     * interactions) with a copy of the configuration of source, reusing the
+     * existing allocations. Atoms and the seed are left as they are.
+     */
+    void copyConfiguration(const SimulationHandler& source);
+
     void clearAtoms();
     void initSimulation();
+    /**
+     * Replace the generated atoms with count atoms copied from the given
+     * arrays (e.g. when restoring a checkpoint, see loadCheckpoint). Every
+     * atomType must be a valid AtomType id.
+     */
+    void setAtoms(size_t count, const float* x, const float* y, const float* vx, const float* vy, const atom_type_id* atomType);
     void iterateSimulation();
+#ifdef ITERATE_ON_COMPUTE_SHADER
+    /**
+     * Bring SimulationHandler::getAtoms up to date with the GPU buffer, which
+     * holds the authoritative atoms. Does nothing if the simulation has not
+     * iterated since the atoms were last uploaded or downloaded, otherwise
+     * waits for a copy of the current atoms (see SimulationHandler::requestAtoms).
+     */
+    void downloadAtoms();
+    /**
+     * Start copying the current atoms back from the GPU without waiting, so
+     * the simulation can carry on iterating until they are received (see
+     * SimulationHandler::receiveAtoms). Replaces any copy not yet received.
+     */
+    void requestAtoms();
+    /**
+     * Copy the atoms from the last SimulationHandler::requestAtoms into
+     * SimulationHandler::getAtoms, if the copy has completed.
+     * @param wait Wait for the copy to complete.
+     * @returns false if the copy has not completed (and wait is false), no
+     * copy was requested, or the number of atoms has changed since, otherwise
+     * true.
+     */
+    bool receiveAtoms(bool wait);
+#endif
 
     atom_type_id newAtomType();
     void removeAtomType(atom_type_id atomTypeId);
@@ -120,7 +249,15 @@ public:
     [[nodiscard]] size_t getActualAtomCount() const;
     [[nodiscard]] size_t getAtomTypeCount() const;
 
-    const std::array<Atom, MAX_ATOMS>& getAtoms();
+    /**
+     * @returns View over the generated atoms. In the GPU build this is only
+     * up to date as of the last time atoms were read back from the GPU. In the
+     * CPU build, atoms stay in the order they were generated or set in, even
+     * once the stored atoms have been reordered (see
+     * SimulationHandler::setReorderInterval), which costs a copy the first
+     * time the atoms are viewed after each iteration.
+     */
+    [[nodiscard]] AtomsView getAtoms() const;
 
     StartCondition startCondition;
 private:
@@ -129,6 +266,90 @@ private:
     void initAtomPositionsRandomEquidistant();
     void initAtomPositionsRings();
 
+#ifndef ITERATE_ON_COMPUTE_SHADER
+    /**
+     * Accumulate the forces acting on the atoms in the range [begin, end). Each
+     * atom only writes to its own force, so ranges can run concurrently.
+     * Cells are visited a type run at a time if mBinnedTypeRuns is set.
+     */
+    void accumulateForces(size_t begin, size_t end);
+    /**
+     * Accumulate the forces between each atom in the binned slots [begin, end)
+     * and every atom in a later slot of the same cell or in a neighbouring cell
+     * with a higher index, so each pair is visited once. Forces are written to
+     * the buffers of partition, as any atom may be pushed by any range.
+     */
+    void accumulatePairForces(size_t begin, size_t end, size_t partition);
+    /**
+     * As SimulationHandler::accumulateForces, but only against the atoms in
+     * the neighbour list of each binned slot in [begin, end), packed into the
+     * buffer of thread for the force kernel.
+     */
+    void accumulateListForces(size_t begin, size_t end, size_t thread);
+    /**
+     * As SimulationHandler::accumulatePairForces, but only against the atoms
+     * in the (half) neighbour list of each binned slot in [begin, end).
+     */
+    void accumulatePairListForces(size_t begin, size_t end, size_t partition);
+    /**
+     * Sum the per-partition forces of the binned slots [begin, end) into the
+     * atoms in partition order, clearing the buffers for the next iteration.
+     */
+    void reduceForces(size_t begin, size_t end);
+    /**
+     * Apply the accumulated forces to the atoms in the range [begin, end).
+     */
+    void integrateAtoms(size_t begin, size_t end);
+    /**
+     * Fill mForceKernels with every specialisation of the kernels of
+     * mInstructionSet.
+     */
+    void selectForceKernels();
+    /**
+     * Fill mTypeKernelFeatures and mInertTypes for the current interactions,
+     * collision force and pair mode.
+     */
+    void selectTypeKernelFeatures();
+    /**
+     * Rebuild mInteractionMatrix and mReactionMatrix from mInteractionsBuffer,
+     * after the number of atom types or many of the interactions change.
+     */
+    void buildInteractionMatrices();
+    /**
+     * Sort the stored atoms along a Morton curve, keeping track of the
+     * original index of each in mAtomIds.
+     */
+    void reorderAtoms();
+    /**
+     * Put the stored atoms back in their original order, e.g. before atoms
+     * are removed.
+     */
+    void restoreAtomOrder();
+#endif
+#ifdef ITERATE_ON_COMPUTE_SHADER
+    /**
+     * Bin the atoms on the GPU by counting sort, matching SpatialGrid::build:
+     * count the atoms in each cell, scan the counts into the first slot of
+     * each cell, then scatter the atoms into binned order.
+     * @param cellsX Number of cells along the x axis (see SpatialGrid::getGridSize).
+     * @param cellsY Number of cells along the y axis.
+     */
+    void binAtoms(GLuint cellsX, GLuint cellsY);
+    /**
+     * Copy the atoms to the GPU buffer, packed as Atom structures.
+     */
+    void uploadAtoms();
+    /**
+     * Copy count atom types, starting from first, to the GPU buffer.
+     */
+    void uploadAtomTypes(size_t first, size_t count);
+    /**
+     * Copy count interactions, starting from index first (see
+     * INTERACTION_INDEX), to the GPU buffer.
+     */
+    void uploadInteractions(size_t first, size_t count);
+#endif
+
     float mSimWidth;
     float mSimHeight;
 
@@ -143,18 +364,116 @@ private:
     size_t mAtomCount;
     size_t mInteractionCount;
 
-    std::array<AtomType, MAX_ATOM_TYPES> mAtomTypes;
-    std::array<AtomTypeRaw, MAX_ATOM_TYPES> mAtomTypesBuffer;
-    std::array<Atom, MAX_ATOMS> mAtomsBuffer;
-    std::array<float, MAX_INTERACTIONS> mInteractionsBuffer;
+    std::vector<AtomType> mAtomTypes;
+    std::vector<AtomTypeRaw> mAtomTypesBuffer;
+    AtomArrays mAtoms;
+    std::vector<float> mInteractionsBuffer;
+
+    Random mRandom;
+
+#ifndef ITERATE_ON_COMPUTE_SHADER
+    /** Bins atoms by position so iterations only compare neighbouring atoms. */
+    SpatialGrid mGrid;
+    ThreadPool mThreadPool;
+
+    /** Positions and types of the atoms copied into binned order (see SpatialGrid::getBinnedAtom). */
+    AlignedVector<float> mBinnedX;
+    AlignedVector<float> mBinnedY;
+    AlignedVector<atom_type_id> mBinnedTypes;
+    /**
+     * Interactions as a dense row-major matrix, indexed [aId * mInteractionStride + bId].
+     * Kept up to date with mInteractionsBuffer (see SimulationHandler::buildInteractionMatrices).
+     */
+    AlignedVector<float> mInteractionMatrix;
+    /** Transpose of mInteractionMatrix, so row aId holds the interactions of every type from aId. */
+    AlignedVector<float> mReactionMatrix;
+    /** Row stride of the interaction matrices, padded so every row starts on its own cache line. */
+    size_t mInteractionStride;
+    /** Per-thread forces of each binned slot, used when mPairSymmetry is set. Zeroed between iterations. */
+    std::vector<AlignedVector<float>> mThreadForcesX;
+    std::vector<AlignedVector<float>> mThreadForcesY;
+
+    InstructionSet mInstructionSet;
+    /** Kernels of mInstructionSet, indexed by the KernelFeature flags they are compiled with. */
+    std::array<ForceKernelSet, KERNEL_FEATURE_COMBINATIONS> mForceKernels;
+    /**
+     * KernelFeature flags needed by the atoms of each type (wrapping is
+     * dropped again for cells away from the edges).
+     */
+    std::vector<unsigned int> mTypeKernelFeatures;
+    /**
+     * Types whose atoms would add no force from their own kernel calls (no
+     * interactions, or reactions in pair mode, and no collisions), so they
+     * are skipped.
+     */
+    std::vector<bool> mInertTypes;
+    /** Whether mTypeKernelFeatures and mInertTypes need selecting again before the next iteration. */
+    bool mTypeKernelFeaturesDirty;
+    bool mPairSymmetry;
+    bool mTypeRuns;
+    /** Whether mGrid was last built with type runs. */
+    bool mBinnedTypeRuns;
+
+    /** Neighbours of each binned slot, used in place of the grid if mNeighbourSkin is above 0. */
+    NeighbourList mNeighbourList;
+    float mNeighbourSkin;
+    /** Listed neighbours of one atom, packed contiguously for the force kernels. */
+    struct NeighbourBuffer {
+        AlignedVector<float> x;
+        AlignedVector<float> y;
+        AlignedVector<atom_type_id> types;
+        /** Forces on the neighbours, scattered back after each atom (pair symmetric only). */
+        AlignedVector<float> fx;
+        AlignedVector<float> fy;
+    };
+    std::vector<NeighbourBuffer> mThreadNeighbours;
+
+    MortonSort mMortonSort;
+    size_t mReorderInterval;
+    size_t mIterationsSinceReorder;
+    /** Whether mAtoms has been reordered, in which case mAtomIds holds the original index of each atom. */
+    bool mAtomsReordered;
+    AlignedVector<unsigned int> mAtomIds;
+    AlignedVector<unsigned int> mAtomIdsScratch;
+    /** Reordered copy of mAtoms, swapped in once complete. */
+    AtomArrays mAtomsScratch;
+    /** Reordered atoms copied back into their original order for SimulationHandler::getAtoms. */
+    mutable AtomArrays mOrderedAtoms;
+    mutable bool mOrderedAtomsValid;
+#else
+    /** Atoms packed as Atom structures for transferring to the GPU. */
+    std::vector<Atom> mAtomsStaging;
+    /** Copy of mAtomsStorage being read back (see SimulationHandler::requestAtoms). */
+    ReadbackBuffer mAtomsReadback;
+    /** Incremented whenever the atoms on the GPU change. */
+    uint64_t mAtomsVersion;
+    /** Value of mAtomsVersion the atoms in mAtoms were last copied from or to the GPU at. */
+    uint64_t mHostAtomsVersion;
+    /** Value of mAtomsVersion and mAtomCount when mAtomsReadback was requested. */
+    uint64_t mReadbackAtomsVersion;
+    size_t mReadbackAtomCount;
+#endif
 
 #ifdef ITERATE_ON_COMPUTE_SHADER
+    ComputeShader mBinCountPass;
+    ComputeShader mBinScanPass;
+    ComputeShader mBinScanBlocksPass;
+    ComputeShader mBinScanAddPass;
+    ComputeShader mBinScatterPass;
     ComputeShader mIterationComputePass1;
     ComputeShader mIterationComputePass2;
 
-    GLuint mAtomTypesBufferID;
-    GLuint mAtomsBufferID;
-    GLuint mInteractionsBufferID;
+    StorageBuffer mAtomTypesStorage;
+    StorageBuffer mAtomsStorage;
+    StorageBuffer mInteractionsStorage;
+    /** First binned slot of each cell (plus one past the end), see SpatialGrid::getCellStart. */
+    StorageBuffer mCellStartStorage;
+    /** Cell of each atom and its position within that cell. */
+    StorageBuffer mAtomBinsStorage;
+    /** Positions, types and ids of the atoms in binned order. */
+    StorageBuffer mBinnedAtomsStorage;
+    /** Scanned totals of each block of cells, used while scanning mCellStartStorage. */
+    StorageBuffer mScanBlocksStorage;
 
     const std::string SIMULATION_BOUNDS_UNIFORM = "simulationBounds";
     const std::string INTERACTION_RANGE2_UNIFORM = "interactionRange2";
@@ -162,5 +481,10 @@ private:
     const std::string COLLISION_FORCE_UNIFORM = "collisionForce";
     const std::string DRAG_FORCE_UNIFORM = "dragForce";
     const std::string DT_UNIFORM = "dt";
+    const std::string ATOM_COUNT_UNIFORM = "atomCount";
+    const std::string CELLS_X_UNIFORM = "cellsX";
+    const std::string CELLS_Y_UNIFORM = "cellsY";
+    const std::string SCAN_COUNT_UNIFORM = "scanCount";
+    const std::string BLOCK_COUNT_UNIFORM = "blockCount";
 #endif
 };
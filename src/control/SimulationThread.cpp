@@ -0,0 +1,118 @@
+#include "SimulationThread.h"
+
+#include "../view/Logger.h"
+
+#include <algorithm>
+
+SimulationThread::SimulationThread(SimulationHandler& handler, std::function<void()> iterate) :
+mHandler(handler), mIterate(std::move(iterate)), mThread(), mMutex(), mWake(), mLockWaiters(0),
+mRunning(false), mStopping(false), mStepsPerFrame(1), mPendingSteps(0), mSnapshotStale(false),
+mSnapshots(), mBackSnapshot(0), mFrontSnapshot(1), mReadySnapshot(2) {
+    if (!mIterate)
+        mIterate = [this]() { mHandler.iterateSimulation(); };
+}
+
+SimulationThread::~SimulationThread() {
+    stop();
+}
+
+void SimulationThread::start() {
+    if (mThread.joinable())
+        return;
+    LOG_MESSAGE("Starting Simulation Thread");
+    mStopping = false;
+    mThread = std::thread(&SimulationThread::run, this);
+}
+
+void SimulationThread::stop() {
+    if (!mThread.joinable())
+        return;
+    LOG_MESSAGE("Stopping Simulation Thread");
+    {
+        std::unique_lock<std::mutex> lock = lockHandler();
+        mStopping = true;
+    }
+    mWake.notify_one();
+    mThread.join();
+}
+
+std::unique_lock<std::mutex> SimulationThread::lockHandler() {
+    mLockWaiters++;
+    std::unique_lock<std::mutex> lock(mMutex);
+    mLockWaiters--;
+    return lock;
+}
+
+void SimulationThread::setRunning(bool running) {
+    mRunning = running;
+    if (!running && mSnapshotStale)
+        publishSnapshot();
+    mWake.notify_one();
+}
+
+void SimulationThread::setStepsPerFrame(unsigned int stepsPerFrame) {
+    mStepsPerFrame = stepsPerFrame;
+    mWake.notify_one();
+}
+
+void SimulationThread::requestFrame() {
+    mPendingSteps = mStepsPerFrame;
+    mWake.notify_one();
+}
+
+void SimulationThread::publishSnapshot() {
+    SimulationSnapshot& snapshot = mSnapshots[mBackSnapshot];
+    snapshot.width = mHandler.getWidth();
+    snapshot.height = mHandler.getHeight();
+    snapshot.atomDiameter = mHandler.getAtomDiameter();
+
+    snapshot.atomTypeColors.resize(mHandler.getAtomTypeCount());
+    for (atom_type_id id : mHandler.getAtomTypeIds())
+        snapshot.atomTypeColors[id] = mHandler.getAtomTypeColor(id);
+
+    AtomsView atoms = mHandler.getAtoms();
+    const AtomArrays& arrays = atoms.getArrays();
+    snapshot.x.assign(arrays.x.begin(), arrays.x.begin() + atoms.size());
+    snapshot.y.assign(arrays.y.begin(), arrays.y.begin() + atoms.size());
+    snapshot.atomType.assign(arrays.atomType.begin(), arrays.atomType.begin() + atoms.size());
+
+    mBackSnapshot = mReadySnapshot.exchange(mBackSnapshot | SNAPSHOT_FRESH, std::memory_order_acq_rel) & ~SNAPSHOT_FRESH;
+    mSnapshotStale = false;
+}
+
+const SimulationSnapshot& SimulationThread::acquireSnapshot() {
+    if (mReadySnapshot.load(std::memory_order_relaxed) & SNAPSHOT_FRESH)
+        mFrontSnapshot = mReadySnapshot.exchange(mFrontSnapshot, std::memory_order_acq_rel) & ~SNAPSHOT_FRESH;
+    return mSnapshots[mFrontSnapshot];
+}
+
+void SimulationThread::run() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true) {
+        mWake.wait(lock, [this]() { return mStopping || !isIdle(); });
+        if (mStopping)
+            return;
+
+        mIterate();
+        mSnapshotStale = true;
+        if (mPendingSteps > 0)
+            mPendingSteps--;
+        // Only copy the atoms once the reader has taken the last copy, unless
+        // this is the last iteration for a while
+        if (!(mReadySnapshot.load(std::memory_order_relaxed) & SNAPSHOT_FRESH) || isIdle())
+            publishSnapshot();
+
+        // Let any thread waiting for the handler in first, so an unbounded
+        // simulation cannot starve the UI
+        if (mLockWaiters.load() > 0) {
+            lock.unlock();
+            while (mLockWaiters.load() > 0)
+                std::this_thread::yield();
+            lock.lock();
+        }
+    }
+}
+
+bool SimulationThread::isIdle() const {
+    return !mRunning || (mStepsPerFrame > 0 && mPendingSteps == 0);
+}
@@ -0,0 +1,130 @@
+/**
+ * @file   SimulationThread.h
+ * @brief  Dedicated thread for iterating a simulation independently of the UI.
+ *
+ * @author Stuart Lewis
+ * @date   January 2023
+ */
+#pragma once
+#include "SimulationHandler.h"
+#include "../model/SimulationSnapshot.h"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/**
+ * Iterates a SimulationHandler on its own thread, so the simulation is not
+ * tied to the frame rate and a slow simulation does not stall the UI.
+ *
+ * The handler must only be accessed from other threads while holding the
+ * lock returned by SimulationThread::lockHandler. Once the previous snapshot
+ * has been acquired, or before the thread goes idle, the atoms are copied into
+ * a triple-buffered SimulationSnapshot, which can be drawn without holding the
+ * lock (see SimulationThread::acquireSnapshot). Iterations the reader would
+ * never see are not copied.
+ *
+ * The handler must not iterate on the GPU (see ITERATE_ON_COMPUTE_SHADER), as
+ * the OpenGL context belongs to the UI thread.
+ */
+class SimulationThread {
+public:
+    /**
+     * @param handler Simulation to iterate.
+     * @param iterate Function performing a single iteration. Defaults to
+     * SimulationHandler::iterateSimulation.
+     */
+    explicit SimulationThread(SimulationHandler& handler, std::function<void()> iterate = {});
+    ~SimulationThread();
+
+    SimulationThread(const SimulationThread&) = delete;
+    SimulationThread& operator=(const SimulationThread&) = delete;
+
+    void start();
+    /**
+     * Stop the thread, blocking until the current iteration is complete.
+     */
+    void stop();
+
+    /**
+     * Lock the handler. Takes priority over the simulation thread, which waits
+     * between iterations for any thread trying to lock it.
+     */
+    [[nodiscard]] std::unique_lock<std::mutex> lockHandler();
+
+    /**
+     * Set whether the simulation should be iterating. Publishes any
+     * iterations not yet in a snapshot when stopping. Requires the handler to
+     * be locked.
+     */
+    void setRunning(bool running);
+    [[nodiscard]] inline bool isRunning() const { return mRunning; }
+
+    /**
+     * Set the number of iterations to run per frame (see
+     * SimulationThread::requestFrame), or 0 to iterate as fast as possible.
+     * Requires the handler to be locked.
+     */
+    void setStepsPerFrame(unsigned int stepsPerFrame);
+    [[nodiscard]] inline unsigned int getStepsPerFrame() const { return mStepsPerFrame; }
+
+    /**
+     * Allow the next frame's iterations to run. Iterations a slow simulation
+     * did not get to in the previous frame are dropped, rather than building up
+     * a backlog. Requires the handler to be locked.
+     */
+    void requestFrame();
+
+    /**
+     * Copy the current state of the handler into the next snapshot. Called
+     * after iterating once the previous snapshot has been acquired, and should
+     * be called after modifying the handler while not running. Requires the
+     * handler to be locked.
+     */
+    void publishSnapshot();
+    /**
+     * @returns The most recently published snapshot. Remains valid until the
+     * next call, and must only be called from a single thread.
+     */
+    const SimulationSnapshot& acquireSnapshot();
+private:
+    void run();
+    /**
+     * @returns true if the simulation thread would wait rather than iterate.
+     * Requires the handler to be locked.
+     */
+    [[nodiscard]] bool isIdle() const;
+
+    SimulationHandler& mHandler;
+    std::function<void()> mIterate;
+
+    std::thread mThread;
+    /** Guards mHandler and the state below. */
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    /** Number of threads waiting in SimulationThread::lockHandler. */
+    std::atomic<size_t> mLockWaiters;
+
+    bool mRunning;
+    bool mStopping;
+    unsigned int mStepsPerFrame;
+    unsigned int mPendingSteps;
+    /** Whether the handler has iterated since the last snapshot was published. */
+    bool mSnapshotStale;
+
+    /**
+     * Triple buffer of snapshots. The writer fills mSnapshots[mBackSnapshot]
+     * and swaps it with mReadySnapshot; the reader swaps mReadySnapshot with
+     * mFrontSnapshot whenever the ready snapshot is newer.
+     */
+    std::array<SimulationSnapshot, 3> mSnapshots;
+    size_t mBackSnapshot;
+    size_t mFrontSnapshot;
+    /** Index of the ready snapshot, with SNAPSHOT_FRESH set if not yet acquired. */
+    std::atomic<size_t> mReadySnapshot;
+
+    static const size_t SNAPSHOT_FRESH = 4;
+};
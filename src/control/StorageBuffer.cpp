@@ -0,0 +1,69 @@
+#include "StorageBuffer.h"
+
+#include "GLUtilities.h"
+#include "../model/AtomArrays.h"
+
+#include <algorithm>
+
+static const GLbitfield STORAGE_FLAGS = GL_DYNAMIC_STORAGE_BIT;
+
+StorageBuffer::StorageBuffer(GLuint binding) :
+mBinding(binding), mBufferID(0), mCapacity(0) {
+}
+
+StorageBuffer::~StorageBuffer() {
+    if (mBufferID != 0)
+        glDeleteBuffers(1, &mBufferID);
+}
+
+void StorageBuffer::reserve(GLsizeiptr size) {
+    if (mBufferID != 0 && size <= mCapacity)
+        return;
+    GLsizeiptr capacity = (GLsizeiptr) growCapacity((size_t) mCapacity, (size_t) std::max(size, MIN_STORAGE_BUFFER_SIZE), (size_t) MIN_STORAGE_BUFFER_SIZE);
+
+    GLuint bufferID;
+    glGenBuffers(1, &bufferID);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, bufferID);
+    glBufferStorage(GL_SHADER_STORAGE_BUFFER, capacity, nullptr, STORAGE_FLAGS);
+    if (mBufferID != 0) {
+        glBindBuffer(GL_COPY_READ_BUFFER, mBufferID);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_SHADER_STORAGE_BUFFER, 0, 0, mCapacity);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    }
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, mBinding, bufferID);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    // Delete the old buffer last, as some drivers also reset the generic binding
+    // when deleting a buffer bound to an indexed binding point
+    if (mBufferID != 0)
+        glDeleteBuffers(1, &mBufferID);
+#ifdef _DEBUG
+    glCheckError();
+#endif
+
+    mBufferID = bufferID;
+    mCapacity = capacity;
+}
+
+void StorageBuffer::write(const GLvoid* data, GLsizeiptr offset, GLsizeiptr size) {
+    reserve(offset + size);
+    if (size == 0)
+        return;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, mBufferID);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, offset, size, data);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+#ifdef _DEBUG
+    glCheckError();
+#endif
+}
+
+void StorageBuffer::clear(GLsizeiptr offset, GLsizeiptr size) {
+    reserve(offset + size);
+    if (size == 0)
+        return;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, mBufferID);
+    glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, offset, size, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+#ifdef _DEBUG
+    glCheckError();
+#endif
+}
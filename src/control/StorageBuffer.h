@@ -0,0 +1,56 @@
+/**
+ * @file   StorageBuffer.h
+ * @brief  Shader storage buffer with immutable storage.
+ * 
+ * @author Stuart Lewis
+ * @date   January 2023
+ */
+#pragma once
+#include "glad/glad.h"
+
+/** Smallest storage allocated for a StorageBuffer (in bytes). */
+const GLsizeiptr MIN_STORAGE_BUFFER_SIZE = 256;
+
+/**
+ * Shader storage buffer backed by immutable storage (see glBufferStorage).
+ * Updates only upload the range that changed (see glBufferSubData). The
+ * buffer is never mapped, so the driver is free to keep it in GPU memory;
+ * contents are read back through a ReadbackBuffer.
+ *
+ * Storage is only re-created when it needs to grow, in which case the
+ * contents are kept and the new buffer is bound to the same binding point.
+ */
+class StorageBuffer {
+public:
+	/**
+	 * @param binding Shader storage binding point to bind the buffer to.
+	 */
+	explicit StorageBuffer(GLuint binding);
+	~StorageBuffer();
+
+	StorageBuffer(const StorageBuffer&) = delete;
+	StorageBuffer& operator=(const StorageBuffer&) = delete;
+
+	/**
+	 * Ensure the buffer can hold at least size bytes, growing geometrically.
+	 * Requires a current OpenGL context.
+	 */
+	void reserve(GLsizeiptr size);
+
+	/**
+	 * Upload size bytes of data to offset, growing the buffer if needed.
+	 */
+	void write(const GLvoid* data, GLsizeiptr offset, GLsizeiptr size);
+	/**
+	 * Zero size bytes from offset (both multiples of 4), growing the buffer if
+	 * needed.
+	 */
+	void clear(GLsizeiptr offset, GLsizeiptr size);
+
+	[[nodiscard]] inline GLuint getID() const { return mBufferID; }
+	[[nodiscard]] inline GLsizeiptr getCapacity() const { return mCapacity; }
+private:
+	GLuint mBinding;
+	GLuint mBufferID;
+	GLsizeiptr mCapacity;
+};
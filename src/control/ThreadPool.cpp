@@ -0,0 +1,114 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t threadCount) :
+mWorkers(), mTask(nullptr), mCount(0), mChunkSize(1), mIndexByChunk(false), mNextChunk(0),
+mGeneration(0), mActiveWorkers(0), mStopping(false) {
+    setThreadCount(threadCount);
+}
+
+ThreadPool::~ThreadPool() {
+    stopWorkers();
+}
+
+void ThreadPool::setThreadCount(size_t threadCount) {
+    threadCount = std::max(threadCount, (size_t) 1);
+    if (threadCount == getThreadCount())
+        return;
+
+    stopWorkers();
+    mStopping = false;
+    for (size_t i = 1; i < threadCount; i++)
+        mWorkers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t, size_t)>& task, size_t minChunkSize) {
+    if (mWorkers.empty()) {
+        if (count > 0)
+            task(0, count);
+        return;
+    }
+    parallelForIndexed(count, [&task](size_t begin, size_t end, size_t) { task(begin, end); }, minChunkSize);
+}
+
+void ThreadPool::parallelForIndexed(size_t count, const std::function<void(size_t, size_t, size_t)>& task, size_t minChunkSize) {
+    if (count == 0)
+        return;
+    if (mWorkers.empty()) {
+        task(0, count, 0);
+        return;
+    }
+    // Several chunks per thread so threads finishing early can pick up the slack
+    runJob(count, task, std::max(count / (getThreadCount() * 8), std::max(minChunkSize, (size_t) 1)), false);
+}
+
+void ThreadPool::parallelForPartitioned(size_t count, const std::function<void(size_t, size_t, size_t)>& task) {
+    if (count == 0)
+        return;
+    if (mWorkers.empty()) {
+        task(0, count, 0);
+        return;
+    }
+    runJob(count, task, (count + getThreadCount() - 1) / getThreadCount(), true);
+}
+
+void ThreadPool::runJob(size_t count, const std::function<void(size_t, size_t, size_t)>& task, size_t chunkSize, bool indexByChunk) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTask = &task;
+        mCount = count;
+        mChunkSize = chunkSize;
+        mIndexByChunk = indexByChunk;
+        mNextChunk.store(0, std::memory_order_relaxed);
+        mActiveWorkers = mWorkers.size();
+        mGeneration++;
+    }
+    mJobReady.notify_all();
+
+    runChunks(0);
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    mJobDone.wait(lock, [this]() { return mActiveWorkers == 0; });
+    mTask = nullptr;
+}
+
+void ThreadPool::workerLoop(size_t thread) {
+    size_t generation = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mJobReady.wait(lock, [this, generation]() { return mStopping || mGeneration != generation; });
+            if (mStopping)
+                return;
+            generation = mGeneration;
+        }
+
+        runChunks(thread);
+
+        bool last;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            last = --mActiveWorkers == 0;
+        }
+        if (last)
+            mJobDone.notify_one();
+    }
+}
+
+void ThreadPool::runChunks(size_t thread) {
+    size_t begin;
+    while ((begin = mNextChunk.fetch_add(mChunkSize, std::memory_order_relaxed)) < mCount)
+        (*mTask)(begin, std::min(begin + mChunkSize, mCount), mIndexByChunk ? begin / mChunkSize : thread);
+}
+
+void ThreadPool::stopWorkers() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mJobReady.notify_all();
+    for (std::thread& worker : mWorkers)
+        worker.join();
+    mWorkers.clear();
+}
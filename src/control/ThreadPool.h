@@ -0,0 +1,98 @@
+/**
+ * @file   ThreadPool.h
+ * @brief  Persistent pool of worker threads for splitting loops across cores.
+ *
+ * @author Stuart Lewis
+ * @date   January 2023
+ */
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Persistent pool of worker threads. Workers are created once (see
+ * ThreadPool::setThreadCount) and sleep between jobs, so splitting a loop
+ * across threads every iteration does not pay for thread creation.
+ */
+class ThreadPool {
+public:
+    /**
+     * @param threadCount Total number of threads to split work across,
+     * including the calling thread (see ThreadPool::setThreadCount).
+     */
+    explicit ThreadPool(size_t threadCount = 1);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * Set the number of threads to split work across. The calling thread always
+     * takes part, so a count of 1 runs everything inline without any workers.
+     * Must not be called while a job is running.
+     */
+    void setThreadCount(size_t threadCount);
+    [[nodiscard]] inline size_t getThreadCount() const { return mWorkers.size() + 1; }
+
+    /**
+     * Split the range [0, count) into contiguous chunks and run task(begin, end)
+     * for each chunk across all threads. Blocks until every chunk is complete.
+     * Chunks are handed out dynamically so uneven workloads stay balanced.
+     * @param count Size of the range to split.
+     * @param task Function to run on each chunk.
+     * @param minChunkSize Smallest chunk to hand out, so cheap items are not
+     * claimed one at a time (use 1 when each item is a large task).
+     */
+    void parallelFor(size_t count, const std::function<void(size_t, size_t)>& task, size_t minChunkSize = 64);
+    /**
+     * As ThreadPool::parallelFor, but task(begin, end, thread) is also given the
+     * index of the thread running the chunk, in [0, getThreadCount()), so tasks
+     * can write to per-thread buffers. The calling thread is always index 0.
+     */
+    void parallelForIndexed(size_t count, const std::function<void(size_t, size_t, size_t)>& task, size_t minChunkSize = 64);
+    /**
+     * As ThreadPool::parallelForIndexed, but the range is split into one
+     * contiguous partition per thread, and task(begin, end, partition) is
+     * given the index of the partition rather than of the thread running it.
+     * Which items share a per-partition buffer, and the order they are added
+     * to it in, then does not depend on scheduling, so floating point sums are
+     * reproducible for a given thread count.
+     */
+    void parallelForPartitioned(size_t count, const std::function<void(size_t, size_t, size_t)>& task);
+private:
+    /**
+     * Run task on chunks of chunkSize items across all threads, passing
+     * either the index of the chunk or of the thread running it.
+     */
+    void runJob(size_t count, const std::function<void(size_t, size_t, size_t)>& task, size_t chunkSize, bool indexByChunk);
+    void workerLoop(size_t thread);
+    /**
+     * Claim and run chunks of the current job until none are left.
+     */
+    void runChunks(size_t thread);
+    void stopWorkers();
+
+    std::vector<std::thread> mWorkers;
+
+    std::mutex mMutex;
+    std::condition_variable mJobReady;
+    std::condition_variable mJobDone;
+
+    const std::function<void(size_t, size_t, size_t)>* mTask;
+    size_t mCount;
+    size_t mChunkSize;
+    /** Whether the current task is given the index of each chunk rather than of its thread. */
+    bool mIndexByChunk;
+    std::atomic<size_t> mNextChunk;
+
+    /** Incremented for every job so sleeping workers can tell a new one has started. */
+    size_t mGeneration;
+    /** Number of workers still running the current job. */
+    size_t mActiveWorkers;
+    bool mStopping;
+};
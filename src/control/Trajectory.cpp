@@ -0,0 +1,560 @@
+#include "Trajectory.h"
+
+#include "../view/Logger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static const size_t TRAJECTORY_HEADER_SIZE = 64;
+static const size_t TRAJECTORY_CHUNK_HEADER_SIZE = 24;
+static const size_t TRAJECTORY_FRAME_HEADER_SIZE = 20;
+static const size_t TRAJECTORY_INDEX_ENTRY_SIZE = 24;
+static const char TRAJECTORY_MAGIC[4] = { 'C', 'S', 'T', 'R' };
+static const char TRAJECTORY_CHUNK_MAGIC[4] = { 'C', 'S', 'T', 'C' };
+static const char TRAJECTORY_INDEX_MAGIC[4] = { 'C', 'S', 'T', 'I' };
+static const uint32_t TRAJECTORY_FLAG_VELOCITIES = 1u;
+
+/** Offsets of the fields of the header filled in when the writer is closed. */
+static const size_t TRAJECTORY_FRAME_COUNT_OFFSET = 24;
+static const size_t TRAJECTORY_INDEX_OFFSET_OFFSET = 32;
+static const size_t TRAJECTORY_CHUNK_COUNT_OFFSET = 40;
+
+static const float QUANTISED_MAX = 65535.0f;
+static const int VELOCITY_ZERO = 32768;
+static const float VELOCITY_MAX = 32767.0f;
+
+static void storeU32(unsigned char* dst, uint32_t v) {
+    for (int i = 0; i < 4; i++)
+        dst[i] = (unsigned char) (v >> (8 * i));
+}
+
+static void storeU64(unsigned char* dst, uint64_t v) {
+    for (int i = 0; i < 8; i++)
+        dst[i] = (unsigned char) (v >> (8 * i));
+}
+
+static void storeF32(unsigned char* dst, float f) {
+    uint32_t v;
+    std::memcpy(&v, &f, sizeof(v));
+    storeU32(dst, v);
+}
+
+static uint32_t loadU32(const unsigned char* src) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; i++)
+        v |= (uint32_t) src[i] << (8 * i);
+    return v;
+}
+
+static uint64_t loadU64(const unsigned char* src) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++)
+        v |= (uint64_t) src[i] << (8 * i);
+    return v;
+}
+
+static float loadF32(const unsigned char* src) {
+    uint32_t v = loadU32(src);
+    float f;
+    std::memcpy(&f, &v, sizeof(f));
+    return f;
+}
+
+static uint16_t quantise(float value, float scale) {
+    return (uint16_t) std::min(std::max(std::floor(value * scale + 0.5f), 0.0f), QUANTISED_MAX);
+}
+
+static uint16_t quantiseVelocity(float value, float scale) {
+    return (uint16_t) (VELOCITY_ZERO + (int) std::floor(value * scale + 0.5f));
+}
+
+static void appendVarint(std::vector<unsigned char>& data, uint32_t v) {
+    while (v >= 0x80) {
+        data.push_back((unsigned char) (v | 0x80));
+        v >>= 7;
+    }
+    data.push_back((unsigned char) v);
+}
+
+/**
+ * @returns false if the varint runs past end (or is longer than 32 bits).
+ */
+static bool readVarint(const unsigned char*& src, const unsigned char* end, uint32_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 35 && src < end; shift += 7) {
+        unsigned char byte = *src++;
+        v |= (uint32_t) (byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+static uint32_t zigzag(int32_t v) {
+    return ((uint32_t) v << 1) ^ (uint32_t) (v >> 31);
+}
+
+static int32_t unzigzag(uint32_t v) {
+    return (int32_t) (v >> 1) ^ -(int32_t) (v & 1);
+}
+
+TrajectoryWriter::TrajectoryWriter() :
+mFile(), mLocation(), mFrameInterval(1), mFramesPerChunk(TRAJECTORY_FRAMES_PER_CHUNK), mVelocities(false),
+mAtomCount(0), mRecordedFrames(0), mThread(), mMutex(), mFrameQueued(), mFrameFreed(),
+mPendingFrames(), mFreeFrames(), mClosing(false), mFailed(false),
+mPrevious(), mQuantised(), mChunk(), mChunkFrames(0), mFirstChunkFrame(0), mFrameCount(0),
+mChunkOffsets(), mChunkFirstFrames(), mChunkFrameCounts() {
+}
+
+TrajectoryWriter::~TrajectoryWriter() {
+    close();
+}
+
+bool TrajectoryWriter::open(const std::string& location, const SimulationHandler& handler, unsigned int frameInterval,
+                            bool velocities, unsigned int framesPerChunk) {
+    close();
+    mFile.open(location, std::ios::binary | std::ios::trunc);
+    if (!mFile) {
+        LOG_ERROR(std::string("Failed to open file '").append(location).append("' for writing"));
+        return false;
+    }
+    mLocation = location;
+    mFrameInterval = std::max(frameInterval, 1u);
+    mFramesPerChunk = std::max(framesPerChunk, 1u);
+    mVelocities = velocities;
+    mAtomCount = handler.getActualAtomCount();
+
+    unsigned char header[TRAJECTORY_HEADER_SIZE] = {};
+    std::memcpy(header, TRAJECTORY_MAGIC, sizeof(TRAJECTORY_MAGIC));
+    storeU32(header + 4, TRAJECTORY_VERSION);
+    storeU32(header + 8, mVelocities ? TRAJECTORY_FLAG_VELOCITIES : 0u);
+    storeU32(header + 12, (uint32_t) mAtomCount);
+    storeU32(header + 16, mFrameInterval);
+    storeU32(header + 20, mFramesPerChunk);
+    mFile.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+    const AtomArrays& arrays = handler.getAtoms().getArrays();
+    mChunk.resize(mAtomCount * 4);
+    for (size_t i = 0; i < mAtomCount; i++)
+        storeU32(mChunk.data() + i * 4, arrays.atomType[i]);
+    mFile.write(reinterpret_cast<const char*>(mChunk.data()), (std::streamsize) mChunk.size());
+    if (!mFile) {
+        LOG_ERROR(std::string("Failed to write trajectory '").append(location).append("'"));
+        mFile.close();
+        return false;
+    }
+
+    size_t components = mAtomCount * (mVelocities ? 4 : 2);
+    mPrevious.assign(components, 0);
+    mQuantised.assign(components, 0);
+    mChunk.clear();
+    mChunkFrames = 0;
+    mFirstChunkFrame = 0;
+    mFrameCount = 0;
+    mChunkOffsets.clear();
+    mChunkFirstFrames.clear();
+    mChunkFrameCounts.clear();
+    mRecordedFrames = 0;
+    mClosing = false;
+    mFailed = false;
+
+    LOG_MESSAGE(std::string("Recording trajectory '").append(location).append("'"));
+    mThread = std::thread(&TrajectoryWriter::run, this);
+    return true;
+}
+
+bool TrajectoryWriter::close() {
+    if (!mThread.joinable())
+        return true;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mClosing = true;
+    }
+    mFrameQueued.notify_one();
+    mThread.join();
+    LOG_MESSAGE(std::string("Finished recording trajectory '").append(mLocation).append("'"));
+    return !mFailed;
+}
+
+bool TrajectoryWriter::hasFailed() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mFailed;
+}
+
+bool TrajectoryWriter::record(const SimulationHandler& handler, uint64_t iteration) {
+    if (!isOpen())
+        return false;
+    AtomsView atoms = handler.getAtoms();
+    std::unique_ptr<Frame> frame;
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        if (!mFailed && atoms.size() != mAtomCount) {
+            LOG_ERROR(std::string("Atoms changed while recording trajectory '").append(mLocation).append("'"));
+            mFailed = true;
+        }
+        if (mFailed)
+            return false;
+        mFrameFreed.wait(lock, [this]() { return mPendingFrames.size() < TRAJECTORY_MAX_PENDING_FRAMES; });
+        if (mFreeFrames.empty()) {
+            frame = std::make_unique<Frame>();
+        } else {
+            frame = std::move(mFreeFrames.back());
+            mFreeFrames.pop_back();
+        }
+    }
+
+    const AtomArrays& arrays = atoms.getArrays();
+    frame->iteration = iteration;
+    frame->width = handler.getWidth();
+    frame->height = handler.getHeight();
+    frame->x.assign(arrays.x.begin(), arrays.x.begin() + mAtomCount);
+    frame->y.assign(arrays.y.begin(), arrays.y.begin() + mAtomCount);
+    if (mVelocities) {
+        frame->vx.assign(arrays.vx.begin(), arrays.vx.begin() + mAtomCount);
+        frame->vy.assign(arrays.vy.begin(), arrays.vy.begin() + mAtomCount);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mPendingFrames.push_back(std::move(frame));
+    }
+    mFrameQueued.notify_one();
+    mRecordedFrames++;
+    return true;
+}
+
+void TrajectoryWriter::run() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true) {
+        mFrameQueued.wait(lock, [this]() { return mClosing || !mPendingFrames.empty(); });
+        if (mPendingFrames.empty())
+            break;
+        std::unique_ptr<Frame> frame = std::move(mPendingFrames.front());
+        mPendingFrames.pop_front();
+        bool failed = mFailed;
+        lock.unlock();
+
+        if (!failed)
+            encodeFrame(*frame);
+        // Chunks are flushed as they are written, so a full disk shows up here
+        bool writeFailed = !failed && !mFile;
+
+        lock.lock();
+        if (writeFailed) {
+            LOG_ERROR(std::string("Failed to write trajectory '").append(mLocation).append("'"));
+            mFailed = true;
+        }
+        mFreeFrames.push_back(std::move(frame));
+        mFrameFreed.notify_one();
+    }
+    lock.unlock();
+
+    if (mChunkFrames > 0)
+        writeChunk();
+    writeIndex();
+    mFile.close();
+
+    lock.lock();
+    if (!mFile && !mFailed) {
+        LOG_ERROR(std::string("Failed to write trajectory '").append(mLocation).append("'"));
+        mFailed = true;
+    }
+}
+
+void TrajectoryWriter::encodeFrame(const Frame& frame) {
+    size_t n = mAtomCount;
+    float scaleX = QUANTISED_MAX / frame.width;
+    float scaleY = QUANTISED_MAX / frame.height;
+    for (size_t i = 0; i < n; i++) {
+        mQuantised[i]     = quantise(frame.x[i], scaleX);
+        mQuantised[n + i] = quantise(frame.y[i], scaleY);
+    }
+
+    float velocityScale = 0.0f;
+    if (mVelocities) {
+        for (size_t i = 0; i < n; i++)
+            velocityScale = std::max(velocityScale, std::max(std::abs(frame.vx[i]), std::abs(frame.vy[i])));
+        float scale = velocityScale > 0.0f ? VELOCITY_MAX / velocityScale : 0.0f;
+        for (size_t i = 0; i < n; i++) {
+            mQuantised[2 * n + i] = quantiseVelocity(frame.vx[i], scale);
+            mQuantised[3 * n + i] = quantiseVelocity(frame.vy[i], scale);
+        }
+    }
+
+    size_t start = mChunk.size();
+    mChunk.resize(start + TRAJECTORY_FRAME_HEADER_SIZE);
+    storeU64(mChunk.data() + start, frame.iteration);
+    storeF32(mChunk.data() + start + 8, frame.width);
+    storeF32(mChunk.data() + start + 12, frame.height);
+    storeF32(mChunk.data() + start + 16, velocityScale);
+
+    if (mChunkFrames == 0) {
+        // Key frame, stored as is so the chunk can be decoded on its own
+        start = mChunk.size();
+        mChunk.resize(start + mQuantised.size() * 2);
+        for (size_t c = 0; c < mQuantised.size(); c++) {
+            mChunk[start + c * 2]     = (unsigned char) mQuantised[c];
+            mChunk[start + c * 2 + 1] = (unsigned char) (mQuantised[c] >> 8);
+        }
+    } else {
+        for (size_t c = 0; c < mQuantised.size(); c++)
+            appendVarint(mChunk, zigzag((int32_t) mQuantised[c] - (int32_t) mPrevious[c]));
+    }
+    std::swap(mPrevious, mQuantised);
+
+    mFrameCount++;
+    if (++mChunkFrames == mFramesPerChunk)
+        writeChunk();
+}
+
+void TrajectoryWriter::writeChunk() {
+    unsigned char header[TRAJECTORY_CHUNK_HEADER_SIZE] = {};
+    std::memcpy(header, TRAJECTORY_CHUNK_MAGIC, sizeof(TRAJECTORY_CHUNK_MAGIC));
+    storeU32(header + 4, mChunkFrames);
+    storeU32(header + 8, (uint32_t) mChunk.size());
+    storeU64(header + 16, mFirstChunkFrame);
+
+    mChunkOffsets.push_back((uint64_t) mFile.tellp());
+    mChunkFirstFrames.push_back(mFirstChunkFrame);
+    mChunkFrameCounts.push_back(mChunkFrames);
+    mFile.write(reinterpret_cast<const char*>(header), sizeof(header));
+    mFile.write(reinterpret_cast<const char*>(mChunk.data()), (std::streamsize) mChunk.size());
+    mFile.flush();
+
+    mFirstChunkFrame += mChunkFrames;
+    mChunkFrames = 0;
+    mChunk.clear();
+}
+
+void TrajectoryWriter::writeIndex() {
+    uint64_t indexOffset = (uint64_t) mFile.tellp();
+    mChunk.assign(8 + mChunkOffsets.size() * TRAJECTORY_INDEX_ENTRY_SIZE, 0);
+    std::memcpy(mChunk.data(), TRAJECTORY_INDEX_MAGIC, sizeof(TRAJECTORY_INDEX_MAGIC));
+    storeU32(mChunk.data() + 4, (uint32_t) mChunkOffsets.size());
+    for (size_t c = 0; c < mChunkOffsets.size(); c++) {
+        unsigned char* entry = mChunk.data() + 8 + c * TRAJECTORY_INDEX_ENTRY_SIZE;
+        storeU64(entry, mChunkOffsets[c]);
+        storeU64(entry + 8, mChunkFirstFrames[c]);
+        storeU32(entry + 16, mChunkFrameCounts[c]);
+    }
+    mFile.write(reinterpret_cast<const char*>(mChunk.data()), (std::streamsize) mChunk.size());
+    mChunk.clear();
+
+    // Only point the header at the index once it is complete, so a trajectory
+    // cut short is read by rebuilding the index instead
+    unsigned char fields[TRAJECTORY_CHUNK_COUNT_OFFSET + 4 - TRAJECTORY_FRAME_COUNT_OFFSET] = {};
+    storeU64(fields, mFrameCount);
+    storeU64(fields + TRAJECTORY_INDEX_OFFSET_OFFSET - TRAJECTORY_FRAME_COUNT_OFFSET, indexOffset);
+    storeU32(fields + TRAJECTORY_CHUNK_COUNT_OFFSET - TRAJECTORY_FRAME_COUNT_OFFSET, (uint32_t) mChunkOffsets.size());
+    mFile.flush();
+    mFile.seekp(TRAJECTORY_FRAME_COUNT_OFFSET);
+    mFile.write(reinterpret_cast<const char*>(fields), sizeof(fields));
+}
+
+TrajectoryReader::TrajectoryReader() :
+mFile(), mLocation(), mFrameInterval(1), mVelocities(false), mFrameCount(0), mAtomTypes(),
+mChunkOffsets(), mChunkFirstFrames(), mChunkFrameCounts(),
+mLoadedChunk(0), mChunk(nullptr), mChunkSize(0), mChunkPosition(0), mDecodedFrames(0),
+mQuantised(), mIteration(0), mWidth(0.0f), mHeight(0.0f), mVelocityScale(0.0f) {
+}
+
+bool TrajectoryReader::open(const std::string& location) {
+    close();
+    mFile = std::make_unique<MappedFile>(location);
+    if (!mFile->isValid()) {
+        LOG_ERROR(std::string("Failed to open file '").append(location).append("'"));
+        close();
+        return false;
+    }
+    mLocation = location;
+    const unsigned char* data = mFile->data();
+    uint64_t fileSize = mFile->size();
+
+    if (fileSize < TRAJECTORY_HEADER_SIZE || std::memcmp(data, TRAJECTORY_MAGIC, sizeof(TRAJECTORY_MAGIC)) != 0) {
+        LOG_ERROR(std::string("File '").append(location).append("' is not a trajectory"));
+        close();
+        return false;
+    }
+    uint32_t version = loadU32(data + 4);
+    if (version != TRAJECTORY_VERSION) {
+        LOG_ERROR(
+            std::string("Trajectory '").append(location).append("' has unsupported version ").append(std::to_string(version))
+        );
+        close();
+        return false;
+    }
+    mVelocities = (loadU32(data + 8) & TRAJECTORY_FLAG_VELOCITIES) != 0;
+    uint64_t atomCount = loadU32(data + 12);
+    mFrameInterval = std::max(loadU32(data + 16), 1u);
+    uint64_t indexOffset = loadU64(data + TRAJECTORY_INDEX_OFFSET_OFFSET);
+    uint64_t chunkCount = loadU32(data + TRAJECTORY_CHUNK_COUNT_OFFSET);
+
+    uint64_t dataStart = TRAJECTORY_HEADER_SIZE + atomCount * 4;
+    if (dataStart > fileSize) {
+        LOG_ERROR(std::string("Trajectory '").append(location).append("' is corrupt"));
+        close();
+        return false;
+    }
+    mAtomTypes.resize((size_t) atomCount);
+    for (size_t i = 0; i < mAtomTypes.size(); i++)
+        mAtomTypes[i] = loadU32(data + TRAJECTORY_HEADER_SIZE + i * 4);
+
+    const unsigned char* index = data + indexOffset;
+    if (indexOffset >= dataStart && indexOffset + 8 + chunkCount * TRAJECTORY_INDEX_ENTRY_SIZE <= fileSize
+        && std::memcmp(index, TRAJECTORY_INDEX_MAGIC, sizeof(TRAJECTORY_INDEX_MAGIC)) == 0 && loadU32(index + 4) == chunkCount) {
+        for (size_t c = 0; c < chunkCount; c++) {
+            const unsigned char* entry = index + 8 + c * TRAJECTORY_INDEX_ENTRY_SIZE;
+            mChunkOffsets.push_back(loadU64(entry));
+            mChunkFirstFrames.push_back(loadU64(entry + 8));
+            mChunkFrameCounts.push_back(loadU32(entry + 16));
+            if (mChunkFirstFrames.back() != mFrameCount || mChunkOffsets.back() < dataStart || mChunkOffsets.back() >= indexOffset) {
+                LOG_ERROR(std::string("Trajectory '").append(location).append("' is corrupt"));
+                close();
+                return false;
+            }
+            mFrameCount += mChunkFrameCounts.back();
+        }
+    } else {
+        LOG_WARNING(
+            std::string("Trajectory '").append(location).append("' has no index (recording did not finish), rebuilding it")
+        );
+        rebuildIndex(dataStart);
+    }
+
+    mLoadedChunk = mChunkOffsets.size();
+    mQuantised.assign((size_t) atomCount * (mVelocities ? 4 : 2), 0);
+    return true;
+}
+
+void TrajectoryReader::close() {
+    mFile.reset();
+    mFrameCount = 0;
+    mAtomTypes.clear();
+    mChunkOffsets.clear();
+    mChunkFirstFrames.clear();
+    mChunkFrameCounts.clear();
+    mLoadedChunk = 0;
+    mChunk = nullptr;
+    mChunkSize = 0;
+    mDecodedFrames = 0;
+}
+
+bool TrajectoryReader::rebuildIndex(uint64_t dataStart) {
+    const unsigned char* data = mFile->data();
+    uint64_t fileSize = mFile->size();
+    uint64_t offset = dataStart;
+    while (offset + TRAJECTORY_CHUNK_HEADER_SIZE <= fileSize) {
+        const unsigned char* header = data + offset;
+        if (std::memcmp(header, TRAJECTORY_CHUNK_MAGIC, sizeof(TRAJECTORY_CHUNK_MAGIC)) != 0)
+            break;
+        uint64_t end = offset + TRAJECTORY_CHUNK_HEADER_SIZE + loadU32(header + 8);
+        if (end > fileSize || loadU64(header + 16) != mFrameCount)
+            break;
+        mChunkOffsets.push_back(offset);
+        mChunkFirstFrames.push_back(mFrameCount);
+        mChunkFrameCounts.push_back(loadU32(header + 4));
+        mFrameCount += mChunkFrameCounts.back();
+        offset = end;
+    }
+    return !mChunkOffsets.empty();
+}
+
+bool TrajectoryReader::loadChunk(size_t chunk) {
+    mLoadedChunk = mChunkOffsets.size();
+    uint64_t offset = mChunkOffsets[chunk];
+    if (offset + TRAJECTORY_CHUNK_HEADER_SIZE > mFile->size())
+        return false;
+    const unsigned char* header = mFile->data() + offset;
+    uint64_t size = loadU32(header + 8);
+    if (std::memcmp(header, TRAJECTORY_CHUNK_MAGIC, sizeof(TRAJECTORY_CHUNK_MAGIC)) != 0
+        || loadU32(header + 4) != mChunkFrameCounts[chunk]
+        || offset + TRAJECTORY_CHUNK_HEADER_SIZE + size > mFile->size())
+        return false;
+    mChunk = header + TRAJECTORY_CHUNK_HEADER_SIZE;
+    mChunkSize = (size_t) size;
+    mLoadedChunk = chunk;
+    mChunkPosition = 0;
+    mDecodedFrames = 0;
+    return true;
+}
+
+bool TrajectoryReader::decodeNextFrame() {
+    const unsigned char* src = mChunk + mChunkPosition;
+    const unsigned char* end = mChunk + mChunkSize;
+    if (mDecodedFrames >= mChunkFrameCounts[mLoadedChunk] || (size_t) (end - src) < TRAJECTORY_FRAME_HEADER_SIZE)
+        return false;
+    mIteration     = loadU64(src);
+    mWidth         = loadF32(src + 8);
+    mHeight        = loadF32(src + 12);
+    mVelocityScale = loadF32(src + 16);
+    src += TRAJECTORY_FRAME_HEADER_SIZE;
+
+    if (mDecodedFrames == 0) {
+        if ((size_t) (end - src) < mQuantised.size() * 2)
+            return false;
+        for (size_t c = 0; c < mQuantised.size(); c++)
+            mQuantised[c] = (uint16_t) (src[c * 2] | (src[c * 2 + 1] << 8));
+        src += mQuantised.size() * 2;
+    } else {
+        for (uint16_t& q : mQuantised) {
+            uint32_t delta;
+            if (!readVarint(src, end, delta))
+                return false;
+            int32_t value = (int32_t) q + unzigzag(delta);
+            if (value < 0 || value > (int32_t) QUANTISED_MAX)
+                return false;
+            q = (uint16_t) value;
+        }
+    }
+    mChunkPosition = src - mChunk;
+    mDecodedFrames++;
+    return true;
+}
+
+bool TrajectoryReader::readFrame(size_t frame, TrajectoryFrame& out) {
+    if (frame >= mFrameCount)
+        return false;
+    size_t chunk = std::upper_bound(mChunkFirstFrames.begin(), mChunkFirstFrames.end(), (uint64_t) frame)
+                 - mChunkFirstFrames.begin() - 1;
+    uint32_t target = (uint32_t) (frame - mChunkFirstFrames[chunk]) + 1;
+
+    bool valid = true;
+    if (chunk != mLoadedChunk || mDecodedFrames > target)
+        valid = loadChunk(chunk);
+    while (valid && mDecodedFrames < target)
+        valid = decodeNextFrame();
+    if (!valid) {
+        mLoadedChunk = mChunkOffsets.size();
+        LOG_ERROR(
+            std::string("Trajectory '").append(mLocation).append("' is corrupt at frame ").append(std::to_string(frame))
+        );
+        return false;
+    }
+
+    size_t n = mAtomTypes.size();
+    out.iteration = mIteration;
+    out.width = mWidth;
+    out.height = mHeight;
+    out.x.resize(n);
+    out.y.resize(n);
+    float scaleX = mWidth / QUANTISED_MAX;
+    float scaleY = mHeight / QUANTISED_MAX;
+    for (size_t i = 0; i < n; i++) {
+        out.x[i] = mQuantised[i] * scaleX;
+        out.y[i] = mQuantised[n + i] * scaleY;
+    }
+    if (mVelocities) {
+        out.vx.resize(n);
+        out.vy.resize(n);
+        float scale = mVelocityScale / VELOCITY_MAX;
+        for (size_t i = 0; i < n; i++) {
+            out.vx[i] = ((int) mQuantised[2 * n + i] - VELOCITY_ZERO) * scale;
+            out.vy[i] = ((int) mQuantised[3 * n + i] - VELOCITY_ZERO) * scale;
+        }
+    } else {
+        out.vx.clear();
+        out.vy.clear();
+    }
+    return true;
+}
@@ -0,0 +1,235 @@
+/**
+ * @file   Trajectory.h
+ * @brief  Recording and playback of compressed atom trajectories.
+ *
+ * @author Stuart Lewis
+ * @date   January 2023
+ */
+#pragma once
+#include "MappedFile.h"
+#include "SimulationHandler.h"
+#include "../model/AlignedAllocator.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define TRAJECTORY_FILE_EXTENSION "cstraj"
+#define TRAJECTORY_VERSION 1u
+
+/** Default number of frames per chunk (see TrajectoryWriter). */
+const unsigned int TRAJECTORY_FRAMES_PER_CHUNK = 64;
+/** Maximum number of frames waiting to be written before TrajectoryWriter::record blocks. */
+const size_t TRAJECTORY_MAX_PENDING_FRAMES = 16;
+
+/**
+ * Positions (and optionally velocities) of every atom at one iteration.
+ */
+struct TrajectoryFrame {
+    uint64_t iteration = 0;
+    float width = 0.0f;
+    float height = 0.0f;
+
+    AlignedVector<float> x;
+    AlignedVector<float> y;
+    /** Empty if the trajectory was recorded without velocities. */
+    AlignedVector<float> vx;
+    AlignedVector<float> vy;
+
+    [[nodiscard]] inline size_t size() const { return x.size(); }
+};
+
+/**
+ * Appends frames of a running simulation to a trajectory file.
+ *
+ * Positions are quantised to 16 bits relative to the simulation bounds, and
+ * velocities to 16 bits relative to the fastest atom of the frame. Frames are
+ * grouped into chunks: the first frame of each chunk is stored as is, and
+ * every following frame as the zigzag varint encoded difference from the
+ * frame before, so slowly moving atoms take one or two bytes per component.
+ * An index of the chunks is appended when the writer is closed, so any frame
+ * can be decoded from the start of its chunk (see TrajectoryReader).
+ *
+ * TrajectoryWriter::record only copies the atoms into a recycled buffer.
+ * Encoding and writing happen on a background thread, so iterating never
+ * waits on the disk unless more than TRAJECTORY_MAX_PENDING_FRAMES frames
+ * are waiting to be written.
+ */
+class TrajectoryWriter {
+public:
+    TrajectoryWriter();
+    ~TrajectoryWriter();
+
+    TrajectoryWriter(const TrajectoryWriter&) = delete;
+    TrajectoryWriter& operator=(const TrajectoryWriter&) = delete;
+
+    /**
+     * Create a trajectory of the atoms currently in handler, closing any
+     * trajectory already open. The number and types of the atoms must not
+     * change until the writer is closed.
+     * @param frameInterval Number of iterations between frames (see
+     * TrajectoryWriter::isFrameDue).
+     * @param velocities Record velocities as well as positions.
+     * @returns true if the file is created, otherwise false.
+     */
+    bool open(const std::string& location, const SimulationHandler& handler, unsigned int frameInterval,
+              bool velocities, unsigned int framesPerChunk = TRAJECTORY_FRAMES_PER_CHUNK);
+    /**
+     * Write any remaining frames and the chunk index, then close the file.
+     * Blocks until every frame is written.
+     * @returns false if any frame could not be written, otherwise true.
+     */
+    bool close();
+    [[nodiscard]] inline bool isOpen() const { return mThread.joinable(); }
+    /**
+     * @returns true if writing has failed (or the atoms changed), in which
+     * case further frames are discarded and the writer should be closed.
+     */
+    [[nodiscard]] bool hasFailed();
+
+    [[nodiscard]] inline unsigned int getFrameInterval() const { return mFrameInterval; }
+    [[nodiscard]] inline bool isFrameDue(uint64_t iteration) const { return iteration % mFrameInterval == 0; }
+    [[nodiscard]] inline size_t getRecordedFrameCount() const { return mRecordedFrames; }
+
+    /**
+     * Queue a frame of the atoms in handler. In the GPU build its atoms must
+     * first be downloaded (see SimulationHandler::downloadAtoms).
+     * @param iteration Iteration the frame is of, stored alongside it.
+     * @returns false if the writer is not open or has failed, otherwise true.
+     */
+    bool record(const SimulationHandler& handler, uint64_t iteration);
+private:
+    struct Frame {
+        uint64_t iteration = 0;
+        float width = 0.0f;
+        float height = 0.0f;
+        AlignedVector<float> x;
+        AlignedVector<float> y;
+        AlignedVector<float> vx;
+        AlignedVector<float> vy;
+    };
+
+    void run();
+    /**
+     * Quantise and append frame to the current chunk.
+     */
+    void encodeFrame(const Frame& frame);
+    /**
+     * Write the current chunk to the file and flush it, then start a new one.
+     * Leaves mFile failed if the chunk could not be written.
+     */
+    void writeChunk();
+    /**
+     * Write the chunk index, and fill in the frame count and index location
+     * in the header.
+     */
+    void writeIndex();
+
+    std::ofstream mFile;
+    std::string mLocation;
+    unsigned int mFrameInterval;
+    unsigned int mFramesPerChunk;
+    bool mVelocities;
+    size_t mAtomCount;
+    size_t mRecordedFrames;
+
+    std::thread mThread;
+    /** Guards the queues and flags below. */
+    std::mutex mMutex;
+    std::condition_variable mFrameQueued;
+    std::condition_variable mFrameFreed;
+    std::deque<std::unique_ptr<Frame>> mPendingFrames;
+    std::vector<std::unique_ptr<Frame>> mFreeFrames;
+    bool mClosing;
+    bool mFailed;
+
+    // Only accessed by the background thread while open
+    /** Quantised components of the last encoded frame, component by component. */
+    std::vector<uint16_t> mPrevious;
+    std::vector<uint16_t> mQuantised;
+    std::vector<unsigned char> mChunk;
+    unsigned int mChunkFrames;
+    uint64_t mFirstChunkFrame;
+    uint64_t mFrameCount;
+    /** File offset, first frame and frame count of every written chunk. */
+    std::vector<uint64_t> mChunkOffsets;
+    std::vector<uint64_t> mChunkFirstFrames;
+    std::vector<uint32_t> mChunkFrameCounts;
+};
+
+/**
+ * Reads frames from a trajectory written by TrajectoryWriter, in any order.
+ *
+ * The file is memory mapped, and only the chunk containing the requested
+ * frame is decoded (so only its pages are read from disk). The last decoded
+ * frame is kept, so reading frames in order decodes each frame once. If the
+ * writer was never closed (so there is no chunk index), the index is rebuilt
+ * from the chunks that were completely written.
+ */
+class TrajectoryReader {
+public:
+    TrajectoryReader();
+
+    /**
+     * Open a trajectory, closing any trajectory already open.
+     * @returns true if the file is a valid trajectory, otherwise false.
+     */
+    bool open(const std::string& location);
+    void close();
+    [[nodiscard]] inline bool isOpen() const { return mFile != nullptr; }
+
+    [[nodiscard]] inline size_t getAtomCount() const { return mAtomTypes.size(); }
+    [[nodiscard]] inline size_t getFrameCount() const { return mFrameCount; }
+    [[nodiscard]] inline unsigned int getFrameInterval() const { return mFrameInterval; }
+    [[nodiscard]] inline bool hasVelocities() const { return mVelocities; }
+    /** Type of every atom, which does not change between frames. */
+    [[nodiscard]] inline const std::vector<atom_type_id>& getAtomTypes() const { return mAtomTypes; }
+
+    /**
+     * Decode frame into out, reusing its allocations.
+     * @returns false if frame is out of range or the file is corrupt,
+     * otherwise true.
+     */
+    bool readFrame(size_t frame, TrajectoryFrame& out);
+private:
+    bool rebuildIndex(uint64_t dataStart);
+    bool loadChunk(size_t chunk);
+    /**
+     * Decode the next frame of the loaded chunk into mQuantised.
+     */
+    bool decodeNextFrame();
+
+    std::unique_ptr<MappedFile> mFile;
+    std::string mLocation;
+    unsigned int mFrameInterval;
+    bool mVelocities;
+    uint64_t mFrameCount;
+    std::vector<atom_type_id> mAtomTypes;
+
+    std::vector<uint64_t> mChunkOffsets;
+    std::vector<uint64_t> mChunkFirstFrames;
+    std::vector<uint32_t> mChunkFrameCounts;
+
+    /** Index of the loaded chunk, or mChunkOffsets.size() if none is loaded. */
+    size_t mLoadedChunk;
+    /** Frames of the loaded chunk, within the mapped file. */
+    const unsigned char* mChunk;
+    size_t mChunkSize;
+    /** Offset into mChunk of the next frame to decode. */
+    size_t mChunkPosition;
+    /** Number of frames of the loaded chunk decoded so far. */
+    uint32_t mDecodedFrames;
+
+    /** Quantised components of the last decoded frame. */
+    std::vector<uint16_t> mQuantised;
+    uint64_t mIteration;
+    float mWidth;
+    float mHeight;
+    float mVelocityScale;
+};
@@ -0,0 +1,142 @@
+#include "TrajectoryPlayer.h"
+
+#include <algorithm>
+
+TrajectoryPlayer::TrajectoryPlayer() :
+mReader(), mFrame(), mFrameCount(0), mFrameInterval(1), mAtomTypeCount(0),
+mThread(), mMutex(), mWake(), mSlots(), mPlayhead(0), mStep(1),
+mDisplayedSlot(NO_FRAME), mDisplayedFrame(NO_FRAME), mDisplayedIteration(0), mStopping(false), mFailed(false) {
+}
+
+TrajectoryPlayer::~TrajectoryPlayer() {
+    close();
+}
+
+bool TrajectoryPlayer::open(const std::string& location) {
+    close();
+    if (!mReader.open(location))
+        return false;
+    mFrameCount = mReader.getFrameCount();
+    mFrameInterval = mReader.getFrameInterval();
+    mAtomTypeCount = 0;
+    for (atom_type_id atomType : mReader.getAtomTypes())
+        mAtomTypeCount = std::max(mAtomTypeCount, (size_t) atomType + 1);
+
+    for (Slot& slot : mSlots) {
+        slot.frame = NO_FRAME;
+        slot.ready = false;
+        slot.snapshot.atomType.assign(mReader.getAtomTypes().begin(), mReader.getAtomTypes().end());
+    }
+    mPlayhead = 0;
+    mStep = 1;
+    mDisplayedSlot = NO_FRAME;
+    mDisplayedFrame = NO_FRAME;
+    mDisplayedIteration = 0;
+    mStopping = false;
+    mFailed = false;
+    mThread = std::thread(&TrajectoryPlayer::run, this);
+    return true;
+}
+
+void TrajectoryPlayer::close() {
+    if (!mThread.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mWake.notify_one();
+    mThread.join();
+    mReader.close();
+    mFrameCount = 0;
+}
+
+bool TrajectoryPlayer::hasFailed() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mFailed;
+}
+
+void TrajectoryPlayer::setPlayhead(size_t frame, size_t step) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mPlayhead = std::min(frame, mFrameCount > 0 ? mFrameCount - 1 : 0);
+        mStep = std::max(step, (size_t) 1);
+    }
+    mWake.notify_one();
+}
+
+SimulationSnapshot* TrajectoryPlayer::acquireSnapshot() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (size_t s = 0; s < mSlots.size(); s++) {
+            if (mSlots[s].ready && mSlots[s].frame == mPlayhead) {
+                mDisplayedSlot = s;
+                mDisplayedFrame = mPlayhead;
+                mDisplayedIteration = mSlots[s].iteration;
+                break;
+            }
+        }
+    }
+    // The previously displayed slot may be free to decode into
+    mWake.notify_one();
+    return mDisplayedSlot == NO_FRAME ? nullptr : &mSlots[mDisplayedSlot].snapshot;
+}
+
+bool TrajectoryPlayer::findWork(size_t& frame, size_t& slot) const {
+    for (size_t k = 0; k < TRAJECTORY_PLAYBACK_LOOKAHEAD; k++) {
+        frame = mPlayhead + k * mStep;
+        if (frame >= mFrameCount)
+            return false;
+        bool held = false;
+        for (const Slot& s : mSlots)
+            held = held || s.frame == frame;
+        if (held)
+            continue;
+
+        // Reuse a slot holding a frame that is no longer ahead of the playhead
+        for (slot = 0; slot < mSlots.size(); slot++) {
+            const Slot& s = mSlots[slot];
+            if (slot == mDisplayedSlot || (s.frame != NO_FRAME && !s.ready))
+                continue;
+            bool ahead = s.frame != NO_FRAME && s.frame >= mPlayhead && (s.frame - mPlayhead) % mStep == 0
+                      && (s.frame - mPlayhead) / mStep < TRAJECTORY_PLAYBACK_LOOKAHEAD;
+            if (!ahead)
+                return true;
+        }
+        return false;
+    }
+    return false;
+}
+
+void TrajectoryPlayer::run() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    size_t frame = 0;
+    size_t slot = 0;
+    while (true) {
+        mWake.wait(lock, [&]() { return mStopping || (!mFailed && findWork(frame, slot)); });
+        if (mStopping)
+            return;
+        mSlots[slot].frame = frame;
+        mSlots[slot].ready = false;
+        lock.unlock();
+
+        bool decoded = mReader.readFrame(frame, mFrame);
+        if (decoded) {
+            // Swap rather than copy, so the slot's old arrays are reused by the next frame
+            SimulationSnapshot& snapshot = mSlots[slot].snapshot;
+            mSlots[slot].iteration = mFrame.iteration;
+            snapshot.width = mFrame.width;
+            snapshot.height = mFrame.height;
+            snapshot.x.swap(mFrame.x);
+            snapshot.y.swap(mFrame.y);
+        }
+
+        lock.lock();
+        if (decoded) {
+            mSlots[slot].ready = true;
+        } else {
+            mSlots[slot].frame = NO_FRAME;
+            mFailed = true;
+        }
+    }
+}
@@ -0,0 +1,127 @@
+/**
+ * @file   TrajectoryPlayer.h
+ * @brief  Decodes trajectory frames ahead of a playhead for playback.
+ *
+ * @author Stuart Lewis
+ * @date   January 2023
+ */
+#pragma once
+#include "Trajectory.h"
+#include "../model/SimulationSnapshot.h"
+
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/** Number of frames from the playhead onwards decoded in advance (see TrajectoryPlayer). */
+const size_t TRAJECTORY_PLAYBACK_LOOKAHEAD = 8;
+
+/**
+ * Plays back a trajectory (see TrajectoryReader) as SimulationSnapshots, so
+ * it can be drawn in place of a running simulation.
+ *
+ * A background thread decodes the frames at and after the playhead into a
+ * ring of snapshots, so moving the playhead forwards at a steady rate never
+ * waits on decoding. Snapshots only hold positions and atom types; the atom
+ * type colours and atom diameter are left for the caller to fill in.
+ *
+ * Every function must be called from the same thread.
+ */
+class TrajectoryPlayer {
+public:
+    TrajectoryPlayer();
+    ~TrajectoryPlayer();
+
+    TrajectoryPlayer(const TrajectoryPlayer&) = delete;
+    TrajectoryPlayer& operator=(const TrajectoryPlayer&) = delete;
+
+    /**
+     * Open a trajectory, with the playhead at the first frame. Closes any
+     * trajectory already open.
+     * @returns true if the file is a valid trajectory, otherwise false.
+     */
+    bool open(const std::string& location);
+    void close();
+    [[nodiscard]] inline bool isOpen() const { return mThread.joinable(); }
+    /**
+     * @returns true if a frame could not be decoded, after which no more
+     * frames are decoded.
+     */
+    [[nodiscard]] bool hasFailed();
+
+    [[nodiscard]] inline size_t getFrameCount() const { return mFrameCount; }
+    [[nodiscard]] inline unsigned int getFrameInterval() const { return mFrameInterval; }
+    /** One more than the largest atom type id in the trajectory. */
+    [[nodiscard]] inline size_t getAtomTypeCount() const { return mAtomTypeCount; }
+
+    /**
+     * Move the playhead, clamped to the last frame.
+     * @param step Number of frames the playhead moves forward by each time,
+     * so only the frames that will be shown are decoded in advance.
+     */
+    void setPlayhead(size_t frame, size_t step = 1);
+    [[nodiscard]] inline size_t getPlayhead() const { return mPlayhead; }
+
+    /**
+     * @returns The snapshot of the playhead frame if it has been decoded,
+     * otherwise the last snapshot returned (or nullptr if there is none). The
+     * snapshot may be modified, and is left untouched by the player until the
+     * next call.
+     */
+    SimulationSnapshot* acquireSnapshot();
+    /**
+     * @returns Frame of the snapshot last returned by
+     * TrajectoryPlayer::acquireSnapshot.
+     */
+    [[nodiscard]] inline size_t getDisplayedFrame() const { return mDisplayedFrame; }
+    /**
+     * @returns Iteration of the snapshot last returned by
+     * TrajectoryPlayer::acquireSnapshot.
+     */
+    [[nodiscard]] inline uint64_t getDisplayedIteration() const { return mDisplayedIteration; }
+private:
+    struct Slot {
+        /** Frame held (or being decoded), or NO_FRAME. */
+        size_t frame = NO_FRAME;
+        bool ready = false;
+        uint64_t iteration = 0;
+        SimulationSnapshot snapshot;
+    };
+
+    void run();
+    /**
+     * Find the next frame ahead of the playhead that is not decoded, and a
+     * slot to decode it into. Requires mMutex to be locked.
+     * @returns false if every frame ahead of the playhead is decoded (or no
+     * slot is free).
+     */
+    bool findWork(size_t& frame, size_t& slot) const;
+
+    TrajectoryReader mReader;
+    /** Frame decoded into by the background thread before moving it into a slot. */
+    TrajectoryFrame mFrame;
+    size_t mFrameCount;
+    unsigned int mFrameInterval;
+    size_t mAtomTypeCount;
+
+    std::thread mThread;
+    /** Guards the slots and state below. */
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    /** One slot per frame ahead of the playhead, plus one for the displayed frame. */
+    std::array<Slot, TRAJECTORY_PLAYBACK_LOOKAHEAD + 1> mSlots;
+    size_t mPlayhead;
+    size_t mStep;
+    /** Slot returned by TrajectoryPlayer::acquireSnapshot, which is never decoded into. */
+    size_t mDisplayedSlot;
+    size_t mDisplayedFrame;
+    uint64_t mDisplayedIteration;
+    bool mStopping;
+    bool mFailed;
+
+    static const size_t NO_FRAME = (size_t) -1;
+};
@@ -0,0 +1,338 @@
+#include "../control/Ensemble.h"
+#include "../control/SaveAndLoad.h"
+#include "../control/SimulationHandler.h"
+#include "../control/Trajectory.h"
+#include "../view/Logger.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+
+/**
+ * Command line options for a headless run.
+ */
+struct HeadlessOptions {
+    std::string configFile = "resources/current.csdat";
+    std::string outputPrefix = "headless";
+    /** Checkpoint to resume from instead of generating atoms from the config. */
+    std::string resumeFile;
+    /** Checkpoint to save the final state to. */
+    std::string checkpointFile;
+    unsigned int iterations = 1000;
+    unsigned int threads = std::thread::hardware_concurrency();
+    /** Seed to generate the atoms with, in place of the seed in the config (if hasSeed). */
+    uint64_t seed = 0;
+    bool hasSeed = false;
+    /** Number of ensemble members to run (see Ensemble), or 0 to run a single simulation. */
+    unsigned int members = 0;
+    /** Trajectory to record the run to (see TrajectoryWriter). */
+    std::string trajectoryFile;
+    /** Iterations between trajectory frames. */
+    unsigned int trajectoryInterval = 10;
+    /** Record velocities in the trajectory as well as positions. */
+    bool trajectoryVelocities = false;
+};
+
+static void printUsage(const char* executable) {
+    std::printf(
+        "Usage: %s [config.csdat] [options]\n"
+        "  -n <iterations>  Number of iterations to run (default: 1000)\n"
+        "  -t <threads>     Number of threads to iterate with (default: all cores)\n"
+        "  -o <prefix>      Prefix of the output files (default: headless)\n"
+        "  -r <checkpoint>  Resume from a checkpoint (.cschk) instead of the config\n"
+        "  -c <checkpoint>  Save the final state to a checkpoint (.cschk)\n"
+        "  -s <seed>        Seed to generate the atoms with (default: the seed in the config). Can not\n"
+        "                   be used with -r, as a checkpoint keeps its own\n"
+        "  -e <members>     Run an ensemble of members seeded consecutively from the seed, writing\n"
+        "                   a summary of each member to <prefix>_ensemble.csv\n"
+        "  -j <trajectory>  Record the positions of every atom to a trajectory (.cstraj)\n"
+        "  -k <interval>    Iterations between trajectory frames (default: 10)\n"
+        "  -v               Record velocities in the trajectory as well as positions\n"
+        "Writes the final atom state to <prefix>_atoms.csv and run statistics to <prefix>_stats.json.\n",
+        executable
+    );
+}
+
+/**
+ * Parse command line arguments into options.
+ * @returns false if the arguments are invalid, otherwise true.
+ */
+static bool parseArguments(int argc, char* args[], HeadlessOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = args[i];
+        if (arg == "-h" || arg == "--help") {
+            return false;
+        } else if (arg == "-v") {
+            options.trajectoryVelocities = true;
+        } else if (arg == "-n" || arg == "-t" || arg == "-o" || arg == "-r" || arg == "-c" || arg == "-s" || arg == "-e"
+                || arg == "-j" || arg == "-k") {
+            if (i + 1 >= argc) {
+                std::fprintf(stderr, "Missing value for '%s'\n", arg.c_str());
+                return false;
+            }
+            std::string value = args[++i];
+            if (arg == "-o") {
+                options.outputPrefix = value;
+            } else if (arg == "-r") {
+                options.resumeFile = value;
+            } else if (arg == "-c") {
+                options.checkpointFile = value;
+            } else if (arg == "-j") {
+                options.trajectoryFile = value;
+            } else if (arg == "-s") {
+                if (!parseUint(value, options.seed)) {
+                    std::fprintf(stderr, "Invalid value '%s' for '%s'\n", value.c_str(), arg.c_str());
+                    return false;
+                }
+                options.hasSeed = true;
+            } else if (!parseUint(value, arg == "-n" ? options.iterations : arg == "-t" ? options.threads
+                                       : arg == "-k" ? options.trajectoryInterval : options.members)) {
+                std::fprintf(stderr, "Invalid value '%s' for '%s'\n", value.c_str(), arg.c_str());
+                return false;
+            }
+        } else if (!arg.empty() && arg[0] == '-') {
+            std::fprintf(stderr, "Unknown option '%s'\n", arg.c_str());
+            return false;
+        } else {
+            options.configFile = arg;
+        }
+    }
+    if (options.hasSeed && !options.resumeFile.empty()) {
+        std::fprintf(stderr, "A seed ('-s') can not be used when resuming from a checkpoint ('-r'), which keeps its own\n");
+        return false;
+    }
+    if (options.members > 0 && (!options.resumeFile.empty() || !options.checkpointFile.empty() || !options.trajectoryFile.empty())) {
+        std::fprintf(stderr, "Checkpoints ('-r', '-c') and trajectories ('-j') can not be used with ensembles ('-e')\n");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Write the state of every generated atom to a CSV file.
+ */
+static bool writeAtoms(const std::string& location, const SimulationHandler& handler) {
+    std::ofstream file(location);
+    if (!file) {
+        LOG_ERROR(std::string("Failed to open file '").append(location).append("' for writing"));
+        return false;
+    }
+
+    file << "Index,Type,X,Y,VX,VY\n";
+    AtomsView atoms = handler.getAtoms();
+    for (size_t i = 0; i < atoms.size(); i++) {
+        Atom atom = atoms[i];
+        file << i << ',' << atom.atomType << ',' << atom.x << ',' << atom.y << ',' << atom.vx << ',' << atom.vy << '\n';
+    }
+    return (bool) file;
+}
+
+/**
+ * @returns value with the characters JSON does not allow in a string escaped.
+ */
+static std::string escapeJson(const std::string& value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            escaped.append(1, '\\').append(1, c);
+        } else if ((unsigned char) c < 0x20) {
+            char code[7];
+            std::snprintf(code, sizeof(code), "\\u%04x", (unsigned int) (unsigned char) c);
+            escaped.append(code);
+        } else {
+            escaped.append(1, c);
+        }
+    }
+    return escaped;
+}
+
+/**
+ * Write statistics of the run to a JSON file.
+ */
+static bool writeStats(const std::string& location, const SimulationHandler& handler,
+                       const HeadlessOptions& options, double seconds) {
+    std::ofstream file(location);
+    if (!file) {
+        LOG_ERROR(std::string("Failed to open file '").append(location).append("' for writing"));
+        return false;
+    }
+
+    file << "{\n"
+         << "  \"config\": \"" << escapeJson(options.resumeFile.empty() ? options.configFile : options.resumeFile) << "\",\n"
+         << "  \"atoms\": " << handler.getActualAtomCount() << ",\n"
+         << "  \"atomTypes\": " << handler.getAtomTypeCount() << ",\n"
+         << "  \"seed\": " << handler.getSeed() << ",\n"
+         << "  \"threads\": " << handler.getThreadCount() << ",\n"
+         << "  \"instructionSet\": \"" << getInstructionSetName(handler.getInstructionSet()) << "\",\n"
+         << "  \"iterations\": " << options.iterations << ",\n"
+         << "  \"seconds\": " << seconds << ",\n"
+         << "  \"iterationsPerSecond\": " << (seconds > 0.0 ? options.iterations / seconds : 0.0) << ",\n"
+         << "  \"kineticEnergy\": " << getMotionStats(handler.getAtoms()).kineticEnergy << "\n"
+         << "}\n";
+    return (bool) file;
+}
+
+/**
+ * Write the final state of every ensemble member to a CSV file.
+ */
+static bool writeEnsemble(const std::string& location, const Ensemble& ensemble) {
+    std::ofstream file(location);
+    if (!file) {
+        LOG_ERROR(std::string("Failed to open file '").append(location).append("' for writing"));
+        return false;
+    }
+
+    file << "Member,Seed,StartCondition,Atoms,Iterations,KineticEnergy\n";
+    for (size_t m = 0; m < ensemble.getMemberCount(); m++) {
+        const SimulationHandler& member = ensemble.getMember(m);
+        file << m << ',' << member.getSeed() << ',' << member.startCondition << ',' << member.getActualAtomCount() << ','
+             << ensemble.getProgress(m) << ',' << getMotionStats(member.getAtoms()).kineticEnergy << '\n';
+    }
+    return (bool) file;
+}
+
+/**
+ * Run options.members copies of the config, seeded consecutively, on one
+ * Ensemble, reporting progress every second.
+ * @returns Exit code of the program.
+ */
+static int runEnsemble(const HeadlessOptions& options) {
+    SimulationHandler config;
+    if (!loadFromFile(options.configFile, config)) {
+        std::fprintf(stderr, "Failed to load config '%s'\n", options.configFile.c_str());
+        return -1;
+    }
+    uint64_t seed = options.hasSeed ? options.seed : config.getSeed();
+
+    Ensemble ensemble(options.threads);
+    ensemble.setMemberCount(options.members);
+    for (size_t m = 0; m < ensemble.getMemberCount(); m++) {
+        SimulationHandler& member = ensemble.getMember(m);
+        member.copyConfiguration(config);
+        member.setSeed(seed + m);
+        member.initSimulation();
+    }
+
+    std::printf(
+        "Running %u iterations of %u members of %zu atoms on %zu threads\n",
+        options.iterations, options.members, config.getAtomCount(), ensemble.getThreadCount()
+    );
+    size_t totalIterations = (size_t) options.iterations * options.members;
+    std::atomic<bool> finished(false);
+    auto start = std::chrono::steady_clock::now();
+    std::thread runner([&ensemble, &finished, &options]() {
+        ensemble.run(options.iterations);
+        finished = true;
+    });
+    auto lastReport = start;
+    bool reported = false;
+    while (!finished) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastReport < std::chrono::seconds(1))
+            continue;
+        lastReport = now;
+        reported = true;
+        size_t completeMembers = 0;
+        for (size_t m = 0; m < ensemble.getMemberCount(); m++)
+            completeMembers += ensemble.getProgress(m) == options.iterations ? 1 : 0;
+        std::printf("\r%zu/%zu iterations (%zu/%u members complete)", ensemble.getTotalProgress(), totalIterations, completeMembers, options.members);
+        std::fflush(stdout);
+    }
+    runner.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%sFinished in %.3fs (%.1f member iterations/s)\n", reported ? "\n" : "", seconds, seconds > 0.0 ? totalIterations / seconds : 0.0);
+
+    if (!writeEnsemble(options.outputPrefix + "_ensemble.csv", ensemble)) {
+        std::fprintf(stderr, "Failed to write output file '%s_ensemble.csv'\n", options.outputPrefix.c_str());
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char* args[]) {
+    HeadlessOptions options;
+    if (!parseArguments(argc, args, options)) {
+        printUsage(args[0]);
+        return -1;
+    }
+    if (!Logger::getLogger().isValid())
+        return -1;
+    LOG_MESSAGE("Begin headless execution");
+    if (options.members > 0) {
+        int result = runEnsemble(options);
+        LOG_MESSAGE("End headless execution");
+        return result;
+    }
+
+    SimulationHandler handler;
+    handler.setThreadCount(options.threads);
+    if (!options.resumeFile.empty()) {
+        if (!loadCheckpoint(options.resumeFile, handler)) {
+            std::fprintf(stderr, "Failed to load checkpoint '%s'\n", options.resumeFile.c_str());
+            LOG_MESSAGE("End headless execution");
+            return -1;
+        }
+    } else {
+        if (!loadFromFile(options.configFile, handler)) {
+            std::fprintf(stderr, "Failed to load config '%s'\n", options.configFile.c_str());
+            LOG_MESSAGE("End headless execution");
+            return -1;
+        }
+        if (options.hasSeed)
+            handler.setSeed(options.seed);
+        handler.initSimulation();
+    }
+
+    std::printf(
+        "Running %u iterations of %zu atoms on %zu threads (%s)\n",
+        options.iterations, handler.getActualAtomCount(), handler.getThreadCount(),
+        getInstructionSetName(handler.getInstructionSet())
+    );
+    TrajectoryWriter trajectory;
+    if (!options.trajectoryFile.empty()) {
+        if (!trajectory.open(options.trajectoryFile, handler, options.trajectoryInterval, options.trajectoryVelocities)) {
+            std::fprintf(stderr, "Failed to create trajectory '%s'\n", options.trajectoryFile.c_str());
+            LOG_MESSAGE("End headless execution");
+            return -1;
+        }
+        trajectory.record(handler, 0);
+    }
+
+    bool trajectoryFailed = false;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < options.iterations; i++) {
+        handler.iterateSimulation();
+        if (trajectory.isOpen() && trajectory.isFrameDue(i + 1) && !trajectory.record(handler, i + 1)) {
+            std::fprintf(stderr, "Failed to write trajectory '%s', stopped recording at iteration %u\n",
+                         options.trajectoryFile.c_str(), i + 1);
+            trajectory.close();
+            trajectoryFailed = true;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("Finished in %.3fs (%.1f iterations/s)\n", seconds, seconds > 0.0 ? options.iterations / seconds : 0.0);
+
+    bool success = writeAtoms(options.outputPrefix + "_atoms.csv", handler)
+                && writeStats(options.outputPrefix + "_stats.json", handler, options, seconds);
+    if (!success)
+        std::fprintf(stderr, "Failed to write output files '%s_*'\n", options.outputPrefix.c_str());
+    if (trajectoryFailed) {
+        success = false;
+    } else if (trajectory.isOpen() && !trajectory.close()) {
+        std::fprintf(stderr, "Failed to write trajectory '%s'\n", options.trajectoryFile.c_str());
+        success = false;
+    }
+    if (!options.checkpointFile.empty() && !saveCheckpoint(options.checkpointFile, handler)) {
+        std::fprintf(stderr, "Failed to write checkpoint '%s'\n", options.checkpointFile.c_str());
+        success = false;
+    }
+
+    LOG_MESSAGE("End headless execution");
+    return success ? 0 : -1;
+}
@@ -7,7 +7,7 @@
 int main([[maybe_unused]] int argc, [[maybe_unused]] char* args[]) {
     if (!Logger::getLogger().isValid())
         return -1;
-    Logger::getLogger().logMessage("Begin execution");
+    LOG_MESSAGE("Begin execution");
     {
         WindowHandler windowHandler;
         windowHandler.setSize(800, 600);
@@ -15,12 +15,12 @@ int main([[maybe_unused]] int argc, [[maybe_unused]] char* args[]) {
         if (windowHandler.init()) {
             windowHandler.mainloop();
         } else {
-            Logger::getLogger().logError("Failed to initialize window handler");
-            Logger::getLogger().logMessage("End execution");
+            LOG_ERROR("Failed to initialize window handler");
+            LOG_MESSAGE("End execution");
             return -1;
         }
     }
-    Logger::getLogger().logMessage("End execution");
+    LOG_MESSAGE("End execution");
 
     return 0;
 }
@@ -0,0 +1,49 @@
+/**
+ * @file   AlignedAllocator.h
+ * @brief  Allocator for cache line aligned containers.
+ *
+ * @author Stuart Lewis
+ * @date   January 2023
+ */
+#pragma once
+#include <cstddef>
+#include <new>
+#include <vector>
+
+/** Alignment of AlignedVector storage, matching a cache line (and an AVX-512 register). */
+const size_t CACHE_LINE_SIZE = 64;
+
+/**
+ * Standard allocator returning storage aligned to Alignment bytes, so
+ * containers can be streamed through SIMD registers without straddling cache
+ * lines.
+ */
+template<typename T, size_t Alignment = CACHE_LINE_SIZE>
+class AlignedAllocator {
+public:
+    typedef T value_type;
+
+    template<typename U>
+    struct rebind {
+        typedef AlignedAllocator<U, Alignment> other;
+    };
+
+    AlignedAllocator() noexcept = default;
+    template<typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept {}
+
+    [[nodiscard]] T* allocate(size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+    }
+    void deallocate(T* p, size_t) noexcept {
+        ::operator delete(p, std::align_val_t(Alignment));
+    }
+
+    template<typename U>
+    inline bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept { return true; }
+    template<typename U>
+    inline bool operator!=(const AlignedAllocator<U, Alignment>&) const noexcept { return false; }
+};
+
+template<typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
@@ -0,0 +1,69 @@
+#include "AtomArrays.h"
+
+#include <algorithm>
+#include <cmath>
+
+size_t growCapacity(size_t capacity, size_t required, size_t minimum) {
+    if (required <= capacity)
+        return capacity;
+    capacity = std::max(capacity, minimum);
+    while (capacity < required)
+        capacity *= 2;
+    return capacity;
+}
+
+Atom AtomArrays::get(size_t i) const {
+    Atom atom(atomType[i]);
+    atom.x  = x[i];
+    atom.y  = y[i];
+    atom.vx = vx[i];
+    atom.vy = vy[i];
+    atom.fx = fx[i];
+    atom.fy = fy[i];
+    return atom;
+}
+
+void AtomArrays::set(size_t i, const Atom& atom) {
+    x[i]  = atom.x;
+    y[i]  = atom.y;
+    vx[i] = atom.vx;
+    vy[i] = atom.vy;
+    fx[i] = atom.fx;
+    fy[i] = atom.fy;
+    atomType[i] = atom.atomType;
+}
+
+void AtomArrays::resize(size_t count) {
+    size_t newCapacity = growCapacity(capacity(), count, MIN_ATOM_CAPACITY);
+    if (newCapacity != capacity()) {
+        x.reserve(newCapacity);
+        y.reserve(newCapacity);
+        vx.reserve(newCapacity);
+        vy.reserve(newCapacity);
+        fx.reserve(newCapacity);
+        fy.reserve(newCapacity);
+        atomType.reserve(newCapacity);
+    }
+    x.resize(count);
+    y.resize(count);
+    vx.resize(count);
+    vy.resize(count);
+    fx.resize(count);
+    fy.resize(count);
+    atomType.resize(count);
+}
+
+MotionStats getMotionStats(const AtomsView& atoms) {
+    MotionStats stats{ 0.0, 0.0, 0.0 };
+    const AtomArrays& arrays = atoms.getArrays();
+    for (size_t i = 0; i < atoms.size(); i++) {
+        double speed2 = (double) arrays.vx[i] * arrays.vx[i] + (double) arrays.vy[i] * arrays.vy[i];
+        double speed = std::sqrt(speed2);
+        stats.kineticEnergy += 0.5 * speed2;
+        stats.meanSpeed += speed;
+        stats.maxSpeed = std::max(stats.maxSpeed, speed);
+    }
+    if (atoms.size() > 0)
+        stats.meanSpeed /= (double) atoms.size();
+    return stats;
+}
@@ -0,0 +1,82 @@
+/**
+ * @file   AtomArrays.h
+ * @brief  Structure-of-arrays storage for Atoms.
+ *
+ * @author Stuart Lewis
+ * @date   January 2023
+ */
+#pragma once
+#include "AlignedAllocator.h"
+#include "SimulationStructures.h"
+
+#include <cstddef>
+
+/** Minimum number of Atoms storage is allocated for once it is first used. */
+const size_t MIN_ATOM_CAPACITY = 256;
+
+/**
+ * Grow policy for runtime sized simulation storage.
+ * @returns capacity doubled until it is at least required (and at least
+ * minimum), or capacity if it is already large enough.
+ */
+size_t growCapacity(size_t capacity, size_t required, size_t minimum);
+
+/**
+ * Structure-of-arrays storage for Atoms (see Atom). Each component is kept in
+ * its own cache aligned array so it can be streamed through SIMD registers.
+ */
+struct AtomArrays {
+    AlignedVector<float> x;
+    AlignedVector<float> y;
+    AlignedVector<float> vx;
+    AlignedVector<float> vy;
+    AlignedVector<float> fx;
+    AlignedVector<float> fy;
+    AlignedVector<atom_type_id> atomType;
+
+    /** @returns A copy of the Atom at index i. */
+    [[nodiscard]] Atom get(size_t i) const;
+    /** Overwrite every component of the Atom at index i. */
+    void set(size_t i, const Atom& atom);
+
+    /**
+     * Resize every component to hold count Atoms. Capacity grows geometrically
+     * (see growCapacity) and is never released, so repeatedly regenerating a
+     * simulation of similar size does not reallocate.
+     */
+    void resize(size_t count);
+    [[nodiscard]] inline size_t size() const { return x.size(); }
+    [[nodiscard]] inline size_t capacity() const { return x.capacity(); }
+};
+
+/**
+ * Read-only adapter presenting AtomArrays as an array of Atoms.
+ */
+class AtomsView {
+public:
+    AtomsView(const AtomArrays& atoms, size_t count) : mAtoms(atoms), mCount(count) {}
+
+    [[nodiscard]] inline Atom operator[](size_t i) const { return mAtoms.get(i); }
+    [[nodiscard]] inline size_t size() const { return mCount; }
+    /** @returns The underlying arrays, of which only the first size() Atoms are valid. */
+    [[nodiscard]] inline const AtomArrays& getArrays() const { return mAtoms; }
+private:
+    const AtomArrays& mAtoms;
+    size_t mCount;
+};
+
+/**
+ * Summary of how fast a set of Atoms is moving, shared by the headless
+ * executables' reports.
+ */
+struct MotionStats {
+    /** Total kinetic energy, taking every Atom to have unit mass. */
+    double kineticEnergy;
+    double meanSpeed;
+    double maxSpeed;
+};
+
+/**
+ * @returns The MotionStats of atoms, accumulated in double precision.
+ */
+[[nodiscard]] MotionStats getMotionStats(const AtomsView& atoms);
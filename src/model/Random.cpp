@@ -0,0 +1,38 @@
+#include "Random.h"
+
+#include <random>
+
+Random::Random(uint64_t seed) :
+mSeed(seed), mState{} {
+    setSeed(seed);
+}
+
+void Random::setSeed(uint64_t seed) {
+    mSeed = seed;
+    // splitmix64, so similar seeds still give unrelated (and never all zero) states
+    uint64_t x = seed;
+    for (uint64_t& state : mState) {
+        uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        state = z ^ (z >> 31);
+    }
+}
+
+uint64_t Random::nextInteger(uint64_t min, uint64_t max) {
+    uint64_t count = max - min + 1;
+    if (count == 0)
+        return next();
+    // Reject the lowest 2^64 % count draws, so every value is equally likely
+    uint64_t threshold = (0 - count) % count;
+    uint64_t x;
+    do {
+        x = next();
+    } while (x < threshold);
+    return min + x % count;
+}
+
+uint64_t Random::randomSeed() {
+    std::random_device rd;
+    return ((uint64_t) rd() << 32) ^ (uint64_t) rd();
+}
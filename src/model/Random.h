@@ -0,0 +1,69 @@
+/**
+ * @file   Random.h
+ * @brief  Seedable pseudo-random number generator.
+ *
+ * @author Stuart Lewis
+ * @date   January 2023
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * xoshiro256** generator (see https://prng.di.unimi.it/), seeded through
+ * splitmix64. Cheap to seed and to draw from, and unlike the standard library
+ * distributions the values drawn are the same on every platform, so a seed
+ * always reproduces the same run.
+ */
+class Random {
+public:
+    explicit Random(uint64_t seed = 0);
+
+    /**
+     * Restart the sequence from seed.
+     */
+    void setSeed(uint64_t seed);
+    /** @returns Seed the current sequence was started from. */
+    [[nodiscard]] inline uint64_t getSeed() const { return mSeed; }
+
+    /** @returns Next 64 random bits. */
+    inline uint64_t next() {
+        uint64_t result = rotl(mState[1] * 5, 7) * 9;
+        uint64_t t = mState[1] << 17;
+        mState[2] ^= mState[0];
+        mState[3] ^= mState[1];
+        mState[1] ^= mState[2];
+        mState[0] ^= mState[3];
+        mState[2] ^= t;
+        mState[3] = rotl(mState[3], 45);
+        return result;
+    }
+
+    /** @returns Uniformly distributed value in [min, max). */
+    inline float nextFloat(float min, float max) {
+        float unit = (float) (next() >> 40) * (1.0f / 16777216.0f);
+        return min + unit * (max - min);
+    }
+
+    /** @returns Uniformly distributed index in [0, count), for count below 2^32. */
+    inline size_t nextIndex(size_t count) {
+        return (size_t) (((next() >> 32) * (uint64_t) count) >> 32);
+    }
+
+    /**
+     * @returns Uniformly distributed integer in [min, max], for any 64-bit
+     * range (unlike Random::nextIndex).
+     */
+    uint64_t nextInteger(uint64_t min, uint64_t max);
+
+    /**
+     * @returns Non-deterministic seed (see std::random_device), for runs which
+     * don't need to be reproduced.
+     */
+    static uint64_t randomSeed();
+private:
+    static inline uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+    uint64_t mSeed;
+    uint64_t mState[4];
+};
@@ -0,0 +1,33 @@
+/**
+ * @file   SimulationSnapshot.h
+ * @brief  Copy of the parts of a simulation needed to draw it.
+ *
+ * @author Stuart Lewis
+ * @date   January 2023
+ */
+#pragma once
+#include "AlignedAllocator.h"
+#include "SimulationStructures.h"
+
+#include "../../glm/vec3.hpp"
+
+#include <vector>
+
+/**
+ * Copy of the state of a simulation at the end of an iteration, so it can be
+ * drawn while the simulation carries on iterating (see SimulationThread).
+ */
+struct SimulationSnapshot {
+    float width = 0.0f;
+    float height = 0.0f;
+    float atomDiameter = 0.0f;
+
+    /** Colour of each AtomType, indexed by id. */
+    std::vector<glm::vec3> atomTypeColors;
+
+    AlignedVector<float> x;
+    AlignedVector<float> y;
+    AlignedVector<atom_type_id> atomType;
+
+    [[nodiscard]] inline size_t size() const { return x.size(); }
+};
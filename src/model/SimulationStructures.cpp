@@ -2,38 +2,25 @@
 
 #include <algorithm>
 #include <cmath>
-#include <random>
 #ifndef ITERATE_ON_COMPUTE_SHADER
 #include <memory>
 #endif
 
 static unsigned int idCounter = 0;
 
-AtomType::AtomType() :
+AtomType::AtomType(Random& random) :
     id(idCounter++), r(0.0f), g(0.0f), b(0.0f), friendlyName(std::to_string(id)), quantity(200) {
-    std::random_device rd;
-    std::mt19937 mt(rd());
-    std::uniform_real_distribution<float> rangeH(0.0f, 360.0f);
-    std::uniform_real_distribution<float> rangeS(1.0f, 1.0f);
-    std::uniform_real_distribution<float> rangeL(0.5f, 0.5f);
-
-    glm::vec3 color = hslToColor(rangeH(mt), rangeS(mt), rangeL(mt));
+    glm::vec3 color = hslToColor(random.nextFloat(0.0f, 360.0f), 1.0f, 0.5f);
     r = color.r;
     g = color.g;
     b = color.b;
 }
 
-AtomType::AtomType(atom_type_id id_) :
+AtomType::AtomType(atom_type_id id_, Random& random) :
 id(id_), r(0.0f), g(0.0f), b(0.0f), friendlyName(std::to_string(id)), quantity(200) {
     idCounter = std::max(idCounter, id + 1);
 
-    std::random_device rd;
-    std::mt19937 mt(rd());
-    std::uniform_real_distribution<float> rangeH(0.0f, 360.0f);
-    std::uniform_real_distribution<float> rangeS(1.0f, 1.0f);
-    std::uniform_real_distribution<float> rangeL(0.5f, 0.5f);
-
-    glm::vec3 color = hslToColor(rangeH(mt), rangeS(mt), rangeL(mt));
+    glm::vec3 color = hslToColor(random.nextFloat(0.0f, 360.0f), 1.0f, 0.5f);
     r = color.r;
     g = color.g;
     b = color.b;
@@ -6,6 +6,8 @@
  * @date   January 2023
  */
 #pragma once
+#include "Random.h"
+
 #include "../../glm/vec3.hpp"
 
 #include <string>
@@ -22,13 +24,15 @@ struct AtomType {
     /**
      * Construct and auto-assign a unique id. Colour is generated randomly with
      * high saturation.
+     * @param random Generator to draw the colour from.
      */
-    AtomType();
+    explicit AtomType(Random& random);
     /**
      * Construct with pre-defined unique id. Colour is generated randomly with
      * high saturation
+     * @param random Generator to draw the colour from.
      */
-    explicit AtomType(atom_type_id id);
+    AtomType(atom_type_id id, Random& random);
     atom_type_id id;
 
     float r;
@@ -0,0 +1,93 @@
+#include "SpatialGrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+SpatialGrid::SpatialGrid() :
+mCellsX(1), mCellsY(1), mCellScaleX(0.0f), mCellScaleY(0.0f), mTypeCount(1),
+mRunStart(2, 0), mCellAtoms(), mAtomCells(), mRunScratch() {
+}
+
+void SpatialGrid::build(float width, float height, float cellSize, const float* x, const float* y, size_t count,
+                        const atom_type_id* types, size_t typeCount) {
+    size_t cellsX;
+    size_t cellsY;
+    getGridSize(width, height, cellSize, count, cellsX, cellsY);
+
+    mCellsX = cellsX;
+    mCellsY = cellsY;
+    mCellScaleX = (float) cellsX / width;
+    mCellScaleY = (float) cellsY / height;
+    mTypeCount = (types != nullptr) ? std::max(typeCount, (size_t) 1) : 1;
+
+    size_t runCount = cellsX * cellsY * mTypeCount;
+    mRunStart.assign(runCount + 1, 0);
+    mCellAtoms.resize(count);
+    mAtomCells.resize(count);
+
+    for (size_t i = 0; i < count; i++) {
+        // Positions are wrapped by integration, but can still be outside the
+        // bounds after they shrink. The min only guards against the scaling
+        // rounding up to the cell count just below the upper bound
+        size_t cx = std::min((size_t) (wrapPosition(x[i], width ) * mCellScaleX), cellsX - 1);
+        size_t cy = std::min((size_t) (wrapPosition(y[i], height) * mCellScaleY), cellsY - 1);
+        unsigned int cell = cy * cellsX + cx;
+        mAtomCells[i] = cell;
+        mRunStart[cell * mTypeCount + (types != nullptr ? types[i] : 0) + 1]++;
+    }
+    for (size_t r = 0; r < runCount; r++)
+        mRunStart[r + 1] += mRunStart[r];
+
+    std::vector<unsigned int>& offsets = mRunScratch;
+    offsets.assign(mRunStart.begin(), mRunStart.end() - 1);
+    for (size_t i = 0; i < count; i++)
+        mCellAtoms[offsets[mAtomCells[i] * mTypeCount + (types != nullptr ? types[i] : 0)]++] = i;
+}
+
+void SpatialGrid::getGridSize(float width, float height, float cellSize, size_t count, size_t& cellsX, size_t& cellsY) {
+    cellsX = std::max((size_t) (width  / cellSize), (size_t) 1);
+    cellsY = std::max((size_t) (height / cellSize), (size_t) 1);
+
+    // Cap the cell count so that tiny ranges in huge spaces don't allocate
+    // millions of empty cells
+    size_t maxCells = std::max(count * 2, (size_t) 9);
+    if (cellsX * cellsY > maxCells) {
+        float scale = std::sqrt((float) maxCells / (float) (cellsX * cellsY));
+        cellsX = std::max((size_t) (cellsX * scale), (size_t) 1);
+        cellsY = std::max((size_t) (cellsY * scale), (size_t) 1);
+    }
+}
+
+size_t SpatialGrid::getNeighbourCells(size_t cell, std::array<size_t, 9>& neighbours) const {
+    std::array<size_t, 3> columns{};
+    std::array<size_t, 3> rows{};
+    size_t columnCount = neighbourLines(cell % mCellsX, mCellsX, columns);
+    size_t rowCount    = neighbourLines(cell / mCellsX, mCellsY, rows);
+
+    size_t count = 0;
+    for (size_t r = 0; r < rowCount; r++)
+        for (size_t c = 0; c < columnCount; c++)
+            neighbours[count++] = rows[r] * mCellsX + columns[c];
+    return count;
+}
+
+bool SpatialGrid::isWrappingCell(size_t cell) const {
+    // Cells are at most a quarter of an axis at least 4 cells long, and
+    // neighbouring atoms are less than 2 cells apart
+    size_t column = cell % mCellsX;
+    size_t row = cell / mCellsX;
+    return mCellsX < 4 || mCellsY < 4
+        || column == 0 || column == mCellsX - 1 || row == 0 || row == mCellsY - 1;
+}
+
+size_t SpatialGrid::neighbourLines(size_t c, size_t n, std::array<size_t, 3>& out) {
+    if (n < 3) {
+        for (size_t i = 0; i < n; i++)
+            out[i] = i;
+        return n;
+    }
+    out[0] = (c + n - 1) % n;
+    out[1] = c;
+    out[2] = (c + 1) % n;
+    return 3;
+}
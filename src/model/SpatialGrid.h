@@ -0,0 +1,135 @@
+/**
+ * @file   SpatialGrid.h
+ * @brief  Uniform bin grid for finding neighbouring Atoms in a wrapped space.
+ *
+ * @author Stuart Lewis
+ * @date   January 2023
+ */
+#pragma once
+#include "SimulationStructures.h"
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @returns position wrapped into [0, size), however many times over it is.
+ */
+inline float wrapPosition(float position, float size) {
+    position -= size * std::floor(position / size);
+    // Positions just below 0 can round up to exactly size
+    return (position < size) ? position : 0.0f;
+}
+
+/**
+ * Uniform grid of cells (at least one interaction range wide) which Atoms are
+ * binned into, so each Atom only has to be compared against the Atoms in its
+ * own and its 8 surrounding cells. The grid wraps around at the edges, matching
+ * the toroidal space of the simulation.
+ */
+class SpatialGrid {
+public:
+    SpatialGrid();
+
+    /**
+     * Bin atoms into the grid. Cells are sized to be no smaller than
+     * cellSize in either axis, and the total cell count is capped relative to
+     * the number of atoms to keep sparse simulations cheap.
+     * @param width Width of the simulation space.
+     * @param height Height of the simulation space.
+     * @param cellSize Minimum size of each cell (the interaction range).
+     * @param x X positions of the atoms to bin.
+     * @param y Y positions of the atoms to bin.
+     * @param count Number of atoms to bin.
+     * @param types If not nullptr, the atom type of each atom, so that the
+     * atoms of each cell are also grouped into runs by type (see
+     * SpatialGrid::getRunStarts).
+     * @param typeCount Number of atom types in types. Every cell stores a run
+     * offset per type, so this should be small relative to the atoms per cell.
+     */
+    void build(float width, float height, float cellSize, const float* x, const float* y, size_t count,
+               const atom_type_id* types = nullptr, size_t typeCount = 1);
+
+    /**
+     * Find the dimensions of the grid build would use (also used to size the
+     * grid binned on the GPU).
+     * @param width Width of the simulation space.
+     * @param height Height of the simulation space.
+     * @param cellSize Minimum size of each cell (the interaction range).
+     * @param count Number of atoms to bin.
+     * @param cellsX Number of cells along the x axis.
+     * @param cellsY Number of cells along the y axis.
+     */
+    static void getGridSize(float width, float height, float cellSize, size_t count, size_t& cellsX, size_t& cellsY);
+
+    /**
+     * Find the (unique) cells neighbouring a cell, including itself. Fewer
+     * than 9 cells are returned if the grid is less than 3 cells wide/high.
+     * @param cell Index of the cell to find the neighbours of.
+     * @param neighbours Array to populate with the neighbouring cell indices.
+     * @returns Number of neighbouring cells written to neighbours.
+     */
+    size_t getNeighbourCells(size_t cell, std::array<size_t, 9>& neighbours) const;
+
+    /** @returns Index of the cell the atom at atomIndex was binned into. */
+    [[nodiscard]] inline size_t getAtomCell(size_t atomIndex) const { return mAtomCells[atomIndex]; }
+
+    /**
+     * Binned slots are the atom indices ordered by cell (then by type, if
+     * binned with types), so all atoms in the same cell occupy a contiguous
+     * range of slots. The sort is stable, so atoms in the same cell and run
+     * stay in index order.
+     * @returns Index of the atom in binned slot.
+     */
+    [[nodiscard]] inline unsigned int getBinnedAtom(size_t slot) const { return mCellAtoms[slot]; }
+    /** @returns First binned slot of cell. */
+    [[nodiscard]] inline size_t getCellStart(size_t cell) const { return mRunStart[cell * mTypeCount]; }
+    /** @returns One past the last binned slot of cell. */
+    [[nodiscard]] inline size_t getCellEnd(size_t cell) const { return mRunStart[(cell + 1) * mTypeCount]; }
+    /**
+     * Only meaningful if binned with types, when the run of each type in cell
+     * is [runStarts[type], runStarts[type + 1]).
+     * @returns First binned slot of each type run in cell, followed by the end
+     * of the last.
+     */
+    [[nodiscard]] inline const unsigned int* getRunStarts(size_t cell) const { return mRunStart.data() + cell * mTypeCount; }
+
+    /**
+     * @returns false if every atom in cell and its neighbouring cells is less
+     * than half the simulation away from every other along both axes, so the
+     * shortest delta between them never wraps around an edge (true for cells
+     * on the edges, and for every cell of grids under 4 cells across).
+     */
+    [[nodiscard]] bool isWrappingCell(size_t cell) const;
+
+    [[nodiscard]] inline size_t getCellsX() const { return mCellsX; }
+    [[nodiscard]] inline size_t getCellsY() const { return mCellsY; }
+    [[nodiscard]] inline size_t getCellCount() const { return mCellsX * mCellsY; }
+private:
+    /**
+     * Find the (unique) neighbouring rows/columns of c along an axis with n
+     * cells, including c itself.
+     * @returns Number of rows/columns written to out.
+     */
+    static size_t neighbourLines(size_t c, size_t n, std::array<size_t, 3>& out);
+
+    size_t mCellsX;
+    size_t mCellsY;
+    float mCellScaleX;
+    float mCellScaleY;
+    /** Number of runs per cell (1 if binned without types). */
+    size_t mTypeCount;
+
+    /**
+     * Offset into mCellAtoms of the first atom of each run, indexed by
+     * cell * mTypeCount + type (plus one past the end).
+     */
+    std::vector<unsigned int> mRunStart;
+    /** Atom indices, ordered by cell. */
+    std::vector<unsigned int> mCellAtoms;
+    /** Cell index of each atom. */
+    std::vector<unsigned int> mAtomCells;
+    /** Per-run write offsets used while binning. */
+    std::vector<unsigned int> mRunScratch;
+};
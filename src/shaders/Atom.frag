@@ -7,7 +7,7 @@ struct AtomType {
 };
 
 layout(std430, binding = 1) buffer AtomTypeBuffer {
-	AtomType atomTypes[50];
+	AtomType atomTypes[];
 };
 
 struct Atom {
@@ -16,7 +16,7 @@ struct Atom {
 };
 
 layout(std430, binding = 2) buffer AtomBuffer {
-	Atom atoms[10000];
+	Atom atoms[];
 };
 
 in Vector {
@@ -0,0 +1,488 @@
+#include "../control/Ensemble.h"
+#include "../control/SaveAndLoad.h"
+#include "../control/SimulationHandler.h"
+#include "../model/Random.h"
+#include "../view/Logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+const char* START_CONDITION_NAMES[StartConditionMax] = { "Random", "Equidistant", "RandomEquidistant", "Rings" };
+
+/** Number of cells along each axis of the grid used to measure occupancy (see getRunMetrics). */
+const size_t OCCUPANCY_CELLS = 32;
+
+/**
+ * SimulationHandler setter a sweep parameter is applied through.
+ */
+enum SweepTarget {
+    SweepTargetDt,
+    SweepTargetDrag,
+    SweepTargetInteractionRange,
+    SweepTargetCollisionForce,
+    SweepTargetAtomDiameter,
+    SweepTargetWidth,
+    SweepTargetHeight,
+    SweepTargetStartCondition,
+    SweepTargetSeed,
+    SweepTargetQuantity,    /** Quantity of atom type a. */
+    SweepTargetInteraction, /** Interaction of atom type a with atom type b. */
+    SweepTargetMax
+};
+
+const char* SWEEP_TARGET_NAMES[SweepTargetMax] = {
+    "dt", "drag", "range", "collision", "diameter", "width", "height", "start", "seed", "quantity", "interaction"
+};
+
+/**
+ * Value of a swept parameter. Integer targets (see isIntegerTarget) use
+ * integer, so seeds keep all 64 bits, and the rest use real.
+ */
+struct SweepValue {
+    double real = 0.0;
+    uint64_t integer = 0;
+};
+
+/**
+ * Values of one swept parameter, either a fixed list (from a list or a grid)
+ * or a uniform random range sampled separately for every run.
+ */
+struct SweepParameter {
+    std::string name; /** Name as given on the command line, used as its column heading. */
+    SweepTarget target;
+    atom_type_id a = 0;
+    atom_type_id b = 0;
+    std::vector<SweepValue> values;
+    bool random = false;
+    SweepValue min;
+    SweepValue max;
+};
+
+/**
+ * Command line options for a parameter sweep.
+ */
+struct SweepOptions {
+    std::string configFile = "resources/current.csdat";
+    std::string outputPrefix = "sweep";
+    std::vector<SweepParameter> parameters;
+    unsigned int iterations = 1000;
+    unsigned int threads = std::thread::hardware_concurrency();
+    /** Runs of every combination of listed values, each with the next seed and new random samples. */
+    unsigned int repeats = 1;
+    /** Runs configured and iterated at once (0 for a multiple of the thread count). */
+    unsigned int batchSize = 0;
+    /** First seed of the runs, and seed of the random samples, in place of the seed in the config (if hasSeed). */
+    uint64_t seed = 0;
+    bool hasSeed = false;
+    /** Shuffle the interactions of every run from its seed, before any interaction parameters are applied. */
+    bool shuffleInteractions = false;
+};
+
+/**
+ * Summary of the final state of a run.
+ */
+struct RunMetrics {
+    size_t atoms;
+    MotionStats motion;
+    double occupancy; /** Fraction of occupancy grid cells containing an atom (lower is more clustered). */
+};
+
+static void printUsage(const char* executable) {
+    std::printf(
+        "Usage: %s [config.csdat] -p <name>=<values> [-p ...] [options]\n"
+        "Runs every combination of the listed parameter values, starting from the config.\n"
+        "  -p <name>=<values>  Parameter to sweep. Names are dt, drag, range, collision, diameter,\n"
+        "                      width, height, start, seed, quantity:<type> and interaction:<type>:<type>.\n"
+        "                      Values are a comma separated list (start also accepts Random,\n"
+        "                      Equidistant, RandomEquidistant and Rings), <min>:<max>:<count> for count\n"
+        "                      evenly spaced values, or random:<min>:<max> to sample each run uniformly\n"
+        "  -i                  Shuffle the interactions of every run from its seed\n"
+        "  -r <repeats>        Runs of every combination, seeded consecutively (default: 1)\n"
+        "  -n <iterations>     Number of iterations of each run (default: 1000)\n"
+        "  -t <threads>        Number of threads to run on (default: all cores)\n"
+        "  -b <runs>           Runs configured and iterated at once (default: 8 per thread)\n"
+        "  -s <seed>           Seed of the first run and the random samples (default: the seed in the config)\n"
+        "  -o <prefix>         Prefix of the output file (default: sweep)\n"
+        "Writes the parameters and final summary of every run to <prefix>.csv.\n",
+        executable
+    );
+}
+
+/**
+ * Split s at every occurrence of separator.
+ */
+static std::vector<std::string> split(const std::string& s, char separator) {
+    std::vector<std::string> items;
+    std::stringstream stream(s);
+    std::string item;
+    while (std::getline(stream, item, separator))
+        items.push_back(item);
+    return items;
+}
+
+static bool isIntegerTarget(SweepTarget target) {
+    return target == SweepTargetStartCondition || target == SweepTargetSeed || target == SweepTargetQuantity;
+}
+
+/**
+ * @returns Largest value an integer target can be set to.
+ */
+static uint64_t getIntegerTargetMax(SweepTarget target) {
+    switch (target) {
+        case SweepTargetStartCondition: return StartConditionMax - 1;
+        case SweepTargetQuantity:       return std::numeric_limits<unsigned int>::max();
+        default:                        return std::numeric_limits<uint64_t>::max();
+    }
+}
+
+/**
+ * @returns false if s is not a valid value of target, otherwise true.
+ */
+static bool parseValue(const std::string& s, SweepTarget target, SweepValue& value) {
+    if (target == SweepTargetStartCondition) {
+        for (int sc = 0; sc < StartConditionMax; sc++) {
+            if (s == START_CONDITION_NAMES[sc]) {
+                value.integer = sc;
+                return true;
+            }
+        }
+    }
+    if (isIntegerTarget(target))
+        return parseUint(s, value.integer) && value.integer <= getIntegerTargetMax(target);
+    float f;
+    if (!parseFloat(s, f))
+        return false;
+    value.real = f;
+    return true;
+}
+
+/**
+ * Parse a -p argument of the form name=values.
+ * @returns false if the argument is invalid, otherwise true.
+ */
+static bool parseParameter(const std::string& arg, SweepParameter& parameter) {
+    size_t equals = arg.find('=');
+    if (equals == std::string::npos)
+        return false;
+    parameter.name = arg.substr(0, equals);
+    std::vector<std::string> name = split(parameter.name, ':');
+    if (name.empty())
+        return false;
+
+    parameter.target = SweepTargetMax;
+    for (int t = 0; t < SweepTargetMax; t++)
+        if (name[0] == SWEEP_TARGET_NAMES[t])
+            parameter.target = (SweepTarget) t;
+    size_t typeCount = parameter.target == SweepTargetInteraction ? 2 : parameter.target == SweepTargetQuantity ? 1 : 0;
+    if (parameter.target == SweepTargetMax || name.size() != typeCount + 1)
+        return false;
+    unsigned int a = 0, b = 0;
+    if ((typeCount > 0 && !parseUint(name[1], a)) || (typeCount > 1 && !parseUint(name[2], b)))
+        return false;
+    parameter.a = (atom_type_id) a;
+    parameter.b = (atom_type_id) b;
+
+    std::string values = arg.substr(equals + 1);
+    std::vector<std::string> range = split(values, ':');
+    if (range.size() == 3 && range[0] == "random") {
+        parameter.random = true;
+        return parseValue(range[1], parameter.target, parameter.min)
+            && parseValue(range[2], parameter.target, parameter.max)
+            && (isIntegerTarget(parameter.target) ? parameter.min.integer <= parameter.max.integer
+                                                  : parameter.min.real <= parameter.max.real);
+    }
+    if (range.size() == 3) {
+        SweepValue min, max;
+        unsigned int count;
+        if (!parseValue(range[0], parameter.target, min) || !parseValue(range[1], parameter.target, max)
+            || !parseUint(range[2], count) || count == 0)
+            return false;
+        bool integer = isIntegerTarget(parameter.target);
+        for (unsigned int i = 0; i < count; i++) {
+            SweepValue value = min;
+            if (count > 1 && integer) {
+                // Split the span so the rounded steps never overflow 64 bits
+                uint64_t steps = count - 1;
+                uint64_t span = max.integer >= min.integer ? max.integer - min.integer : min.integer - max.integer;
+                uint64_t offset = span / steps * i + (span % steps * i + steps / 2) / steps;
+                value.integer = max.integer >= min.integer ? min.integer + offset : min.integer - offset;
+            } else if (count > 1) {
+                value.real += (max.real - min.real) * i / (count - 1);
+            }
+            parameter.values.push_back(value);
+        }
+        return true;
+    }
+    if (range.size() != 1)
+        return false;
+    for (const std::string& item : split(values, ',')) {
+        SweepValue value;
+        if (!parseValue(item, parameter.target, value))
+            return false;
+        parameter.values.push_back(value);
+    }
+    return !parameter.values.empty();
+}
+
+/**
+ * Parse command line arguments into options.
+ * @returns false if the arguments are invalid, otherwise true.
+ */
+static bool parseArguments(int argc, char* args[], SweepOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = args[i];
+        if (arg == "-h" || arg == "--help") {
+            return false;
+        } else if (arg == "-i") {
+            options.shuffleInteractions = true;
+        } else if (arg == "-p" || arg == "-r" || arg == "-n" || arg == "-t" || arg == "-b" || arg == "-s" || arg == "-o") {
+            if (i + 1 >= argc) {
+                std::fprintf(stderr, "Missing value for '%s'\n", arg.c_str());
+                return false;
+            }
+            std::string value = args[++i];
+            bool valid = true;
+            if (arg == "-p") {
+                options.parameters.emplace_back();
+                valid = parseParameter(value, options.parameters.back());
+            } else if (arg == "-o") {
+                options.outputPrefix = value;
+            } else if (arg == "-s") {
+                valid = parseUint(value, options.seed);
+                options.hasSeed = true;
+            } else {
+                unsigned int& target = arg == "-r" ? options.repeats : arg == "-n" ? options.iterations
+                                     : arg == "-t" ? options.threads : options.batchSize;
+                valid = parseUint(value, target) && (arg == "-b" || target > 0);
+            }
+            if (!valid) {
+                std::fprintf(stderr, "Invalid value '%s' for '%s'\n", value.c_str(), arg.c_str());
+                return false;
+            }
+        } else if (!arg.empty() && arg[0] == '-') {
+            std::fprintf(stderr, "Unknown option '%s'\n", arg.c_str());
+            return false;
+        } else {
+            options.configFile = arg;
+        }
+    }
+    if (options.parameters.empty() && options.repeats == 1 && !options.shuffleInteractions) {
+        std::fprintf(stderr, "Nothing to sweep, pass at least one '-p' (or '-r', '-i')\n");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @returns Number of runs in the sweep (every combination of the listed
+ * values, repeated).
+ */
+static size_t getRunCount(const SweepOptions& options) {
+    size_t runs = options.repeats;
+    for (const SweepParameter& parameter : options.parameters)
+        if (!parameter.random)
+            runs *= parameter.values.size();
+    return runs;
+}
+
+/**
+ * Fill values with the value of every parameter for run, sampling random
+ * parameters from random. Runs are ordered by combination (the last listed
+ * parameter changing fastest), then by repeat.
+ */
+static void getRunValues(const SweepOptions& options, size_t run, Random& random, std::vector<SweepValue>& values) {
+    size_t combination = run / options.repeats;
+    values.resize(options.parameters.size());
+    for (size_t p = options.parameters.size(); p-- > 0;) {
+        const SweepParameter& parameter = options.parameters[p];
+        if (parameter.random)
+            continue;
+        values[p] = parameter.values[combination % parameter.values.size()];
+        combination /= parameter.values.size();
+    }
+    // Sampled in parameter order after the listed values, so a sweep always
+    // draws the same samples regardless of the batch size or thread count
+    for (size_t p = 0; p < options.parameters.size(); p++) {
+        const SweepParameter& parameter = options.parameters[p];
+        if (!parameter.random)
+            continue;
+        if (isIntegerTarget(parameter.target))
+            values[p].integer = random.nextInteger(parameter.min.integer, parameter.max.integer);
+        else
+            values[p].real = random.nextFloat((float) parameter.min.real, (float) parameter.max.real);
+    }
+}
+
+static void applyParameter(SimulationHandler& handler, const SweepParameter& parameter, const SweepValue& value) {
+    switch (parameter.target) {
+        case SweepTargetDt:               handler.setDt((float) value.real);                                     break;
+        case SweepTargetDrag:             handler.setDrag((float) value.real);                                   break;
+        case SweepTargetInteractionRange: handler.setInteractionRange((float) value.real);                       break;
+        case SweepTargetCollisionForce:   handler.setCollisionForce((float) value.real);                         break;
+        case SweepTargetAtomDiameter:     handler.setAtomDiameter((float) value.real);                           break;
+        case SweepTargetWidth:            handler.setBounds((float) value.real, handler.getHeight());            break;
+        case SweepTargetHeight:           handler.setBounds(handler.getWidth(), (float) value.real);             break;
+        case SweepTargetStartCondition:   handler.startCondition = (StartCondition) value.integer;               break;
+        case SweepTargetQuantity:         handler.setAtomTypeQuantity(parameter.a, (unsigned int) value.integer); break;
+        case SweepTargetInteraction:      handler.setInteraction(parameter.a, parameter.b, (float) value.real);  break;
+        default: break;
+    }
+}
+
+/**
+ * Reset member to the base config, then apply the seed and parameter values
+ * of a run and generate its atoms. Reuses the member's existing allocations.
+ */
+static void configureRun(SimulationHandler& member, const SimulationHandler& base, const SweepOptions& options,
+                         uint64_t firstSeed, size_t run, const std::vector<SweepValue>& values) {
+    member.copyConfiguration(base);
+    uint64_t seed = firstSeed + run % options.repeats;
+    for (size_t p = 0; p < options.parameters.size(); p++)
+        if (options.parameters[p].target == SweepTargetSeed)
+            seed = values[p].integer + run % options.repeats;
+    member.setSeed(seed);
+    if (options.shuffleInteractions)
+        member.shuffleAtomInteractions();
+    for (size_t p = 0; p < options.parameters.size(); p++)
+        applyParameter(member, options.parameters[p], values[p]);
+    member.initSimulation();
+}
+
+/**
+ * @param occupied Scratch space for the occupancy grid, reused between runs.
+ */
+static RunMetrics getRunMetrics(const SimulationHandler& handler, std::vector<unsigned char>& occupied) {
+    AtomsView atoms = handler.getAtoms();
+    RunMetrics metrics{ handler.getActualAtomCount(), getMotionStats(atoms), 0.0 };
+    occupied.assign(OCCUPANCY_CELLS * OCCUPANCY_CELLS, 0);
+    float cellWidth  = handler.getWidth()  / OCCUPANCY_CELLS;
+    float cellHeight = handler.getHeight() / OCCUPANCY_CELLS;
+    size_t occupiedCount = 0;
+    for (size_t i = 0; i < atoms.size(); i++) {
+        Atom atom = atoms[i];
+        size_t cx = std::min((size_t) std::max(atom.x / cellWidth , 0.0f), OCCUPANCY_CELLS - 1);
+        size_t cy = std::min((size_t) std::max(atom.y / cellHeight, 0.0f), OCCUPANCY_CELLS - 1);
+        unsigned char& cell = occupied[cy * OCCUPANCY_CELLS + cx];
+        occupiedCount += cell ? 0 : 1;
+        cell = 1;
+    }
+    metrics.occupancy = (double) occupiedCount / (double) occupied.size();
+    return metrics;
+}
+
+static void writeHeader(std::ofstream& file, const SweepOptions& options) {
+    file << "Run";
+    for (const SweepParameter& parameter : options.parameters)
+        if (parameter.target != SweepTargetSeed)
+            file << ',' << parameter.name;
+    file << ",Seed,Atoms,KineticEnergy,MeanSpeed,MaxSpeed,Occupancy\n";
+}
+
+static void writeRow(std::ofstream& file, const SweepOptions& options, size_t run, const std::vector<SweepValue>& values,
+                     const SimulationHandler& member, const RunMetrics& metrics) {
+    file << run;
+    for (size_t p = 0; p < options.parameters.size(); p++) {
+        const SweepParameter& parameter = options.parameters[p];
+        if (parameter.target == SweepTargetStartCondition)
+            file << ',' << START_CONDITION_NAMES[values[p].integer];
+        else if (parameter.target == SweepTargetQuantity)
+            file << ',' << values[p].integer;
+        else if (parameter.target != SweepTargetSeed)
+            file << ',' << values[p].real;
+    }
+    file << ',' << member.getSeed() << ',' << metrics.atoms << ',' << metrics.motion.kineticEnergy << ','
+         << metrics.motion.meanSpeed << ',' << metrics.motion.maxSpeed << ',' << metrics.occupancy << '\n';
+}
+
+/**
+ * Run every combination of the sweep in batches on one Ensemble, so each
+ * batch reuses the members (and allocations) of the last.
+ * @returns Exit code of the program.
+ */
+static int runSweep(const SweepOptions& options) {
+    SimulationHandler base;
+    if (!loadFromFile(options.configFile, base)) {
+        std::fprintf(stderr, "Failed to load config '%s'\n", options.configFile.c_str());
+        return -1;
+    }
+    for (const SweepParameter& parameter : options.parameters) {
+        if (std::max(parameter.a, parameter.b) >= base.getAtomTypeCount()) {
+            std::fprintf(stderr, "Parameter '%s' refers to an atom type not in the config (%zu types)\n",
+                         parameter.name.c_str(), base.getAtomTypeCount());
+            return -1;
+        }
+    }
+    uint64_t firstSeed = options.hasSeed ? options.seed : base.getSeed();
+
+    std::string location = options.outputPrefix + ".csv";
+    std::ofstream file(location);
+    if (!file) {
+        LOG_ERROR(std::string("Failed to open file '").append(location).append("' for writing"));
+        std::fprintf(stderr, "Failed to write output file '%s'\n", location.c_str());
+        return -1;
+    }
+    writeHeader(file, options);
+
+    Ensemble ensemble(options.threads);
+    size_t runCount = getRunCount(options);
+    size_t batchSize = options.batchSize > 0 ? options.batchSize : ensemble.getThreadCount() * 8;
+    std::printf(
+        "Sweeping %zu runs of %u iterations on %zu threads, %zu runs at a time\n",
+        runCount, options.iterations, ensemble.getThreadCount(), batchSize
+    );
+
+    Random sampler(firstSeed);
+    std::vector<std::vector<SweepValue>> batchValues(std::min(batchSize, runCount));
+    std::vector<unsigned char> occupied;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t first = 0; first < runCount; first += batchSize) {
+        size_t count = std::min(batchSize, runCount - first);
+        ensemble.setMemberCount(count);
+        for (size_t m = 0; m < count; m++) {
+            getRunValues(options, first + m, sampler, batchValues[m]);
+            configureRun(ensemble.getMember(m), base, options, firstSeed, first + m, batchValues[m]);
+        }
+
+        ensemble.run(options.iterations);
+
+        for (size_t m = 0; m < count; m++) {
+            const SimulationHandler& member = ensemble.getMember(m);
+            writeRow(file, options, first + m, batchValues[m], member, getRunMetrics(member, occupied));
+        }
+        file.flush();
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::printf("\r%zu/%zu runs (%.1f runs/s)", first + count, runCount, seconds > 0.0 ? (first + count) / seconds : 0.0);
+        std::fflush(stdout);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("\nFinished in %.3fs\n", seconds);
+
+    if (!file) {
+        std::fprintf(stderr, "Failed to write output file '%s'\n", location.c_str());
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char* args[]) {
+    SweepOptions options;
+    if (!parseArguments(argc, args, options)) {
+        printUsage(args[0]);
+        return -1;
+    }
+    if (!Logger::getLogger().isValid())
+        return -1;
+    LOG_MESSAGE("Begin sweep execution");
+    int result = runSweep(options);
+    LOG_MESSAGE("End sweep execution");
+    return result;
+}
@@ -0,0 +1,99 @@
+#include "AtomSprites.h"
+
+#include <algorithm>
+#include <cmath>
+
+/** Samples per axis averaged for each sprite pixel. */
+const int SPRITE_SUPERSAMPLING = 4;
+
+std::vector<uint32_t> generateAtomSprite(float radius, int& size) {
+    float extent = getAtomSpriteExtent(radius);
+    size = std::clamp((int) std::ceil(extent * 2.0f), 4, ATOM_SPRITE_MAX_SIZE);
+    float pixelsPerTexel = extent * 2.0f / (float) size;
+    float fillRadius = radius - ATOM_OUTLINE_WIDTH * 0.5f;
+    float outlineRadius = radius + ATOM_OUTLINE_WIDTH * 0.5f;
+
+    std::vector<uint32_t> pixels((size_t) size * size);
+    for (int py = 0; py < size; py++) {
+        for (int px = 0; px < size; px++) {
+            // Accumulate premultiplied so translucent samples do not darken opaque ones
+            float grey = 0.0f, alpha = 0.0f;
+            for (int sy = 0; sy < SPRITE_SUPERSAMPLING; sy++) {
+                for (int sx = 0; sx < SPRITE_SUPERSAMPLING; sx++) {
+                    float x = (px + (sx + 0.5f) / SPRITE_SUPERSAMPLING) * pixelsPerTexel - extent;
+                    float y = (py + (sy + 0.5f) / SPRITE_SUPERSAMPLING) * pixelsPerTexel - extent;
+                    float distance = std::sqrt(x * x + y * y);
+                    if (distance <= fillRadius) {
+                        grey += 1.0f;
+                        alpha += 1.0f;
+                    } else if (distance <= radius) {
+                        // Half transparent black over the fill
+                        grey += 0.5f;
+                        alpha += 1.0f;
+                    } else if (distance <= outlineRadius) {
+                        // Half transparent black over the background
+                        alpha += 0.5f;
+                    }
+                }
+            }
+            grey = alpha > 0.0f ? grey / alpha : 0.0f;
+            alpha /= SPRITE_SUPERSAMPLING * SPRITE_SUPERSAMPLING;
+            auto g = (unsigned int) std::lround(grey * 255.0f);
+            auto a = (unsigned int) std::lround(alpha * 255.0f);
+            pixels[(size_t) py * size + px] = IM_COL32(g, g, g, a);
+        }
+    }
+    return pixels;
+}
+
+void packAtomTypeColors(const SimulationSnapshot& snapshot, std::vector<ImU32>& colors) {
+    colors.resize(snapshot.atomTypeColors.size());
+    for (size_t at = 0; at < colors.size(); at++) {
+        glm::vec3 c = snapshot.atomTypeColors[at];
+        colors[at] = ImGui::ColorConvertFloat4ToU32(ImVec4(c.r, c.g, c.b, 1.0f));
+    }
+}
+
+void addAtomSprites(ImDrawList* drawList, const SimulationSnapshot& snapshot, const std::vector<ImU32>& colors,
+                    ImTextureID sprite, ImVec2 origin, ImVec2 scale, float radius) {
+    size_t count = snapshot.size();
+    float extent = getAtomSpriteExtent(radius);
+    const float* xs = snapshot.x.data();
+    const float* ys = snapshot.y.data();
+    const atom_type_id* types = snapshot.atomType.data();
+
+    drawList->PushTextureID(sprite);
+    // 16-bit indices can only address 65536 vertices from each vertex offset
+    size_t batchSize = sizeof(ImDrawIdx) == 2 ? (1 << 16) / 4 : std::max(count, (size_t) 1);
+    for (size_t start = 0; start < count; start += batchSize) {
+        size_t end = std::min(count, start + batchSize);
+        drawList->PrimReserve((int) (end - start) * 6, (int) (end - start) * 4);
+        for (size_t i = start; i < end; i++) {
+            ImU32 col = colors[types[i]];
+            float x = origin.x + xs[i] * scale.x;
+            float y = origin.y + ys[i] * scale.y;
+
+            auto idx = (ImDrawIdx) drawList->_VtxCurrentIdx;
+            drawList->PrimWriteIdx(idx);
+            drawList->PrimWriteIdx((ImDrawIdx) (idx + 1));
+            drawList->PrimWriteIdx((ImDrawIdx) (idx + 2));
+            drawList->PrimWriteIdx(idx);
+            drawList->PrimWriteIdx((ImDrawIdx) (idx + 2));
+            drawList->PrimWriteIdx((ImDrawIdx) (idx + 3));
+            drawList->PrimWriteVtx(ImVec2(x - extent, y - extent), ImVec2(0.0f, 0.0f), col);
+            drawList->PrimWriteVtx(ImVec2(x + extent, y - extent), ImVec2(1.0f, 0.0f), col);
+            drawList->PrimWriteVtx(ImVec2(x + extent, y + extent), ImVec2(1.0f, 1.0f), col);
+            drawList->PrimWriteVtx(ImVec2(x - extent, y + extent), ImVec2(0.0f, 1.0f), col);
+        }
+    }
+    drawList->PopTextureID();
+}
+
+void addAtomCircles(ImDrawList* drawList, const SimulationSnapshot& snapshot, const std::vector<ImU32>& colors,
+                    ImVec2 origin, ImVec2 scale, float radius) {
+    for (size_t i = 0; i < snapshot.size(); i++) {
+        ImVec2 centre(origin.x + snapshot.x[i] * scale.x, origin.y + snapshot.y[i] * scale.y);
+        drawList->AddCircleFilled(centre, radius, colors[snapshot.atomType[i]]);
+        drawList->AddCircle(centre, radius, ImColor(ImVec4(0.0f, 0.0f, 0.0f, 0.5f)), 0, ATOM_OUTLINE_WIDTH);
+    }
+}
@@ -0,0 +1,61 @@
+/**
+ * @file   AtomSprites.h
+ * @brief  Batched drawing of the atoms of a SimulationSnapshot to an ImGui draw list.
+ *
+ * @author Stuart Lewis
+ * @date   January 2023
+ */
+#pragma once
+#include "../model/SimulationSnapshot.h"
+
+#include "../../imgui/imgui.h"
+
+#include <cstdint>
+#include <vector>
+
+/** Largest side length in pixels of an atom sprite (see generateAtomSprite). */
+const int ATOM_SPRITE_MAX_SIZE = 256;
+/** Width in pixels of the dark outline around each atom, centred on its edge. */
+const float ATOM_OUTLINE_WIDTH = 2.0f;
+
+/**
+ * @returns Half the side length in pixels of the quad drawn for an atom of
+ * the given radius, covering its outline plus a transparent pixel for
+ * filtering.
+ */
+[[nodiscard]] inline float getAtomSpriteExtent(float radius) { return radius + ATOM_OUTLINE_WIDTH * 0.5f + 1.0f; }
+
+/**
+ * Generate the sprite drawn for each atom of the given radius: a white disc,
+ * half darkened inside its edge and translucent black outside it, so that
+ * tinting it with an atom type's colour gives the same circle and outline as
+ * addAtomCircles.
+ * @param size Set to the side length of the sprite in pixels.
+ * @returns RGBA pixels of the sprite, row by row (see IM_COL32).
+ */
+std::vector<uint32_t> generateAtomSprite(float radius, int& size);
+
+/**
+ * Convert the colour of each atom type in snapshot to ImGui's packed format.
+ */
+void packAtomTypeColors(const SimulationSnapshot& snapshot, std::vector<ImU32>& colors);
+
+/**
+ * Append a quad textured with sprite for every atom in snapshot. Every quad
+ * is written into one vertex/index reservation under the same texture, so
+ * (with 32-bit ImDrawIdx) the atoms are issued as a single draw command.
+ * @param colors Colour of each atom type (see packAtomTypeColors).
+ * @param origin Position in the window of the top left of the simulation.
+ * @param scale Pixels per unit of simulation space.
+ * @param radius Radius of each atom in pixels, which sprite was generated for.
+ */
+void addAtomSprites(ImDrawList* drawList, const SimulationSnapshot& snapshot, const std::vector<ImU32>& colors,
+                    ImTextureID sprite, ImVec2 origin, ImVec2 scale, float radius);
+
+/**
+ * Append a filled and an outlined circle for every atom in snapshot,
+ * tessellated by ImGui. Produces many times the vertices of addAtomSprites,
+ * so is only used if the sprite could not be created.
+ */
+void addAtomCircles(ImDrawList* drawList, const SimulationSnapshot& snapshot, const std::vector<ImU32>& colors,
+                    ImVec2 origin, ImVec2 scale, float radius);
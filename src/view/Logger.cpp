@@ -1,49 +1,33 @@
 #include "Logger.h"
 
-#include <algorithm>
 #include <chrono>
-#include <cstdio>
 #include <ctime>
 #include <iomanip>
 
-Logger::Logger() {
-	mStream.open(LOG_FILENAME);
-	if (!mStream)
+Logger::Logger() :
+mEntries(new Entry[LOG_QUEUE_CAPACITY]), mEnqueuePosition(0), mDequeuePosition(0), mDropped(0) {
+	for (size_t i = 0; i < LOG_QUEUE_CAPACITY; i++)
+		mEntries[i].sequence.store(i, std::memory_order_relaxed);
+
+	mLogStream.open(LOG_FILENAME);
+	if (!mLogStream)
 		return;
-	mStream.close();
-	mStream.open(ERROR_FILENAME);
-	if (!mStream)
+	mErrorStream.open(ERROR_FILENAME);
+	if (!mErrorStream)
 		return;
-	mStream.close();
 	mIsValid = true;
+	mFlushThread = std::thread(&Logger::flushLoop, this);
 }
 
-Logger::~Logger() = default;
-
-void Logger::logMessage(const std::string& message) {
-	std::string msg = std::string(message).append("\n");
-	log("LOG", LOG_FILENAME, msg);
-	log("LOG", ERROR_FILENAME, msg);
-}
-
-void Logger::logWarning(const std::string& message) {
-	std::string msg = std::string(message).append("\n");
-	log("WARN", LOG_FILENAME, msg);
-	log("WARN", ERROR_FILENAME, msg);
-}
-
-void Logger::logError(const std::string& message) {
-	std::string msg = std::string(message).append("\n");
-	log("ERROR", ERROR_FILENAME, msg);
-}
-
-void Logger::logCode(const std::string& code) {
-	size_t pos = -1;
-	int counter = 1;
-	std::string formattedCode = std::string(code);
-	while ((pos = formattedCode.find("\n", pos + 1)) != std::string::npos)
-		formattedCode.replace(pos, 1, "\n {" + std::to_string(++counter) + "} ");
-	log("", LOG_FILENAME, std::string(" {1} ").append(code).append("\n"));
+Logger::~Logger() {
+	if (!mFlushThread.joinable())
+		return;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStopping = true;
+	}
+	mWake.notify_one();
+	mFlushThread.join();
 }
 
 Logger& Logger::getLogger() {
@@ -51,16 +35,93 @@ Logger& Logger::getLogger() {
 	return logger;
 }
 
-void Logger::log(const std::string& code, const std::string& file, const std::string& message) {
-	mStream.open(file, std::ios_base::app);
-	if (!mStream)
+void Logger::push(const char* code, unsigned int files, const std::string& message) {
+	if (!mIsValid)
 		return;
 
-	if (code == "") {
-		mStream << message;
-	} else {
+	size_t position = mEnqueuePosition.load(std::memory_order_relaxed);
+	Entry* entry;
+	while (true) {
+		entry = &mEntries[position & (LOG_QUEUE_CAPACITY - 1)];
+		size_t sequence = entry->sequence.load(std::memory_order_acquire);
+		if (sequence == position) {
+			if (mEnqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				break;
+		} else if (sequence < position) {
+			// Still holds the entry from the last lap, so the queue is full
+			mDropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		} else {
+			position = mEnqueuePosition.load(std::memory_order_relaxed);
+		}
+	}
+
+	entry->code = code;
+	entry->files = files;
+	entry->time = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+	// Reuses the capacity left by earlier laps, so steady logging does not allocate
+	entry->message.assign(message);
+	entry->sequence.store(position + 1, std::memory_order_release);
+	// The flush thread may miss this if it is just about to sleep, but never sleeps longer than LOG_FLUSH_INTERVAL
+	mWake.notify_one();
+}
+
+void Logger::drain() {
+	bool written = false;
+	while (true) {
+		Entry& entry = mEntries[mDequeuePosition & (LOG_QUEUE_CAPACITY - 1)];
+		if (entry.sequence.load(std::memory_order_acquire) != mDequeuePosition + 1)
+			break;
+		if (entry.files & LOG_FILE)
+			write(mLogStream, entry.code, entry.time, entry.message);
+		if (entry.files & ERROR_FILE)
+			write(mErrorStream, entry.code, entry.time, entry.message);
+		entry.sequence.store(mDequeuePosition + LOG_QUEUE_CAPACITY, std::memory_order_release);
+		mDequeuePosition++;
+		written = true;
+	}
+
+	size_t dropped = mDropped.exchange(0, std::memory_order_relaxed);
+	if (dropped > 0) {
+		std::string message = "Dropped " + std::to_string(dropped) + " log entries (log queue full)";
 		auto time = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-		mStream << "[" << code << "] (" << std::put_time(std::localtime(&time), "%Y-%m-%d %H:%M:%S") << ") | " << message;
+		write(mLogStream, "WARN", time, message);
+		write(mErrorStream, "WARN", time, message);
+		written = true;
+	}
+
+	if (written) {
+		mLogStream.flush();
+		mErrorStream.flush();
+	}
+}
+
+void Logger::write(std::ofstream& stream, const char* code, std::time_t time, const std::string& message) {
+	if (*code == '\0') {
+		// Number each line of code snippets
+		int line = 1;
+		stream << " {" << line << "} ";
+		for (char c : message) {
+			stream << c;
+			if (c == '\n')
+				stream << " {" << ++line << "} ";
+		}
+		stream << '\n';
+	} else {
+		stream << "[" << code << "] (" << std::put_time(std::localtime(&time), "%Y-%m-%d %H:%M:%S") << ") | " << message << '\n';
+	}
+}
+
+void Logger::flushLoop() {
+	std::unique_lock<std::mutex> lock(mMutex);
+	while (!mStopping) {
+		lock.unlock();
+		drain();
+		lock.lock();
+		if (!mStopping)
+			mWake.wait_for(lock, LOG_FLUSH_INTERVAL);
 	}
-	mStream.close();
+	lock.unlock();
+	// Anything logged before the logger started stopping
+	drain();
 }
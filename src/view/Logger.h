@@ -6,12 +6,53 @@
  * @date   January 2023
  */
 #pragma once
-#include <filesystem>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <ctime>
 #include <fstream>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+
+/** Severity of a log entry, in increasing order. */
+enum LogLevel {
+	LogLevelMessage, /** Trace messages and code snippets. */
+	LogLevelWarning,
+	LogLevelError
+};
+
+#ifndef LOG_LEVEL
+/**
+ * Lowest LogLevel which is logged. Logging calls below it compile to nothing
+ * (set with the CLUSTERS_LOG_LEVEL CMake option).
+ */
+#define LOG_LEVEL 0
+#endif
+
+/**
+ * Log through Logger::getLogger at each LogLevel. Unlike calling the Logger
+ * directly, the message is not even built when its level is compiled out.
+ */
+#define LOG_MESSAGE(...) do { if constexpr (LogLevelMessage >= LOG_LEVEL) Logger::getLogger().logMessage(__VA_ARGS__); } while (false)
+#define LOG_WARNING(...) do { if constexpr (LogLevelWarning >= LOG_LEVEL) Logger::getLogger().logWarning(__VA_ARGS__); } while (false)
+#define LOG_ERROR(...)   do { if constexpr (LogLevelError   >= LOG_LEVEL) Logger::getLogger().logError(__VA_ARGS__);   } while (false)
+#define LOG_CODE(...)    do { if constexpr (LogLevelMessage >= LOG_LEVEL) Logger::getLogger().logCode(__VA_ARGS__);    } while (false)
+
+/** Entries which can be waiting to be written before new entries are dropped (a power of 2). */
+const size_t LOG_QUEUE_CAPACITY = 4096;
+/** Longest an entry waits to be written if its wake-up is missed by the flush thread. */
+const std::chrono::milliseconds LOG_FLUSH_INTERVAL(100);
 
 /**
  * Logging class for logging debug information to a file.
+ *
+ * Logging only copies the entry into a fixed size lock-free queue, which a
+ * background thread drains into files which are kept open, so logging never
+ * waits on the filesystem. If the queue is full, entries are dropped (and the
+ * number dropped is logged once there is room) rather than blocking.
  */
 class Logger {
 public:
@@ -20,19 +61,31 @@ public:
 	/**
 	 * Log trace messages
 	 */
-	void logMessage(const std::string& message);
+	inline void logMessage(const std::string& message) {
+		if constexpr (LogLevelMessage >= LOG_LEVEL)
+			push("LOG", LOG_FILE | ERROR_FILE, message);
+	}
 	/**
 	 * Log warning messages
 	 */
-	void logWarning(const std::string& message);
+	inline void logWarning(const std::string& message) {
+		if constexpr (LogLevelWarning >= LOG_LEVEL)
+			push("WARN", LOG_FILE | ERROR_FILE, message);
+	}
 	/**
 	 * Log error messages
 	 */
-	void logError(const std::string& message);
+	inline void logError(const std::string& message) {
+		if constexpr (LogLevelError >= LOG_LEVEL)
+			push("ERROR", ERROR_FILE, message);
+	}
 	/**
 	 * Log multiline code snippets.
 	 */
-	void logCode(const std::string& code);
+	inline void logCode(const std::string& code) {
+		if constexpr (LogLevelMessage >= LOG_LEVEL)
+			push("", LOG_FILE, code);
+	}
 
 	/**
 	 * @returns false if either of the log or error files cannot be opened,
@@ -50,9 +103,52 @@ private:
 	 */
 	Logger();
 
-	void log(const std::string& code, const std::string& file, const std::string& message);
+	/** Files an entry is written to, combined as bit flags. */
+	static const unsigned int LOG_FILE = 1;
+	static const unsigned int ERROR_FILE = 2;
+
+	/**
+	 * Queue an entry to be written by the flush thread, or drop it if the
+	 * queue is full. Safe to call from any number of threads at once.
+	 * @param code Label of the entry, or empty to write the message as a code
+	 * snippet without a label or timestamp.
+	 */
+	void push(const char* code, unsigned int files, const std::string& message);
+	/**
+	 * Write every entry which has finished being queued, then flush the files.
+	 */
+	void drain();
+	void write(std::ofstream& stream, const char* code, std::time_t time, const std::string& message);
+	void flushLoop();
+
+	/**
+	 * Slot of the queue. Each slot is claimed by a producer when sequence
+	 * equals the queue position being claimed, handed to the flush thread by
+	 * setting it to one past that position, and handed back for the next lap
+	 * by setting it to the position plus the capacity.
+	 */
+	struct Entry {
+		std::atomic<size_t> sequence;
+		const char* code;
+		unsigned int files;
+		std::time_t time;
+		std::string message;
+	};
+	std::unique_ptr<Entry[]> mEntries;
+	/** Next position to be claimed by a producer. */
+	std::atomic<size_t> mEnqueuePosition;
+	/** Next position to be written (only used by the flush thread). */
+	size_t mDequeuePosition;
+	/** Entries dropped since the last were reported. */
+	std::atomic<size_t> mDropped;
+
+	std::ofstream mLogStream;
+	std::ofstream mErrorStream;
 
-	std::ofstream mStream;
+	std::thread mFlushThread;
+	std::mutex mMutex;
+	std::condition_variable mWake;
+	bool mStopping = false;
 
 	bool mIsValid = false;
 
@@ -1,14 +1,13 @@
 #include "SimulationRenderer.h"
 
+#include "AtomSprites.h"
 #include "Logger.h"
 
 #include "../../glm/vec3.hpp"
 
 #include "../../imgui/imgui.h"
 
-#ifdef ITERATE_ON_COMPUTE_SHADER
 #include "glad/glad.h"
-#endif
 
 const char* SHADER_CODE_VERT =
 #include "../shaders/Atom.vert"
@@ -21,16 +20,21 @@ SimulationRenderer::SimulationRenderer(SimulationHandler& handler) :
 mHandler(handler)
 #ifdef ITERATE_ON_COMPUTE_SHADER
 , mShader(SHADER_CODE_VERT, SHADER_CODE_FRAG), mFrameBuffer(0), mTexture(0), mQuad(nullptr)
+#else
+, mSprite(0), mSpriteRadius(0.0f), mAtomTypeColors()
 #endif
 {
-    Logger::getLogger().logMessage("Constructing Renderer");
+    LOG_MESSAGE("Constructing Renderer");
 }
 
 SimulationRenderer::~SimulationRenderer() {
-    Logger::getLogger().logMessage("Destroying Renderer");
+    LOG_MESSAGE("Destroying Renderer");
 #ifdef ITERATE_ON_COMPUTE_SHADER
     if (mQuad != nullptr)
         delete mQuad;
+#else
+    if (mSprite != 0)
+        glDeleteTextures(1, &mSprite);
 #endif
 }
 
@@ -42,7 +46,7 @@ void SimulationRenderer::updateParameters() {
 }
 
 bool SimulationRenderer::init() { // NOLINT(readability-convert-member-functions-to-static)
-    Logger::getLogger().logMessage("Initializing Renderer");
+    LOG_MESSAGE("Initializing Renderer");
 #ifdef ITERATE_ON_COMPUTE_SHADER
     mQuad = Mesh::generateQuad();
 
@@ -61,7 +65,7 @@ bool SimulationRenderer::init() { // NOLINT(readability-convert-member-functions
 #ifdef _DEBUG
     GLenum status = glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER);
     if (status != GL_FRAMEBUFFER_COMPLETE) {
-        Logger::getLogger().logError(std::string("OpenGL Framebuffer error - Status: ").append(std::to_string(status)));
+        LOG_ERROR(std::string("OpenGL Framebuffer error - Status: ").append(std::to_string(status)));
         return false;
     }
 #endif
@@ -71,15 +75,20 @@ bool SimulationRenderer::init() { // NOLINT(readability-convert-member-functions
 
     mShader.init();
     if (!mShader.isValid()) {
-        Logger::getLogger().logError(std::string("Failed to initialize shader"));
+        LOG_ERROR(std::string("Failed to initialize shader"));
         return false;
     }
+#else
+    // The sprite itself is generated once the atom radius is known (see SimulationRenderer::updateSprite)
+    glGenTextures(1, &mSprite);
+    if (mSprite == 0)
+        LOG_WARNING(std::string("Failed to create atom sprite, falling back to drawing circles"));
 #endif
     return true;
 }
 
-void SimulationRenderer::drawSimulation([[maybe_unused]] float startX, [[maybe_unused]] float startY, float width, float height) {
 #ifdef ITERATE_ON_COMPUTE_SHADER
+void SimulationRenderer::drawSimulation([[maybe_unused]] float startX, [[maybe_unused]] float startY, float width, float height) {
     mShader.bind();
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -102,7 +111,9 @@ void SimulationRenderer::drawSimulation([[maybe_unused]] float startX, [[maybe_u
     mShader.unbind();
 
     ImGui::Image((ImTextureID) (uintptr_t) mTexture, ImVec2(width, height));
+}
 #else
+void SimulationRenderer::drawSimulation(const SimulationSnapshot& snapshot, float startX, float startY, float width, float height) {
     ImDrawList* drawList = ImGui::GetWindowDrawList();
     ImVec2 clipMin = ImVec2(startX, startY);
     ImVec2 clipMax = ImVec2(clipMin.x + width, clipMin.y + height);
@@ -113,27 +124,33 @@ void SimulationRenderer::drawSimulation([[maybe_unused]] float startX, [[maybe_u
     );
 
     ImGui::PushClipRect(clipMin, clipMax, true);
-    float scaleX = static_cast<float>(width) / mHandler.getWidth();
-    float scaleY = static_cast<float>(height) / mHandler.getHeight();
-    float atomSize = std::max(mHandler.getAtomDiameter() * scaleX, 3.0f);
-
-    auto& atoms = mHandler.getAtoms();
-    for (int i = 0; i < mHandler.getActualAtomCount(); i++) {
-        const Atom& atom = atoms[i];
-        glm::vec3 c = mHandler.getAtomTypeColor(atom.atomType);
-        float x = clipMin.x + atom.x * scaleX;
-        float y = clipMin.y + atom.y * scaleY;
-        drawList->AddCircleFilled(
-            ImVec2(x, y), atomSize,
-            ImColor(ImVec4(c.r, c.g, c.b, 1.0f))
-        );
-        drawList->AddCircle(
-            ImVec2(x, y), atomSize,
-            ImColor(ImVec4(0.0f, 0.0f, 0.0f, 0.5f)),
-            0, 2.0f
-        );
+    ImVec2 scale(width / snapshot.width, height / snapshot.height);
+    float atomSize = std::max(snapshot.atomDiameter * scale.x, 3.0f);
+
+    packAtomTypeColors(snapshot, mAtomTypeColors);
+    if (mSprite != 0) {
+        updateSprite(atomSize);
+        addAtomSprites(drawList, snapshot, mAtomTypeColors, (ImTextureID) (uintptr_t) mSprite, clipMin, scale, atomSize);
+    } else {
+        addAtomCircles(drawList, snapshot, mAtomTypeColors, clipMin, scale, atomSize);
     }
 
     ImGui::PopClipRect();
-#endif
 }
+
+void SimulationRenderer::updateSprite(float radius) {
+    if (radius == mSpriteRadius)
+        return;
+    mSpriteRadius = radius;
+
+    int size;
+    std::vector<uint32_t> pixels = generateAtomSprite(radius, size);
+    glBindTexture(GL_TEXTURE_2D, mSprite);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+#endif
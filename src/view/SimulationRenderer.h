@@ -10,6 +10,12 @@
 #include "../control/SimulationHandler.h"
 #ifdef ITERATE_ON_COMPUTE_SHADER
 #include "../model/Mesh.h"
+#else
+#include "../model/SimulationSnapshot.h"
+
+#include "../../imgui/imgui.h"
+
+#include <vector>
 #endif
 
 /**
@@ -29,6 +35,7 @@ public:
      */
     bool init();
 
+#ifdef ITERATE_ON_COMPUTE_SHADER
     /**
      * Draw the simulation to an ImGui image.
      * @param startX Position of the left side of the image in ImGui.
@@ -36,7 +43,19 @@ public:
      * @param width Width of the image in the window.
      * @param height Height of the image in the window.
      */
-    void drawSimulation([[maybe_unused]] float startX, [[maybe_unused]] float startY, float width, float height);
+    void drawSimulation(float startX, float startY, float width, float height);
+#else
+    /**
+     * Draw a snapshot of the simulation to the current ImGui window, as one
+     * batch of sprites (see addAtomSprites).
+     * @param snapshot Snapshot of the simulation to draw.
+     * @param startX Position of the left side of the image in ImGui.
+     * @param startY Position of the top of the image in ImGui.
+     * @param width Width of the image in the window.
+     * @param height Height of the image in the window.
+     */
+    void drawSimulation(const SimulationSnapshot& snapshot, float startX, float startY, float width, float height);
+#endif
 private:
     SimulationHandler& mHandler;
 #ifdef ITERATE_ON_COMPUTE_SHADER
@@ -51,5 +70,17 @@ private:
     const std::string SCREEN_BOUNDS_UNIFORM = "screenBounds";
     const std::string SIMULATION_BOUNDS_UNIFORM = "simulationBounds";
     const std::string ATOM_DIAMETER_UNIFORM = "atomDiameter";
+#else
+    /**
+     * Regenerate the atom sprite if the atoms are drawn at a different
+     * radius to last time, so its outline stays the same width in pixels.
+     */
+    void updateSprite(float radius);
+
+    /** Atom sprite texture, or 0 if it could not be created. */
+    GLuint mSprite;
+    /** Radius in pixels the atom sprite was generated for. */
+    float mSpriteRadius;
+    std::vector<ImU32> mAtomTypeColors;
 #endif
 };
@@ -2,6 +2,8 @@
 
 #include "Logger.h"
 
+#include "../control/GLUtilities.h"
+
 #include "../../glm/vec3.hpp"
 
 #include "../../imgui/imgui_impl_sdl.h"
@@ -14,16 +16,24 @@
 #include <chrono>
 #include <cmath>
 #include <filesystem>
+#include <thread>
 
 WindowHandler::WindowHandler() :
 mWindowWidth(0), mWindowHeight(0), mRunning(false), mSimulationRunning(false),
 mWindow(nullptr), mSimulationHandler(), mSimulationRenderer(mSimulationHandler),
+#ifndef ITERATE_ON_COMPUTE_SHADER
+mSimulationThread(mSimulationHandler, [this]() { iterateSimulation(); }),
+#endif
 mFileSaveLocation("sampleFile"), mFileLoadLocations(), mFileLoadIndex(0), mFileLoadCount(0), mIsOverwritingFile(false) {
-    Logger::getLogger().logMessage("Constructing Window");
+    LOG_MESSAGE("Constructing Window");
+#ifndef ITERATE_ON_COMPUTE_SHADER
+    mSimulationHandler.setThreadCount(std::thread::hardware_concurrency());
+    mThreadIterationTimes.assign(MAX_THREADS + 1, 0.0f);
+#endif
 }
 
 WindowHandler::~WindowHandler() {
-    Logger::getLogger().logMessage("Destroying Window");
+    LOG_MESSAGE("Destroying Window");
     saveToFile("resources/current.csdat", mSimulationHandler);
 
     ImGui_ImplOpenGL3_Shutdown();
@@ -41,9 +51,9 @@ WindowHandler::~WindowHandler() {
 }
 
 bool WindowHandler::init() {
-    Logger::getLogger().logMessage("Initializing Window");
+    LOG_MESSAGE("Initializing Window");
     if (SDL_Init(SDL_INIT_VIDEO) < 0) {
-        Logger::getLogger().logError(std::string("Failed to initialize SDL - SDL Error: ").append(SDL_GetError()));
+        LOG_ERROR(std::string("Failed to initialize SDL - SDL Error: ").append(SDL_GetError()));
         return false;
     }
 
@@ -88,7 +98,7 @@ bool WindowHandler::init() {
             windowFlags);
 
     if (mWindow == nullptr) {
-        Logger::getLogger().logError(std::string("Failed to create Window - SDL Error").append(SDL_GetError()));
+        LOG_ERROR(std::string("Failed to create Window - SDL Error").append(SDL_GetError()));
         return false;
     }
 
@@ -101,7 +111,7 @@ bool WindowHandler::init() {
     SDL_GL_SetSwapInterval((mEnableVsync = mAllowVsync) ? ((mVsyncAdaptive = mAllowAdaptive) ? -1 : 1) : 0);
 
     if (!gladLoadGLLoader((GLADloadproc) SDL_GL_GetProcAddress)) {
-        Logger::getLogger().logError(std::string("Failed to initialize OpenGL"));
+        LOG_ERROR(std::string("Failed to initialize OpenGL"));
         return false;
     }
 
@@ -129,12 +139,12 @@ bool WindowHandler::init() {
     mSimulationHandler.initComputeShaders();
 #endif
     if (!mSimulationRenderer.init()) {
-        Logger::getLogger().logError(std::string("Failed to initialize Renderer"));
+        LOG_ERROR(std::string("Failed to initialize Renderer"));
         return false;
     }
 
     if (!getLoadableFiles(mFileLoadLocations, mFileLoadCount)) {
-        Logger::getLogger().logError(std::string("Failed to read config files"));
+        LOG_ERROR(std::string("Failed to read config files"));
         return false;
     }
     loadFromFile("resources/current.csdat", mSimulationHandler);
@@ -157,6 +167,12 @@ void WindowHandler::mainloop() {
     ImGui::PushStyleVar(ImGuiStyleVar_FrameBorderSize, 1.0f);
     ImGui::PushStyleVar(ImGuiStyleVar_CellPadding, ImVec2(0, 0));
 
+    mIterationRateStart = std::chrono::steady_clock::now();
+#ifndef ITERATE_ON_COMPUTE_SHADER
+    mSimulationThread.publishSnapshot();
+    mSimulationThread.start();
+#endif
+
     while (mRunning) {
         auto currentTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
         delta += (float) (currentTime - lastTime);
@@ -204,23 +220,37 @@ void WindowHandler::mainloop() {
             ImVec2 simPanelBounds     = ImVec2(bounds.x - debugPanelBounds.x, bounds.y - messagePanelBounds.y);
 
             ImGui::BeginGroup();
+            {
+#ifndef ITERATE_ON_COMPUTE_SHADER
+                // The panels read and modify the handler, so the simulation
+                // thread must wait until they are done
+                std::unique_lock<std::mutex> lock = mSimulationThread.lockHandler();
+#endif
 
-            ImGui::BeginChild("Debug", debugPanelBounds, true);
-            drawDebugPanel(mspf);
-            ImGui::EndChild();
+                ImGui::BeginChild("Debug", debugPanelBounds, true);
+                drawDebugPanel(mspf);
+                ImGui::EndChild();
 
-            ImGui::SetCursorPosY(ImGui::GetCursorPosY() - 3); // Not a good solution (magic number)
+                ImGui::SetCursorPosY(ImGui::GetCursorPosY() - 3); // Not a good solution (magic number)
 
-            ImGui::BeginChild("Parameters", ioPanelBounds, true);
-            drawIOPanel();
-            ImGui::EndChild();
+                ImGui::BeginChild("Parameters", ioPanelBounds, true);
+                drawIOPanel();
+                ImGui::EndChild();
 
-            ImGui::SetCursorPosY(ImGui::GetCursorPosY() - 3); // Not a good solution (magic number)
+                ImGui::SetCursorPosY(ImGui::GetCursorPosY() - 3); // Not a good solution (magic number)
 
-            ImGui::BeginChild("AtomTypes", ioPanelBounds, true);
-            drawInteractionsPanel();
-            ImGui::EndChild();
+                ImGui::BeginChild("AtomTypes", ioPanelBounds, true);
+                drawInteractionsPanel();
+                ImGui::EndChild();
 
+#ifndef ITERATE_ON_COMPUTE_SHADER
+                mSimulationThread.setStepsPerFrame(mUnboundedSteps ? 0 : mStepsPerFrame);
+                mSimulationThread.setRunning(mSimulationRunning);
+                mSimulationThread.requestFrame();
+                if (!mSimulationRunning)
+                    mSimulationThread.publishSnapshot();
+#endif
+            }
             ImGui::EndGroup();
             ImGui::SameLine(0, 0);
 
@@ -228,7 +258,13 @@ void WindowHandler::mainloop() {
             ImVec2 panelBounds = ImGui::GetContentRegionAvail();
             ImVec2 panelPos = ImGui::GetContentRegionMax();
 
+#ifndef ITERATE_ON_COMPUTE_SHADER
+            const SimulationSnapshot* playbackSnapshot = mTrajectoryPlayer.isOpen() ? acquirePlaybackSnapshot() : nullptr;
+            const SimulationSnapshot& snapshot = playbackSnapshot != nullptr ? *playbackSnapshot : mSimulationThread.acquireSnapshot();
+            ImVec2 simBounds = ImVec2(snapshot.width, snapshot.height);
+#else
             ImVec2 simBounds = ImVec2(mSimulationHandler.getWidth(), mSimulationHandler.getHeight());
+#endif
 
             float scale = std::min(panelBounds.x / simBounds.x, panelBounds.y / simBounds.y);
             simBounds.x *= scale;
@@ -238,9 +274,15 @@ void WindowHandler::mainloop() {
             ImGui::SetCursorPosY(ImGui::GetCursorPosY() + (panelBounds.y - simBounds.y) / 2.0f);
 
             glViewport(0, 0, simBounds.x, simBounds.y);
+#ifndef ITERATE_ON_COMPUTE_SHADER
+            mSimulationRenderer.drawSimulation(
+                snapshot, debugPanelBounds.x + ImGui::GetCursorPosX() + 8, ImGui::GetCursorPosY() + 8, simBounds.x, simBounds.y
+            );
+#else
             mSimulationRenderer.drawSimulation(
                 debugPanelBounds.x + ImGui::GetCursorPosX() + 8, ImGui::GetCursorPosY() + 8, simBounds.x, simBounds.y
             );
+#endif
             glViewport(0, 0, mWindowWidth, mWindowHeight);
             ImGui::EndChild();
 
@@ -259,11 +301,16 @@ void WindowHandler::mainloop() {
 
         SDL_GL_SwapWindow(mWindow);
 
-        if (mSimulationRunning) {
-            mSimulationHandler.iterateSimulation();
-            mIterationCount++;
-        }
+#ifdef ITERATE_ON_COMPUTE_SHADER
+        if (mSimulationRunning)
+            for (unsigned int i = 0; i < mStepsPerFrame; i++)
+                iterateSimulation();
+#endif
     }
+
+#ifndef ITERATE_ON_COMPUTE_SHADER
+    mSimulationThread.stop();
+#endif
 }
 
 void WindowHandler::setSize(int width, int height) {
@@ -298,6 +345,12 @@ void WindowHandler::handleEvent(SDL_Event& e) {
         case SDL_KEYDOWN:
             switch (e.key.keysym.sym) {
                 case SDLK_SPACE:
+#ifndef ITERATE_ON_COMPUTE_SHADER
+                    if (mTrajectoryPlayer.isOpen()) {
+                        mPlayingTrajectory = !mPlayingTrajectory;
+                        break;
+                    }
+#endif
                     mSimulationRunning = !mSimulationRunning;
                     break;
             }
@@ -340,6 +393,131 @@ void WindowHandler::drawDebugPanel(float mspf) {
         "No. Atom Types: %u", mSimulationHandler.getAtomTypeCount()
     );
 
+    ImGui::Separator();
+
+    ImGui::TextColored(
+        debugTextColor,
+        "Iteration Time: %.2fms", mIterationTime
+    );
+
+    auto now = std::chrono::steady_clock::now();
+    float rateSeconds = std::chrono::duration<float>(now - mIterationRateStart).count();
+    if (rateSeconds >= 1.0f) {
+        mIterationRate = (mIterationCount >= mIterationRateCount) ? (mIterationCount - mIterationRateCount) / rateSeconds : 0.0f;
+        mIterationRateStart = now;
+        mIterationRateCount = mIterationCount;
+    }
+    ImGui::TextColored(
+        debugTextColor,
+        "Iterations/s: %.1f", mIterationRate
+    );
+
+    int stepsPerFrame = (int) mStepsPerFrame;
+#ifndef ITERATE_ON_COMPUTE_SHADER
+    ImGui::BeginDisabled(mUnboundedSteps);
+#endif
+    ImGui::SetNextItemWidth(-FLT_MIN);
+    if (ImGui::SliderInt("##Steps Per Frame", &stepsPerFrame, 1, 64, "Steps/Frame: %d"))
+        mStepsPerFrame = (unsigned int) std::max(stepsPerFrame, 1);
+    if (ImGui::IsItemHovered())
+        ImGui::SetTooltip("Number of iterations to run per rendered frame.");
+#ifndef ITERATE_ON_COMPUTE_SHADER
+    ImGui::EndDisabled();
+    ImGui::Checkbox("Unbounded", &mUnboundedSteps);
+    if (ImGui::IsItemHovered())
+        ImGui::SetTooltip("Iterate as fast as possible, independent of the frame rate.");
+#endif
+#ifndef ITERATE_ON_COMPUTE_SHADER
+    size_t threadCount = mSimulationHandler.getThreadCount();
+    float singleThreadTime = mThreadIterationTimes[1];
+    if (singleThreadTime > 0.0f && mThreadIterationTimes[threadCount] > 0.0f)
+        ImGui::TextColored(
+            debugTextColor,
+            "Speed-up: %.2fx (vs 1 thread)", singleThreadTime / mThreadIterationTimes[threadCount]
+        );
+    else
+        ImGui::TextColored(
+            debugTextColor,
+            "Speed-up: - (run with 1 thread to compare)"
+        );
+
+    int threads = (int) threadCount;
+    int maxThreads = (int) std::min((size_t) std::max(std::thread::hardware_concurrency() * 2, 2u), MAX_THREADS);
+    ImGui::SetNextItemWidth(-FLT_MIN);
+    if (ImGui::SliderInt("##Threads", &threads, 1, maxThreads, "Threads: %d"))
+        mSimulationHandler.setThreadCount(threads);
+    if (ImGui::IsItemHovered())
+        ImGui::SetTooltip("Number of CPU threads used to iterate the simulation.");
+
+    ImGui::SetNextItemWidth(-FLT_MIN);
+    if (ImGui::BeginCombo("##Instruction Set", getInstructionSetName(mSimulationHandler.getInstructionSet()))) {
+        for (int i = 0; i < InstructionSetMax; i++) {
+            auto instructionSet = (InstructionSet) i;
+            if (!isInstructionSetSupported(instructionSet))
+                continue;
+            if (ImGui::Selectable(getInstructionSetName(instructionSet), instructionSet == mSimulationHandler.getInstructionSet()))
+                mSimulationHandler.setInstructionSet(instructionSet);
+        }
+        ImGui::EndCombo();
+    }
+    if (ImGui::IsItemHovered())
+        ImGui::SetTooltip("Instruction set used by the force kernel.");
+
+    bool pairSymmetry = mSimulationHandler.getPairSymmetry();
+    if (ImGui::Checkbox("Pair Symmetry", &pairSymmetry))
+        mSimulationHandler.setPairSymmetry(pairSymmetry);
+    if (ImGui::IsItemHovered())
+        ImGui::SetTooltip("Visit each pair of atoms once, applying the forces in both directions.");
+
+    bool typeRuns = mSimulationHandler.getTypeRuns();
+    if (ImGui::Checkbox("Type Runs", &typeRuns))
+        mSimulationHandler.setTypeRuns(typeRuns);
+    if (ImGui::IsItemHovered())
+        ImGui::SetTooltip(
+            "Sort the atoms of each cell by type, so each run of one type shares an interaction value.\n"
+            "Only used with at least %zu atoms of each type per cell on average (currently %s).",
+            MIN_TYPE_RUN_LENGTH, mSimulationHandler.isUsingTypeRuns() ? "in use" : "not in use"
+        );
+
+    float neighbourSkin = mSimulationHandler.getNeighbourSkin();
+    ImGui::SetNextItemWidth(-FLT_MIN);
+    if (ImGui::SliderFloat("##Neighbour Skin", &neighbourSkin, MIN_NEIGHBOUR_SKIN, MAX_NEIGHBOUR_SKIN, "Neighbour Skin: %.1f")) {
+        mSimulationHandler.setNeighbourSkin(neighbourSkin);
+        mNeighbourRebuildRate = 0.0f;
+    }
+    if (ImGui::IsItemHovered())
+        ImGui::SetTooltip(
+            "Margin beyond the interaction range of the neighbour lists, which are\n"
+            "reused until any atom has moved half of it (0 to search every iteration)."
+        );
+    if (mSimulationHandler.getNeighbourSkin() <= 0.0f)
+        ImGui::TextColored(
+            debugTextColor,
+            "Neighbour Lists: Off"
+        );
+    else if (mNeighbourRebuildRate > 0.0f)
+        ImGui::TextColored(
+            debugTextColor,
+            "Rebuilt every %.1f iterations", 1.0f / mNeighbourRebuildRate
+        );
+    else
+        ImGui::TextColored(
+            debugTextColor,
+            "Rebuilt every - iterations"
+        );
+
+    int reorderInterval = (int) mSimulationHandler.getReorderInterval();
+    ImGui::SetNextItemWidth(-FLT_MIN);
+    if (ImGui::SliderInt("##Reorder Interval", &reorderInterval, 0, 1000,
+                         reorderInterval > 0 ? "Reorder Every %d" : "Reorder: Off", ImGuiSliderFlags_Logarithmic))
+        mSimulationHandler.setReorderInterval((size_t) std::max(reorderInterval, 0));
+    if (ImGui::IsItemHovered())
+        ImGui::SetTooltip(
+            "Iterations between sorting the atoms in memory along a space-filling curve,\n"
+            "so neighbouring atoms share cache lines (0 to never sort them)."
+        );
+#endif
+
     if (mAllowVsync) {
         if (ImGui::Checkbox("Enable VSync", &mEnableVsync))
             if (SDL_GL_SetSwapInterval(mEnableVsync ? (mVsyncAdaptive ? -1 : 1) : 0))
@@ -365,14 +543,14 @@ void WindowHandler::drawIOPanel() {
     label = (mSimulationRunning ? "Pause" : "Play") + std::string("##PlayPause");
     if (ImGui::Button(label.c_str(), HALF_WIDTH)) {
         mSimulationRunning = !mSimulationRunning;
-        Logger::getLogger().logMessage(mSimulationRunning ? "Starting Simulation" : "Stopping Simulation");
+        LOG_MESSAGE(mSimulationRunning ? "Starting Simulation" : "Stopping Simulation");
     }
     if (ImGui::IsItemHovered())
         ImGui::SetTooltip(((mSimulationRunning ? "Pause" : "Play") + std::string(" the simulation [SPACE].")).c_str());
     ImGui::SameLine(0, 0);
     if (ImGui::Button("Iterate", REMAINING_WIDTH)) {
         mSimulationRunning = false;
-        mSimulationHandler.iterateSimulation();
+        iterateSimulation();
     }
     if (ImGui::IsItemHovered())
         ImGui::SetTooltip("Perform a single iteration of the simulation.");
@@ -386,6 +564,13 @@ void WindowHandler::drawIOPanel() {
     };
     ImGui::Combo("##Start Condition", (int*)&mSimulationHandler.startCondition, START_CONDITION_NAMES, (int)StartConditionMax);
 
+    ImGui::Text("Seed");
+    ImU64 seed = mSimulationHandler.getSeed();
+    if (ImGui::InputScalar("##Seed", ImGuiDataType_U64, &seed, nullptr, nullptr, nullptr, ImGuiInputTextFlags_EnterReturnsTrue))
+        mSimulationHandler.setSeed(seed);
+    if (ImGui::IsItemHovered())
+        ImGui::SetTooltip("Restart the random sequence from this seed (saved with the configuration).\nThe same seed and configuration always generate the same atoms.");
+
     ImGui::Separator();
     ImGui::Text("Atoms");
     if (ImGui::Button("Generate", HALF_WIDTH)) {
@@ -408,11 +593,8 @@ void WindowHandler::drawIOPanel() {
     if (ImGui::IsItemHovered())
         ImGui::SetTooltip("Clear all atom types from the current configuration.");
     ImGui::SameLine(0, 0);
-    size_t atomTypeCount = mSimulationHandler.getAtomTypeCount();
-    ImGui::BeginDisabled(atomTypeCount >= MAX_ATOM_TYPES);
     if (ImGui::Button("Add New", REMAINING_WIDTH))
         mSimulationHandler.newAtomType();
-    ImGui::EndDisabled();
     if (ImGui::IsItemHovered())
         ImGui::SetTooltip("Add a new atom type to the configuration.");
 
@@ -588,6 +770,121 @@ void WindowHandler::drawIOPanel() {
         }
     }
 
+    std::string checkpointLocation = CONFIG_FILE_LOCATION + std::string("/") + mFileSaveLocation + std::string(".") + CHECKPOINT_FILE_EXTENSION;
+    if (ImGui::Button("Checkpoint", ImVec2(ImGui::GetContentRegionAvail().x / 2.0f, 0))) {
+#ifdef ITERATE_ON_COMPUTE_SHADER
+        // Downloading replaces any copy still in flight, so record it first
+        recordPendingFrame(true);
+        mSimulationHandler.downloadAtoms();
+#endif
+        if (!saveCheckpoint(checkpointLocation, mSimulationHandler))
+            messageError("Failed to save checkpoint '" + std::string(mFileSaveLocation) + "'");
+    }
+    if (ImGui::IsItemHovered())
+        ImGui::SetTooltip("Save every atom's position and velocity, so the simulation can be resumed.");
+    ImGui::SameLine(0, 0);
+    if (ImGui::Button("Resume", ImVec2(-FLT_MIN, 0))) {
+        if (loadCheckpoint(checkpointLocation, mSimulationHandler)) {
+            mTimeElapsed = 0.0f;
+            mIterationCount = 0;
+        } else {
+            messageError("Failed to load checkpoint '" + std::string(mFileSaveLocation) + "'");
+        }
+        mSimulationRenderer.updateParameters();
+    }
+    if (ImGui::IsItemHovered())
+        ImGui::SetTooltip("Resume the simulation from the checkpoint with the name above.");
+
+    std::string trajectoryLocation = CONFIG_FILE_LOCATION + std::string("/") + mFileSaveLocation + std::string(".") + TRAJECTORY_FILE_EXTENSION;
+    if (mTrajectoryWriter.isOpen() && mTrajectoryWriter.hasFailed()) {
+#ifdef ITERATE_ON_COMPUTE_SHADER
+        recordPendingFrame(true);
+#endif
+        mTrajectoryWriter.close();
+        messageError("Stopped recording, the atoms changed or the trajectory could not be written");
+    }
+    if (ImGui::Button(mTrajectoryWriter.isOpen() ? "Stop" : "Record", ImVec2(ImGui::GetContentRegionAvail().x / 2.0f, 0))) {
+        if (mTrajectoryWriter.isOpen()) {
+#ifdef ITERATE_ON_COMPUTE_SHADER
+            recordPendingFrame(true);
+#endif
+            size_t frames = mTrajectoryWriter.getRecordedFrameCount();
+            if (mTrajectoryWriter.close())
+                messageInfo("Recorded " + std::to_string(frames) + " frames to '" + trajectoryLocation + "'");
+            else
+                messageError("Failed to write trajectory '" + std::string(mFileSaveLocation) + "'");
+        } else if (mTrajectoryWriter.open(trajectoryLocation, mSimulationHandler, mRecordInterval, true)) {
+#ifdef ITERATE_ON_COMPUTE_SHADER
+            mSimulationHandler.downloadAtoms();
+#endif
+            mTrajectoryWriter.record(mSimulationHandler, mIterationCount);
+        } else {
+            messageError("Failed to create trajectory '" + std::string(mFileSaveLocation) + "'");
+        }
+    }
+    if (ImGui::IsItemHovered())
+        ImGui::SetTooltip("Record the positions and velocities of every atom to a trajectory with the name above.");
+    ImGui::SameLine(0, 0);
+    int recordInterval = (int) mRecordInterval;
+    ImGui::BeginDisabled(mTrajectoryWriter.isOpen());
+    ImGui::SetNextItemWidth(-FLT_MIN);
+    if (ImGui::SliderInt("##Record Interval", &recordInterval, 1, 100, "Every %d"))
+        mRecordInterval = (unsigned int) std::max(recordInterval, 1);
+    ImGui::EndDisabled();
+    if (ImGui::IsItemHovered())
+        ImGui::SetTooltip("Number of iterations between recorded frames.");
+
+#ifndef ITERATE_ON_COMPUTE_SHADER
+    if (mTrajectoryPlayer.isOpen() && mTrajectoryPlayer.hasFailed()) {
+        mTrajectoryPlayer.close();
+        messageError("Stopped playback, the trajectory is corrupt");
+    }
+    if (ImGui::Button(mTrajectoryPlayer.isOpen() ? "Close Trajectory" : "Open Trajectory", REMAINING_WIDTH)) {
+        mPlayingTrajectory = false;
+        if (mTrajectoryPlayer.isOpen()) {
+            mTrajectoryPlayer.close();
+        } else if (mTrajectoryPlayer.open(trajectoryLocation)) {
+            mSimulationRunning = false;
+        } else {
+            messageError("Failed to open trajectory '" + std::string(mFileSaveLocation) + "'");
+        }
+    }
+    if (ImGui::IsItemHovered())
+        ImGui::SetTooltip("Play back the trajectory with the name above in place of the simulation.");
+    if (mTrajectoryPlayer.isOpen()) {
+        label = (mPlayingTrajectory ? "Pause" : "Play") + std::string("##PlayTrajectory");
+        if (ImGui::Button(label.c_str(), HALF_WIDTH)) {
+            mPlayingTrajectory = !mPlayingTrajectory;
+            if (mPlayingTrajectory && mTrajectoryPlayer.getPlayhead() + 1 >= mTrajectoryPlayer.getFrameCount())
+                mTrajectoryPlayer.setPlayhead(0, mPlaybackStep);
+        }
+        if (ImGui::IsItemHovered())
+            ImGui::SetTooltip(((mPlayingTrajectory ? "Pause" : "Play") + std::string(" the trajectory [SPACE].")).c_str());
+        ImGui::SameLine(0, 0);
+        int frame = (int) mTrajectoryPlayer.getPlayhead();
+        int lastFrame = (int) std::max(mTrajectoryPlayer.getFrameCount(), (size_t) 1) - 1;
+        if (ImGui::SliderInt("##Playhead", &frame, 0, lastFrame, "Frame %d"))
+            mTrajectoryPlayer.setPlayhead((size_t) std::max(frame, 0), mPlaybackStep);
+        if (ImGui::IsItemHovered())
+            ImGui::SetTooltip("Iteration %llu", (unsigned long long) mTrajectoryPlayer.getDisplayedIteration());
+
+        int playbackStep = (int) mPlaybackStep;
+        if (ImGui::SliderInt("##Playback Step", &playbackStep, 1, 16, "Frames/Frame: %d")) {
+            mPlaybackStep = (unsigned int) std::max(playbackStep, 1);
+            mTrajectoryPlayer.setPlayhead(mTrajectoryPlayer.getPlayhead(), mPlaybackStep);
+        }
+        if (ImGui::IsItemHovered())
+            ImGui::SetTooltip("Number of trajectory frames to advance per rendered frame.");
+
+        mPlaybackAtomTypeColors.assign(
+            std::max(mTrajectoryPlayer.getAtomTypeCount(), mSimulationHandler.getAtomTypeCount()), glm::vec3(0.5f)
+        );
+        for (atom_type_id id : mSimulationHandler.getAtomTypeIds())
+            mPlaybackAtomTypeColors[id] = mSimulationHandler.getAtomTypeColor(id);
+        mPlaybackAtomDiameter = mSimulationHandler.getAtomDiameter();
+    }
+#endif
+
     ImGui::PopItemWidth();
 }
 
@@ -599,6 +896,7 @@ void WindowHandler::drawInteractionsPanel() {
     ImGui::PushItemWidth(-FLT_MIN);
 
     std::vector<atom_type_id> atomTypeIds = mSimulationHandler.getAtomTypeIds();
+    mBulkLock.resize(atomTypeIds.size(), false);
 
     if (ImGui::Button("Lock All", HALF_WIDTH))
         for (atom_type_id atomTypeId : atomTypeIds)
@@ -613,15 +911,10 @@ void WindowHandler::drawInteractionsPanel() {
         ImGui::SetTooltip("Set the quantity for all unlocked atom types.");
     label = "##BulkQuantity";
     if (ImGui::InputInt(label.c_str(), (int*) &mBulkQuantity, 0)) {
-        int count = mSimulationHandler.getAtomCount();
+        mBulkQuantity = std::max((int) mBulkQuantity, 0);
         for (atom_type_id atomTypeId : atomTypeIds)
             if (!mBulkLock[atomTypeId])
-                mSimulationHandler.setAtomTypeQuantity(atomTypeId, std::min(mBulkQuantity, (unsigned int) MAX_ATOMS));
-        int newCount = mSimulationHandler.getAtomCount();
-        if (newCount > MAX_ATOMS)
-            messageWarn("Too many atoms defined (max: " + std::to_string(MAX_ATOMS) + " | you have " + std::to_string(newCount) + ")");
-        else if (count > MAX_ATOMS)
-            messageClear();
+                mSimulationHandler.setAtomTypeQuantity(atomTypeId, mBulkQuantity);
     }
 
     if (ImGui::Button("Equalise Colors")) {
@@ -674,15 +967,8 @@ void WindowHandler::drawInteractionsPanel() {
 
         unsigned int quantity = mSimulationHandler.getAtomTypeQuantity(atomTypeId);
         label = "##QuantityInt-" + atomIdStr;
-        if (ImGui::InputInt(label.c_str(), (int*) &quantity, 0)) {
-            int count = mSimulationHandler.getAtomCount();
-            mSimulationHandler.setAtomTypeQuantity(atomTypeId, std::min(quantity, (unsigned int) MAX_ATOMS));
-            int newCount = mSimulationHandler.getAtomCount();
-            if (newCount > MAX_ATOMS)
-                messageWarn("Too many atoms defined (max: " + std::to_string(MAX_ATOMS) + " | you have " + std::to_string(newCount) + ")");
-            else if (count > MAX_ATOMS)
-                messageClear();
-        }
+        if (ImGui::InputInt(label.c_str(), (int*) &quantity, 0))
+            mSimulationHandler.setAtomTypeQuantity(atomTypeId, std::max((int) quantity, 0));
 
         for (atom_type_id atomTypeId2 : atomTypeIds) {
             std::string atom2IdStr = std::to_string(atomTypeId2);
@@ -710,6 +996,72 @@ void WindowHandler::drawInteractionsPanel() {
     }
 }
 
+#ifndef ITERATE_ON_COMPUTE_SHADER
+const SimulationSnapshot* WindowHandler::acquirePlaybackSnapshot() {
+    SimulationSnapshot* snapshot = mTrajectoryPlayer.acquireSnapshot();
+    if (mPlayingTrajectory && mTrajectoryPlayer.getDisplayedFrame() == mTrajectoryPlayer.getPlayhead()) {
+        // Only advance once the playhead frame is shown, so slow decoding
+        // slows playback down rather than skipping frames
+        size_t next = mTrajectoryPlayer.getPlayhead() + mPlaybackStep;
+        if (next < mTrajectoryPlayer.getFrameCount())
+            mTrajectoryPlayer.setPlayhead(next, mPlaybackStep);
+        else
+            mPlayingTrajectory = false;
+    }
+    if (snapshot == nullptr)
+        return nullptr;
+
+    snapshot->atomTypeColors = mPlaybackAtomTypeColors;
+    snapshot->atomTypeColors.resize(mTrajectoryPlayer.getAtomTypeCount(), glm::vec3(0.5f));
+    snapshot->atomDiameter = mPlaybackAtomDiameter;
+    return snapshot;
+}
+#else
+void WindowHandler::recordPendingFrame(bool wait) {
+    if (mPendingFrameIteration == 0)
+        return;
+    if (mSimulationHandler.receiveAtoms(wait))
+        mTrajectoryWriter.record(mSimulationHandler, mPendingFrameIteration);
+    else if (!wait)
+        return;
+    mPendingFrameIteration = 0;
+}
+#endif
+
+void WindowHandler::iterateSimulation() {
+#ifndef ITERATE_ON_COMPUTE_SHADER
+    size_t neighbourBuilds = mSimulationHandler.getNeighbourListBuildCount();
+#endif
+    auto start = std::chrono::steady_clock::now();
+    mSimulationHandler.iterateSimulation();
+    float time = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    mIterationCount++;
+
+#ifdef ITERATE_ON_COMPUTE_SHADER
+    // Frames are copied back while the GPU carries on iterating, and only
+    // waited on if the next frame is due before the copy arrives
+    if (mTrajectoryWriter.isOpen()) {
+        bool due = mTrajectoryWriter.isFrameDue(mIterationCount);
+        recordPendingFrame(due);
+        if (due) {
+            mSimulationHandler.requestAtoms();
+            mPendingFrameIteration = mIterationCount;
+        }
+    }
+#else
+    if (mTrajectoryWriter.isOpen() && mTrajectoryWriter.isFrameDue(mIterationCount))
+        mTrajectoryWriter.record(mSimulationHandler, mIterationCount);
+#endif
+
+    mIterationTime = (mIterationTime == 0.0f) ? time : mIterationTime * 0.95f + time * 0.05f;
+#ifndef ITERATE_ON_COMPUTE_SHADER
+    float& threadTime = mThreadIterationTimes[mSimulationHandler.getThreadCount()];
+    threadTime = (threadTime == 0.0f) ? time : threadTime * 0.95f + time * 0.05f;
+    float rebuilt = (mSimulationHandler.getNeighbourListBuildCount() != neighbourBuilds) ? 1.0f : 0.0f;
+    mNeighbourRebuildRate = (mNeighbourRebuildRate == 0.0f) ? rebuilt : mNeighbourRebuildRate * 0.99f + rebuilt * 0.01f;
+#endif
+}
+
 void WindowHandler::messageInfo(std::string message) {
     mMessage = message;
     mMessageColor = MESSAGE_COL;
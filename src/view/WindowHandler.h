@@ -8,10 +8,17 @@
 #pragma once
 #include "../control/SaveAndLoad.h"
 #include "../control/SimulationHandler.h"
+#include "../control/Trajectory.h"
+#ifndef ITERATE_ON_COMPUTE_SHADER
+#include "../control/SimulationThread.h"
+#include "../control/TrajectoryPlayer.h"
+#endif
 #include "SimulationRenderer.h"
 
 #include "../../imgui/imgui.h"
 
+#include <chrono>
+
 #ifdef _WIN32
 #include <SDL.h>
 #else
@@ -67,6 +74,30 @@ private:
     */
     void drawInteractionsPanel();
 
+#ifndef ITERATE_ON_COMPUTE_SHADER
+    /**
+     * Acquire the playhead frame of the open trajectory (see
+     * TrajectoryPlayer::acquireSnapshot), coloured by the loaded config, and
+     * advance the playhead if playing.
+     * @returns nullptr if no frame has been decoded yet.
+     */
+    const SimulationSnapshot* acquirePlaybackSnapshot();
+#else
+    /**
+     * Record the frame whose atoms are being copied back from the GPU (see
+     * SimulationHandler::requestAtoms), if there is one and it has arrived.
+     * @param wait Wait for the copy rather than leaving it pending.
+     */
+    void recordPendingFrame(bool wait);
+#endif
+
+    /**
+     * Iterate the simulation once, recording how long the iteration took. In
+     * the CPU build this runs on the simulation thread, so the handler must be
+     * locked (see SimulationThread::lockHandler).
+     */
+    void iterateSimulation();
+
     void messageInfo(std::string message);
     void messageWarn(std::string message);
     void messageError(std::string message);
@@ -83,12 +114,33 @@ private:
     float mTimeElapsed = 0.0f;
     unsigned int mIterationCount = 0;
 
+    /** Number of iterations to run per frame. */
+    unsigned int mStepsPerFrame = 1;
+#ifndef ITERATE_ON_COMPUTE_SHADER
+    /** Iterate as fast as possible rather than mStepsPerFrame per frame. */
+    bool mUnboundedSteps = false;
+#endif
+
+    /** Iterations per second, measured over roughly a second. */
+    float mIterationRate = 0.0f;
+    std::chrono::steady_clock::time_point mIterationRateStart;
+    unsigned int mIterationRateCount = 0;
+
+    /** Smoothed time (in ms) taken per iteration. */
+    float mIterationTime = 0.0f;
+#ifndef ITERATE_ON_COMPUTE_SHADER
+    /** Smoothed time (in ms) taken per iteration, indexed by thread count (0 if not yet measured). */
+    std::vector<float> mThreadIterationTimes;
+    /** Smoothed fraction of iterations which rebuilt the neighbour lists. */
+    float mNeighbourRebuildRate = 0.0f;
+#endif
+
     bool mEnableVsync = false;
     bool mVsyncAdaptive = false;
     bool mAllowVsync = false;
     bool mAllowAdaptive = false;
 
-    std::vector<bool> mBulkLock = std::vector<bool>(MAX_ATOM_TYPES, false);
+    std::vector<bool> mBulkLock;
     unsigned int mBulkQuantity = 200u;
 
     bool mShowMessage = false;
@@ -101,6 +153,25 @@ private:
 
     SimulationHandler mSimulationHandler;
     SimulationRenderer mSimulationRenderer;
+    /** Records the simulation while open. Written to in WindowHandler::iterateSimulation. */
+    TrajectoryWriter mTrajectoryWriter;
+    /** Number of iterations between recorded frames. */
+    unsigned int mRecordInterval = 10;
+#ifdef ITERATE_ON_COMPUTE_SHADER
+    /** Iteration of the frame being copied back from the GPU to be recorded, or 0 if none. */
+    unsigned int mPendingFrameIteration = 0;
+#else
+    SimulationThread mSimulationThread;
+
+    /** Trajectory drawn in place of the simulation while open. */
+    TrajectoryPlayer mTrajectoryPlayer;
+    bool mPlayingTrajectory = false;
+    /** Number of trajectory frames to advance per rendered frame. */
+    unsigned int mPlaybackStep = 1;
+    /** Atom type colours and diameter of the loaded config, used to draw the trajectory. */
+    std::vector<glm::vec3> mPlaybackAtomTypeColors;
+    float mPlaybackAtomDiameter = 0.0f;
+#endif
 
     char mFileSaveLocation[20];
     std::string mFileLoadLocations[MAX_FILE_COUNT];